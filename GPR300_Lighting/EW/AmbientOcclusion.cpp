@@ -0,0 +1,99 @@
+#include "AmbientOcclusion.h"
+
+namespace ew {
+	// Sampler units of ambientOcclusion.comp. The second is the normals for the estimate and the
+	// full resolution view depth for the upsample
+	const GLuint OCCLUSION_SOURCE_UNIT = 4;
+	const GLuint OCCLUSION_SECOND_UNIT = 5;
+
+	const AmbientOcclusion::Tier AmbientOcclusion::TIERS[AmbientOcclusion::NUM_TIERS] = {
+		{ "Low", 4, 1 },
+		{ "Medium", 8, 2 },
+		{ "High", 16, 3 },
+		{ "Ultra", 32, 4 },
+	};
+
+	AmbientOcclusion::AmbientOcclusion(std::string computeShaderPath)
+		: mOcclusionShader(computeShaderPath, { { "PASS", 0 } }),
+		mBlurShader(computeShaderPath, { { "PASS", 1 } }),
+		mUpsampleShader(computeShaderPath, { { "PASS", 2 } })
+	{
+	}
+
+	void AmbientOcclusion::setTier(int tier)
+	{
+		tier = glm::clamp(tier, 0, NUM_TIERS - 1);
+		if (tier == mTier) { return; }
+		mTier = tier;
+		// Times measured at the old tier no longer say anything
+		mSmoothedMilliseconds = 0.0;
+		mCooldown = COOLDOWN_FRAMES;
+	}
+
+	void AmbientOcclusion::update(double gpuMilliseconds)
+	{
+		if (mCooldown > 0)
+		{
+			mCooldown--;
+			return;
+		}
+		mSmoothedMilliseconds = mSmoothedMilliseconds == 0.0 ? gpuMilliseconds : glm::mix(mSmoothedMilliseconds, gpuMilliseconds, 0.1);
+		if (!mAutoTier) { return; }
+
+		if (mSmoothedMilliseconds > mBudgetMilliseconds)
+		{
+			setTier(mTier - 1);
+			return;
+		}
+		// The estimate dominates the cost, so the next tier's is taken as growing with its samples
+		if (mTier + 1 < NUM_TIERS)
+		{
+			double nextMilliseconds = mSmoothedMilliseconds * TIERS[mTier + 1].numSamples / TIERS[mTier].numSamples;
+			if (nextMilliseconds < mBudgetMilliseconds * HEADROOM) { setTier(mTier + 1); }
+		}
+	}
+
+	void AmbientOcclusion::compute(RenderTargetPool& pool, GLuint viewDepthTexture, GLuint normalTexture, int width, int height, const glm::mat4& view, const glm::mat4& projection, GLuint destination)
+	{
+		const Tier& tier = TIERS[mTier];
+		int halfWidth = (width + 1) / 2;
+		int halfHeight = (height + 1) / 2;
+		// Occlusion and view depth, so the blur finds the edges without the full resolution depth
+		GLuint halfTextures[2] = { pool.acquire(halfWidth, halfHeight, GL_RG32F), pool.acquire(halfWidth, halfHeight, GL_RG32F) };
+		GLuint halfGroupsX = (halfWidth + GROUP_SIZE - 1) / GROUP_SIZE;
+		GLuint halfGroupsY = (halfHeight + GROUP_SIZE - 1) / GROUP_SIZE;
+
+		mOcclusionShader.setMat4("_View", view);
+		mOcclusionShader.setMat4("_Projection", projection);
+		mOcclusionShader.setInt("_NumSamples", tier.numSamples);
+		mOcclusionShader.setFloat("_Radius", mRadius);
+		mOcclusionShader.setFloat("_Intensity", mIntensity);
+		mOcclusionShader.use();
+		glBindTextureUnit(OCCLUSION_SOURCE_UNIT, viewDepthTexture);
+		glBindTextureUnit(OCCLUSION_SECOND_UNIT, normalTexture);
+		glBindImageTexture(0, halfTextures[0], 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RG32F);
+		glDispatchCompute(halfGroupsX, halfGroupsY, 1);
+		glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+
+		mBlurShader.setInt("_BlurRadius", tier.blurRadius);
+		mBlurShader.use();
+		for (int axis = 0; axis < 2; axis++)
+		{
+			mBlurShader.setVec2("_Direction", axis == 0 ? glm::vec2(1, 0) : glm::vec2(0, 1));
+			glBindTextureUnit(OCCLUSION_SOURCE_UNIT, halfTextures[axis]);
+			glBindImageTexture(0, halfTextures[1 - axis], 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RG32F);
+			glDispatchCompute(halfGroupsX, halfGroupsY, 1);
+			// The second axis writes over what the estimate wrote, once the first has read it
+			glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT | GL_TEXTURE_FETCH_BARRIER_BIT);
+		}
+
+		mUpsampleShader.use();
+		glBindTextureUnit(OCCLUSION_SOURCE_UNIT, halfTextures[0]);
+		glBindTextureUnit(OCCLUSION_SECOND_UNIT, viewDepthTexture);
+		glBindImageTexture(0, destination, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_R8);
+		glDispatchCompute((width + GROUP_SIZE - 1) / GROUP_SIZE, (height + GROUP_SIZE - 1) / GROUP_SIZE, 1);
+
+		pool.release(halfTextures[0]);
+		pool.release(halfTextures[1]);
+	}
+}
@@ -0,0 +1,90 @@
+#pragma once
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include "Shader.h"
+#include "RenderTargetPool.h"
+
+namespace ew {
+	/// <summary>
+	/// Screen space ambient occlusion from the deferred G-buffer's normals and view depth
+	/// (shaders/ambientOcclusion.comp). It is estimated at half resolution, blurred without
+	/// crossing depth edges and brought back to full resolution by a depth aware upsample,
+	/// all in compute. The deferred lighting pass scales its ambient term by the result;
+	/// forward shading has no G-buffer and gets none.
+	/// Tiers trade samples and blur width for cost, and can be stepped automatically to keep
+	/// the passes under a time budget.
+	/// </summary>
+	class AmbientOcclusion {
+	public:
+		// Must match ambientOcclusion.comp
+		static const int MAX_SAMPLES = 32;
+		static const int MAX_BLUR_RADIUS = 4;
+
+		struct Tier {
+			const char* name;
+			int numSamples;
+			// In half resolution texels
+			int blurRadius;
+		};
+		static const int NUM_TIERS = 4;
+		static const Tier TIERS[NUM_TIERS];
+
+		AmbientOcclusion(std::string computeShaderPath);
+		bool isReady() { return mOcclusionShader.isReady() && mBlurShader.isReady() && mUpsampleShader.isReady(); }
+
+		/// <summary>
+		/// Writes the occlusion of the width by height G-buffer to destination, a GL_R8 texture
+		/// of the same size. Scratch textures are taken from pool. view and projection are the
+		/// matrices the G-buffer was drawn with
+		/// </summary>
+		void compute(RenderTargetPool& pool, GLuint viewDepthTexture, GLuint normalTexture, int width, int height, const glm::mat4& view, const glm::mat4& projection, GLuint destination);
+
+		/// <summary>
+		/// Feeds the measured GPU time of the passes, once per frame. With the automatic tier
+		/// it steps down while over the budget, and up once the next tier should fit in it
+		/// </summary>
+		void update(double gpuMilliseconds);
+
+		void setTier(int tier);
+		int getTier() const { return mTier; }
+		void setAutoTier(bool enabled) { mAutoTier = enabled; }
+		bool isAutoTier() const { return mAutoTier; }
+		void setBudgetMilliseconds(float budget) { mBudgetMilliseconds = budget; }
+		float getBudgetMilliseconds() const { return mBudgetMilliseconds; }
+		double getSmoothedMilliseconds() const { return mSmoothedMilliseconds; }
+		/// <summary>
+		/// World space reach of the samples around each surface
+		/// </summary>
+		void setRadius(float radius) { mRadius = radius; }
+		float getRadius() const { return mRadius; }
+		/// <summary>
+		/// Exponent applied to the unoccluded fraction, higher darkens
+		/// </summary>
+		void setIntensity(float intensity) { mIntensity = intensity; }
+		float getIntensity() const { return mIntensity; }
+
+		Shader& getOcclusionShader() { return mOcclusionShader; }
+		Shader& getBlurShader() { return mBlurShader; }
+		Shader& getUpsampleShader() { return mUpsampleShader; }
+	private:
+		AmbientOcclusion(const AmbientOcclusion& r) = delete;
+		// Must match ambientOcclusion.comp
+		static const int GROUP_SIZE = 8;
+		// Frames to wait after a tier change, longer than GpuTimer's query latency
+		static const int COOLDOWN_FRAMES = 8;
+		// Only step up once comfortably under the budget
+		static constexpr float HEADROOM = 0.85f;
+
+		// Half resolution estimate, blur along x then y, full resolution upsample
+		Shader mOcclusionShader;
+		Shader mBlurShader;
+		Shader mUpsampleShader;
+		int mTier = 1;
+		bool mAutoTier = true;
+		float mBudgetMilliseconds = 1.0f;
+		double mSmoothedMilliseconds = 0.0;
+		int mCooldown = 0;
+		float mRadius = 1.0f;
+		float mIntensity = 1.5f;
+	};
+}
@@ -14,6 +14,12 @@ glm::vec3 Camera::getForward() {
 }
 
 glm::mat4 Camera::getProjectionMatrix() {
+	//Shifts the whole image in NDC, 2 units across the viewport
+	glm::vec2 ndcOffset = mJitter * 2.0f / mJitterViewportSize;
+	return glm::translate(glm::mat4(1), glm::vec3(ndcOffset, 0.0f)) * getUnjitteredProjectionMatrix();
+}
+
+glm::mat4 Camera::getUnjitteredProjectionMatrix() {
 	if (mOrtho) {
 		float width = mOrthoSize * mAspectRatio;
 		float right = width * 0.5f;
@@ -31,4 +37,19 @@ glm::mat4 Camera::getViewMatrix() {
 	return glm::lookAt(mPosition, mPosition + getForward(), glm::vec3(0,1,0));
 }
 
+static float halton(int index, int base) {
+	float result = 0.0f;
+	float fraction = 1.0f;
+	while (index > 0) {
+		fraction /= base;
+		result += fraction * (index % base);
+		index /= base;
+	}
+	return result;
+}
 
+glm::vec2 Camera::getHaltonJitter(int index, int numPhases) {
+	//Point 0 is (0, 0), start at 1
+	int i = index % numPhases + 1;
+	return glm::vec2(halton(i, 2), halton(i, 3)) - 0.5f;
+}
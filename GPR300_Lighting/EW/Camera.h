@@ -13,9 +13,17 @@ public:
 	inline float getYaw()const { return mYaw; }
 	inline float getPitch()const { return mPitch; }
 	inline float getFov()const { return mFov; }
+	inline float getNearPlane()const { return mNearPlane; }
+	inline float getFarPlane()const { return mFarPlane; }
+	inline float getAspectRatio()const { return mAspectRatio; }
+	inline glm::vec2 getJitter()const { return mJitter; }
 	glm::vec3 getForward();
+	//Includes the jitter
 	glm::mat4 getProjectionMatrix();
+	glm::mat4 getUnjitteredProjectionMatrix();
 	glm::mat4 getViewMatrix();
+	//Point index of the Halton (2, 3) sequence, cycling every numPhases, in pixels from -0.5 to 0.5
+	static glm::vec2 getHaltonJitter(int index, int numPhases = 8);
 	//SETTERS
 	inline void setPosition(const glm::vec3 position) { mPosition = position; }
 	inline void setYaw(const float yaw) { mYaw = yaw; };
@@ -26,6 +34,8 @@ public:
 	inline void setOrthoSize(const float orthoSize) { mOrthoSize = orthoSize; }
 	inline void setOrtho(const bool ortho) { mOrtho = ortho; }
 	inline void setAspectRatio(const float aspectRatio) { mAspectRatio = aspectRatio; }
+	//Sub-pixel offset for temporal upsampling, in pixels of a viewport this size. 0 for none
+	inline void setJitter(const glm::vec2 jitter, const glm::vec2 viewportSize) { mJitter = jitter; mJitterViewportSize = viewportSize; }
 private:
 	glm::vec3 mPosition = glm::vec3(0, 0, 5);
 	float mYaw = -90.0f;
@@ -36,4 +46,6 @@ private:
 	float mOrthoSize = 7.5f;
 	bool mOrtho = false;
 	float mAspectRatio = 1.7777f;
+	glm::vec2 mJitter = glm::vec2(0);
+	glm::vec2 mJitterViewportSize = glm::vec2(1);
 };
\ No newline at end of file
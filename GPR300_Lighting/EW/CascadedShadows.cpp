@@ -0,0 +1,143 @@
+#include "CascadedShadows.h"
+
+namespace ew {
+	CascadedShadows::CascadedShadows(std::string cullShaderPath, std::string vertexShaderPath, std::string depthFragmentShaderPath, GLuint uniformBinding, int resolution, int maxInstances)
+		: mCasters(cullShaderPath, vertexShaderPath, depthFragmentShaderPath, ShadowCasterDraws::ViewTarget::Layer, NUM_CASCADES, maxInstances),
+		mUniforms(uniformBinding, sizeof(ShadowUniforms)),
+		mResolution(resolution)
+	{
+		glCreateTextures(GL_TEXTURE_2D_ARRAY, 1, &mTexture);
+		glTextureStorage3D(mTexture, 1, GL_DEPTH_COMPONENT32F, resolution, resolution, NUM_CASCADES);
+		glTextureParameteri(mTexture, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		glTextureParameteri(mTexture, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		// Unshadowed until the first render
+		const float farDepth = 1.0f;
+		glClearTexImage(mTexture, 0, GL_DEPTH_COMPONENT, GL_FLOAT, &farDepth);
+
+		int numFramebuffers = isLayered() ? 1 : NUM_CASCADES;
+		glCreateFramebuffers(numFramebuffers, mFramebuffers);
+		for (int i = 0; i < numFramebuffers; i++)
+		{
+			if (isLayered()) { glNamedFramebufferTexture(mFramebuffers[i], GL_DEPTH_ATTACHMENT, mTexture, 0); }
+			else { glNamedFramebufferTextureLayer(mFramebuffers[i], GL_DEPTH_ATTACHMENT, mTexture, 0, i); }
+			glNamedFramebufferDrawBuffer(mFramebuffers[i], GL_NONE);
+		}
+	}
+
+	CascadedShadows::~CascadedShadows()
+	{
+		glDeleteFramebuffers(isLayered() ? 1 : NUM_CASCADES, mFramebuffers);
+		glDeleteTextures(1, &mTexture);
+	}
+
+	void CascadedShadows::update(Camera& camera, glm::vec3 lightDirection, glm::vec3 sceneCenter, float sceneRadius)
+	{
+		glm::mat4 cameraToWorld = glm::inverse(camera.getViewMatrix());
+		float tanHalfY = glm::tan(glm::radians(camera.getFov()) * 0.5f);
+		float tanHalfX = tanHalfY * camera.getAspectRatio();
+
+		// A fixed orientation, only the projection follows the camera
+		glm::vec3 toLight = glm::normalize(lightDirection);
+		glm::vec3 up = glm::abs(toLight.y) > 0.99f ? glm::vec3(0, 0, 1) : glm::vec3(0, 1, 0);
+		glm::mat4 lightView = glm::lookAt(glm::vec3(0), -toLight, up);
+
+		// Depth covers every caster, so nothing in front of a cascade is clipped
+		float sceneDepth = -(lightView * glm::vec4(sceneCenter, 1.0f)).z;
+		float zNear = sceneDepth - sceneRadius;
+		float zFar = sceneDepth + sceneRadius;
+
+		ShadowUniforms uniforms = {};
+		float splitNear = glm::max(camera.getNearPlane(), MIN_SPLIT_NEAR);
+		float sliceNear = camera.getNearPlane();
+		for (int c = 0; c < NUM_CASCADES; c++)
+		{
+			float t = (float)(c + 1) / NUM_CASCADES;
+			float logSplit = splitNear * glm::pow(mShadowDistance / splitNear, t);
+			float evenSplit = splitNear + (mShadowDistance - splitNear) * t;
+			float sliceFar = glm::mix(evenSplit, logSplit, SPLIT_LAMBDA);
+
+			// Bounding sphere of the slice. Its radius doesn't change as the camera turns,
+			// rounded so float noise doesn't either
+			glm::vec3 corners[8];
+			glm::vec3 center(0.0f);
+			for (int i = 0; i < 8; i++)
+			{
+				float distance = (i & 4) ? sliceFar : sliceNear;
+				glm::vec4 viewCorner((i & 1 ? 1.0f : -1.0f) * tanHalfX * distance, (i & 2 ? 1.0f : -1.0f) * tanHalfY * distance, -distance, 1.0f);
+				corners[i] = glm::vec3(cameraToWorld * viewCorner);
+				center += corners[i] / 8.0f;
+			}
+			float radius = 0.0f;
+			for (const glm::vec3& corner : corners) { radius = glm::max(radius, glm::length(corner - center)); }
+			radius = glm::ceil(radius * 16.0f) / 16.0f;
+
+			// The center snaps to whole texels, or to a coarse grid for cached cascades, so the
+			// projection only moves in those steps. The box is grown by one step to still hold the sphere
+			int snapTexels = c >= FIRST_CACHED_CASCADE ? mResolution / CACHED_SNAP_DIVISIONS : 1;
+			float halfSize = radius / (1.0f - 2.0f * snapTexels / mResolution);
+			float snap = 2.0f * halfSize * snapTexels / mResolution;
+			glm::vec3 lightCenter = glm::vec3(lightView * glm::vec4(center, 1.0f));
+			lightCenter.x = glm::floor(lightCenter.x / snap) * snap;
+			lightCenter.y = glm::floor(lightCenter.y / snap) * snap;
+
+			glm::mat4 projection = glm::ortho(lightCenter.x - halfSize, lightCenter.x + halfSize, lightCenter.y - halfSize, lightCenter.y + halfSize, zNear, zFar);
+			glm::mat4 viewProjection = projection * lightView;
+			if (!mCachingEnabled || viewProjection != mViewProjections[c]) { mDirtyMask |= 1 << c; }
+
+			mViewProjections[c] = viewProjection;
+			mHalfSizes[c] = halfSize;
+			mSplits[c] = sliceFar;
+			uniforms.viewProjections[c] = viewProjection;
+			uniforms.splits[c] = sliceFar;
+			// Texels grow with the cascade, the bias was tuned for one map around the whole scene
+			uniforms.biasScales[c] = sceneRadius > 0.0f ? halfSize / sceneRadius : 1.0f;
+			sliceNear = sliceFar;
+		}
+		mUniforms.update(uniforms);
+	}
+
+	void CascadedShadows::invalidate(glm::vec3 center, float radius)
+	{
+		for (int c = 0; c < NUM_CASCADES; c++)
+		{
+			// Not fitted yet, the first update renders every cascade anyway
+			if (mHalfSizes[c] <= 0.0f)
+			{
+				mDirtyMask |= 1 << c;
+				continue;
+			}
+			glm::vec4 position = mViewProjections[c] * glm::vec4(center, 1.0f);
+			float extent = 1.0f + radius / mHalfSizes[c];
+			if (glm::abs(position.x) <= extent && glm::abs(position.y) <= extent) { mDirtyMask |= 1 << c; }
+		}
+	}
+
+	void CascadedShadows::cull(Mesh& mesh, GLuint instanceBuffer, int numInstances, const glm::mat4& model, float instanceRadius)
+	{
+		std::vector<ShadowCasterDraws::View> views;
+		for (int c = 0; c < NUM_CASCADES; c++)
+		{
+			if (mDirtyMask & (1 << c)) { views.push_back({ mViewProjections[c], c }); }
+		}
+		mCasters.cull(mesh, instanceBuffer, numInstances, model, instanceRadius, views);
+	}
+
+	void CascadedShadows::render(Mesh& mesh, GLuint instanceBuffer, const glm::mat4& model)
+	{
+		// Cached layers keep their depth
+		const float farDepth = 1.0f;
+		for (int c = 0; c < NUM_CASCADES; c++)
+		{
+			if (mDirtyMask & (1 << c)) { glClearTexSubImage(mTexture, 0, 0, 0, c, mResolution, mResolution, 1, GL_DEPTH_COMPONENT, GL_FLOAT, &farDepth); }
+		}
+
+		glViewport(0, 0, mResolution, mResolution);
+		glBindFramebuffer(GL_FRAMEBUFFER, mFramebuffers[0]);
+		mCasters.draw(mesh, instanceBuffer, model, [this](int view) {
+			glBindFramebuffer(GL_FRAMEBUFFER, mFramebuffers[mCasters.getView(view).target]);
+		});
+
+		mNumRendered = mCasters.getNumViews();
+		mDirtyMask = 0;
+	}
+}
@@ -0,0 +1,123 @@
+#pragma once
+#include <GL/glew.h>
+#include "Shader.h"
+#include "Mesh.h"
+#include "Camera.h"
+#include "UniformBuffer.h"
+#include "ShadowCasterDraws.h"
+
+namespace ew {
+	/// <summary>
+	/// Cascaded shadow maps for a directional light over one instanced mesh.
+	/// The view distance is split into NUM_CASCADES slices, each covered by an orthographic
+	/// light projection fit around the slice's bounding sphere and rendered into a layer of
+	/// a depth texture array.
+	/// Casters are culled per cascade and drawn by ShadowCasterDraws, every cascade in one
+	/// layered draw where supported.
+	/// A cascade is only rendered again when its projection changes or casters inside it do.
+	/// Distant cascades snap to a coarse grid, trading some resolution for a projection that
+	/// stays put while the camera moves, so they're mostly read from the cache.
+	/// </summary>
+	class CascadedShadows {
+	public:
+		// Must match NUM_CASCADES in the shaders
+		static const int NUM_CASCADES = 4;
+
+		/// <summary>
+		/// Casters are drawn with depthFragmentShaderPath. uniformBinding is the binding of
+		/// the ShadowData block, resolution the size of each cascade
+		/// </summary>
+		CascadedShadows(std::string cullShaderPath, std::string vertexShaderPath, std::string depthFragmentShaderPath, GLuint uniformBinding, int resolution, int maxInstances);
+		~CascadedShadows();
+		bool isReady() { return mCasters.isReady(); }
+
+		/// <summary>
+		/// Fits the cascades to the camera and uploads the ShadowData block. Cascades whose
+		/// projection changed are marked for rendering. lightDirection points towards the light,
+		/// the scene sphere holds every caster
+		/// </summary>
+		void update(Camera& camera, glm::vec3 lightDirection, glm::vec3 sceneCenter, float sceneRadius);
+		/// <summary>
+		/// Any cascade to render this frame
+		/// </summary>
+		bool needsRender() const { return mDirtyMask != 0; }
+		/// <summary>
+		/// Bit per cascade the next render draws
+		/// </summary>
+		GLuint getDirtyMask() const { return mDirtyMask; }
+		/// <summary>
+		/// Appends the instances inside each cascade to be rendered. instanceBuffer holds a
+		/// tightly packed vec3 offset per instance, moved by model. instanceRadius bounds the
+		/// mesh around each offset, in world units
+		/// </summary>
+		void cull(Mesh& mesh, GLuint instanceBuffer, int numInstances, const glm::mat4& model, float instanceRadius);
+		/// <summary>
+		/// Clears and renders the cascades marked by update, with the lists from cull
+		/// </summary>
+		void render(Mesh& mesh, GLuint instanceBuffer, const glm::mat4& model);
+
+		/// <summary>
+		/// Casters changed, every cascade is rendered again
+		/// </summary>
+		void invalidate() { mDirtyMask = (1 << NUM_CASCADES) - 1; }
+		/// <summary>
+		/// A caster in this sphere changed, cascades that can see it are rendered again
+		/// </summary>
+		void invalidate(glm::vec3 center, float radius);
+		/// <summary>
+		/// Off, every cascade is rendered every frame
+		/// </summary>
+		void setCachingEnabled(bool enabled) { mCachingEnabled = enabled; }
+		void setShadowDistance(float distance) { mShadowDistance = distance; }
+		float getShadowDistance() const { return mShadowDistance; }
+
+		bool isLayered() const { return mCasters.isMultiDraw(); }
+		Shader& getCullShader() { return mCasters.getCullShader(); }
+		Shader& getDrawShader() { return mCasters.getDrawShader(); }
+		GLuint getTexture() const { return mTexture; }
+		GLuint getDrawBuffer() const { return mCasters.getDrawBuffer(); }
+		GLuint getCasterBuffer() const { return mCasters.getCasterBuffer(); }
+		/// <summary>
+		/// Far edge of the cascade in view distance
+		/// </summary>
+		float getSplit(int cascade) const { return mSplits[cascade]; }
+		/// <summary>
+		/// Cascades rendered by the last render call
+		/// </summary>
+		int getNumRendered() const { return mNumRendered; }
+		/// <summary>
+		/// Instances drawn into the cascade the last time it was rendered, read back a few frames late
+		/// </summary>
+		GLuint getNumCasters(int cascade) const { return mCasters.getNumCasters(cascade); }
+	private:
+		CascadedShadows(const CascadedShadows& r) = delete;
+		// Cascades from here on snap to 1/CACHED_SNAP_DIVISIONS of their width rather than to a texel
+		static const int FIRST_CACHED_CASCADE = 2;
+		static const int CACHED_SNAP_DIVISIONS = 16;
+		// Blend of logarithmic and even splits, and the near distance they start from
+		static constexpr float SPLIT_LAMBDA = 0.75f;
+		static constexpr float MIN_SPLIT_NEAR = 0.5f;
+
+		// std140 mirror of the ShadowData block
+		struct ShadowUniforms {
+			glm::mat4 viewProjections[NUM_CASCADES];
+			float splits[NUM_CASCADES];
+			float biasScales[NUM_CASCADES];
+		};
+
+		ShadowCasterDraws mCasters;
+		UniformBuffer mUniforms;
+		int mResolution;
+		GLuint mTexture;
+		// One framebuffer with every layer attached, or one per layer when not layered
+		GLuint mFramebuffers[NUM_CASCADES] = {};
+
+		glm::mat4 mViewProjections[NUM_CASCADES] = {};
+		float mHalfSizes[NUM_CASCADES] = {};
+		float mSplits[NUM_CASCADES] = {};
+		GLuint mDirtyMask = (1 << NUM_CASCADES) - 1;
+		bool mCachingEnabled = true;
+		float mShadowDistance = 250.0f;
+		int mNumRendered = 0;
+	};
+}
@@ -0,0 +1,53 @@
+#include "DynamicResolution.h"
+#include <algorithm>
+#include <cmath>
+
+namespace ew {
+	DynamicResolution::DynamicResolution(float targetMilliseconds, float minScale, float maxScale)
+		: mTargetMilliseconds(targetMilliseconds), mMinScale(minScale), mMaxScale(maxScale), mScale(maxScale)
+	{
+	}
+
+	float DynamicResolution::update(double gpuMilliseconds)
+	{
+		// No measurement yet (the timers lag a few frames)
+		if (gpuMilliseconds <= 0.0) { return mScale; }
+
+		mSmoothedMilliseconds = mSmoothedMilliseconds <= 0.0 ? gpuMilliseconds : mSmoothedMilliseconds * 0.8 + gpuMilliseconds * 0.2;
+		if (mCooldown > 0)
+		{
+			mCooldown--;
+			return mScale;
+		}
+
+		bool overBudget = mSmoothedMilliseconds > mTargetMilliseconds;
+		bool underBudget = mSmoothedMilliseconds < mTargetMilliseconds * HEADROOM;
+		if (!overBudget && !underBudget) { return mScale; }
+
+		float desired = mScale * (float)std::sqrt(mTargetMilliseconds / mSmoothedMilliseconds);
+		// Rounded down, so a step never lands over the budget
+		float quantized = std::floor(desired / SCALE_STEP + 0.001f) * SCALE_STEP;
+		quantized = std::clamp(quantized, mMinScale, mMaxScale);
+
+		if (std::abs(quantized - mScale) >= SCALE_STEP * 0.5f)
+		{
+			mScale = quantized;
+			mCooldown = COOLDOWN_FRAMES;
+			// Those times were measured at the old scale
+			mSmoothedMilliseconds = 0.0;
+		}
+		return mScale;
+	}
+
+	void DynamicResolution::setScaleRange(float minScale, float maxScale)
+	{
+		mMinScale = minScale;
+		mMaxScale = std::max(minScale, maxScale);
+		mScale = std::clamp(mScale, mMinScale, mMaxScale);
+	}
+
+	int DynamicResolution::getScaledSize(int size, float scale)
+	{
+		return std::max(1, (int)std::lround(size * scale));
+	}
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+namespace ew {
+	/// <summary>
+	/// Picks the render scale for the next frame from measured GPU frame times.
+	/// Cost is taken as proportional to pixel count, so the scale moves by the square root
+	/// of the time ratio. Times are smoothed, the scale is quantized to SCALE_STEP and only
+	/// changed once the timer queries have caught up with the previous change, so it
+	/// settles instead of oscillating.
+	/// </summary>
+	class DynamicResolution {
+	public:
+		DynamicResolution(float targetMilliseconds = 16.6f, float minScale = 0.5f, float maxScale = 1.0f);
+		/// <summary>
+		/// Feeds one frame's GPU time and returns the scale to render the next frame at
+		/// </summary>
+		float update(double gpuMilliseconds);
+		void reset() { mScale = mMaxScale; mSmoothedMilliseconds = 0.0; mCooldown = 0; }
+
+		float getScale() const { return mScale; }
+		double getSmoothedMilliseconds() const { return mSmoothedMilliseconds; }
+		float getTargetMilliseconds() const { return mTargetMilliseconds; }
+		void setTargetMilliseconds(float target) { mTargetMilliseconds = target; }
+		void setScaleRange(float minScale, float maxScale);
+		/// <summary>
+		/// size * scale, at least 1
+		/// </summary>
+		int getScaledSize(int size) const { return getScaledSize(size, mScale); }
+		static int getScaledSize(int size, float scale);
+
+		static constexpr float SCALE_STEP = 0.05f;
+	private:
+		// Frames to wait after a change, longer than GpuTimer's query latency
+		static const int COOLDOWN_FRAMES = 8;
+		// Only scale back up once comfortably under the target
+		static constexpr float HEADROOM = 0.85f;
+
+		float mTargetMilliseconds;
+		float mMinScale;
+		float mMaxScale;
+		float mScale;
+		double mSmoothedMilliseconds = 0.0;
+		int mCooldown = 0;
+	};
+}
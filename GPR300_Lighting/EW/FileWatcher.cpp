@@ -0,0 +1,108 @@
+#include "FileWatcher.h"
+#include <algorithm>
+#include <stdio.h>
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+namespace ew {
+	FileWatcher::FileWatcher()
+	{
+#ifdef __linux__
+		mInotify = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+		if (mInotify < 0)
+		{
+			printf("FileWatcher: inotify unavailable\n");
+		}
+#else
+		mLastPoll = std::chrono::steady_clock::now();
+#endif
+	}
+
+	FileWatcher::~FileWatcher()
+	{
+#ifdef __linux__
+		if (mInotify >= 0) { close(mInotify); }
+#endif
+	}
+
+	std::string FileWatcher::normalize(const std::string& filePath)
+	{
+		return std::filesystem::path(filePath).lexically_normal().generic_string();
+	}
+
+	void FileWatcher::addFile(const std::string& filePath)
+	{
+		std::string normalized = normalize(filePath);
+		mFiles[normalized] = filePath;
+
+#ifdef __linux__
+		if (mInotify < 0) { return; }
+
+		// Directories are watched rather than files, since editors often save by
+		// writing a temporary and renaming it over the original
+		std::string directory = std::filesystem::path(normalized).parent_path().generic_string();
+		if (directory.empty()) { directory = "."; }
+
+		int watch = inotify_add_watch(mInotify, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE);
+		if (watch < 0)
+		{
+			printf("FileWatcher: can't watch %s\n", directory.c_str());
+			return;
+		}
+		mDirectories[watch] = directory;
+#else
+		std::error_code error;
+		mWriteTimes[normalized] = std::filesystem::last_write_time(normalized, error);
+#endif
+	}
+
+	std::vector<std::string> FileWatcher::poll()
+	{
+		std::vector<std::string> changed;
+
+#ifdef __linux__
+		if (mInotify < 0) { return changed; }
+
+		alignas(inotify_event) char buffer[4096];
+		while (true)
+		{
+			ssize_t length = read(mInotify, buffer, sizeof(buffer));
+			if (length <= 0) { break; }
+
+			for (char* event = buffer; event < buffer + length; )
+			{
+				const inotify_event* notification = (const inotify_event*)event;
+				event += sizeof(inotify_event) + notification->len;
+
+				auto directory = mDirectories.find(notification->wd);
+				if (directory == mDirectories.end() || notification->len == 0) { continue; }
+
+				std::string path = normalize(directory->second + "/" + notification->name);
+				auto file = mFiles.find(path);
+				if (file != mFiles.end() && std::find(changed.begin(), changed.end(), file->second) == changed.end())
+				{
+					changed.push_back(file->second);
+				}
+			}
+		}
+#else
+		auto now = std::chrono::steady_clock::now();
+		if (now - mLastPoll < POLL_INTERVAL) { return changed; }
+		mLastPoll = now;
+
+		for (auto& file : mWriteTimes)
+		{
+			std::error_code error;
+			std::filesystem::file_time_type writeTime = std::filesystem::last_write_time(file.first, error);
+			if (!error && writeTime != file.second)
+			{
+				file.second = writeTime;
+				changed.push_back(mFiles[file.first]);
+			}
+		}
+#endif
+		return changed;
+	}
+}
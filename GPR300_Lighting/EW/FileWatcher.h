@@ -0,0 +1,39 @@
+#pragma once
+#include <chrono>
+#include <filesystem>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace ew {
+	/// <summary>
+	/// Reports files that were written since the last poll. Uses inotify on Linux, which
+	/// costs nothing until something changes; elsewhere the files' last write times are
+	/// compared, at most every POLL_INTERVAL.
+	/// </summary>
+	class FileWatcher {
+	public:
+		FileWatcher();
+		~FileWatcher();
+		void addFile(const std::string& filePath);
+		/// <summary>
+		/// Never blocks. Paths are returned exactly as they were passed to addFile
+		/// </summary>
+		std::vector<std::string> poll();
+	private:
+		FileWatcher(const FileWatcher& r) = delete;
+		static std::string normalize(const std::string& filePath);
+
+		// Normalized path -> path as given
+		std::unordered_map<std::string, std::string> mFiles;
+#ifdef __linux__
+		int mInotify;
+		// Watch descriptor -> normalized directory
+		std::unordered_map<int, std::string> mDirectories;
+#else
+		static constexpr std::chrono::milliseconds POLL_INTERVAL = std::chrono::milliseconds(250);
+		std::unordered_map<std::string, std::filesystem::file_time_type> mWriteTimes;
+		std::chrono::steady_clock::time_point mLastPoll;
+#endif
+	};
+}
@@ -0,0 +1,201 @@
+#include "FrameGraph.h"
+
+namespace ew {
+	FrameGraphResource FrameGraph::Builder::createTexture(const std::string& name, int width, int height, GLenum format)
+	{
+		mGraph.mResources.push_back({ name, false, false, width, height, format, 0 });
+		return write({ (int)mGraph.mResources.size() - 1 });
+	}
+
+	FrameGraphResource FrameGraph::Builder::read(FrameGraphResource resource, FrameGraphAccess access)
+	{
+		mGraph.mPasses[mPass].accesses.push_back({ resource.id, access, false });
+		return resource;
+	}
+
+	FrameGraphResource FrameGraph::Builder::write(FrameGraphResource resource, FrameGraphAccess access)
+	{
+		mGraph.mPasses[mPass].accesses.push_back({ resource.id, access, true });
+		return resource;
+	}
+
+	void FrameGraph::Builder::setSideEffect()
+	{
+		mGraph.mPasses[mPass].sideEffect = true;
+	}
+
+	FrameGraph::FrameGraph(RenderTargetPool& pool) : mPool(pool)
+	{
+	}
+
+	FrameGraphResource FrameGraph::importTexture(const std::string& name, GLuint texture)
+	{
+		mResources.push_back({ name, true, false, 0, 0, 0, texture });
+		return { (int)mResources.size() - 1 };
+	}
+
+	FrameGraphResource FrameGraph::importBuffer(const std::string& name, GLuint buffer)
+	{
+		mResources.push_back({ name, true, true, 0, 0, 0, buffer });
+		return { (int)mResources.size() - 1 };
+	}
+
+	void FrameGraph::addPass(const std::string& name, const std::function<void(Builder&)>& setup, const std::function<void(const FrameGraph&)>& execute)
+	{
+		Pass pass;
+		pass.name = name;
+		pass.execute = execute;
+		mPasses.push_back(pass);
+
+		Builder builder(*this, (int)mPasses.size() - 1);
+		setup(builder);
+	}
+
+	GLuint FrameGraph::getTexture(FrameGraphResource resource) const
+	{
+		return resource.isValid() ? mResources[resource.id].id : 0;
+	}
+
+	GLuint FrameGraph::getFramebuffer(FrameGraphResource color, FrameGraphResource depth) const
+	{
+		GLuint colorTexture = getTexture(color);
+		GLuint depthTexture = getTexture(depth);
+		if (colorTexture == 0 && depthTexture == 0) { return 0; }
+		return mPool.getFramebuffer(colorTexture, depthTexture);
+	}
+
+	GLuint FrameGraph::getFramebuffer(const std::vector<FrameGraphResource>& colors, FrameGraphResource depth) const
+	{
+		std::vector<GLuint> colorTextures;
+		for (FrameGraphResource color : colors) { colorTextures.push_back(getTexture(color)); }
+		return mPool.getFramebuffer(colorTextures, getTexture(depth));
+	}
+
+	void FrameGraph::cull()
+	{
+		// Walking backwards, a pass lives if a living later pass uses anything it writes.
+		// Passes only see resources declared before them, so declaration order is already
+		// a valid execution order
+		std::vector<bool> needed(mResources.size(), false);
+		for (int p = (int)mPasses.size() - 1; p >= 0; p--)
+		{
+			Pass& pass = mPasses[p];
+			pass.alive = pass.sideEffect;
+			for (const Access& access : pass.accesses)
+			{
+				if (access.write && (needed[access.resource] || mResources[access.resource].imported)) { pass.alive = true; }
+			}
+			if (!pass.alive) { continue; }
+
+			// Writes count too: a pass that draws over a target keeps what was drawn before it
+			for (const Access& access : pass.accesses) { needed[access.resource] = true; }
+		}
+	}
+
+	void FrameGraph::execute()
+	{
+		cull();
+
+		// Lifetimes over the surviving passes only
+		std::vector<int> firstUse(mResources.size(), -1);
+		std::vector<int> lastUse(mResources.size(), -1);
+		for (int p = 0; p < (int)mPasses.size(); p++)
+		{
+			if (!mPasses[p].alive) { continue; }
+			for (const Access& access : mPasses[p].accesses)
+			{
+				if (firstUse[access.resource] < 0) { firstUse[access.resource] = p; }
+				lastUse[access.resource] = p;
+			}
+		}
+
+		// Which resources have had a Storage write, and the barrier bits issued since
+		std::vector<bool> storageWritten(mResources.size(), false);
+		std::vector<GLbitfield> visibleBits(mResources.size(), 0);
+
+		mTimings.clear();
+		mNumBarriers = 0;
+		for (int p = 0; p < (int)mPasses.size(); p++)
+		{
+			Pass& pass = mPasses[p];
+			if (!pass.alive)
+			{
+				mTimings.push_back({ pass.name, 0.0, true });
+				continue;
+			}
+
+			GLbitfield barrier = 0;
+			for (const Access& access : pass.accesses)
+			{
+				Resource& resource = mResources[access.resource];
+				// A pass can list a resource more than once
+				if (firstUse[access.resource] == p && !resource.imported && resource.id == 0)
+				{
+					resource.id = mPool.acquire(resource.width, resource.height, resource.format);
+				}
+
+				GLbitfield bit = getBarrierBit(access.access, resource.isBuffer);
+				if (storageWritten[access.resource] && !(visibleBits[access.resource] & bit)) { barrier |= bit; }
+			}
+
+			if (barrier != 0)
+			{
+				glMemoryBarrier(barrier);
+				mNumBarriers++;
+				// Barriers are global, everything written so far is now visible to these accesses
+				for (size_t r = 0; r < mResources.size(); r++) { visibleBits[r] |= barrier; }
+			}
+
+			for (const Access& access : pass.accesses)
+			{
+				if (access.write && access.access == FrameGraphAccess::Storage)
+				{
+					storageWritten[access.resource] = true;
+					visibleBits[access.resource] = 0;
+				}
+			}
+
+			GpuTimer* timer = nullptr;
+			if (mTimingEnabled)
+			{
+				std::unique_ptr<GpuTimer>& passTimer = mTimers[pass.name];
+				if (passTimer == nullptr) { passTimer = std::make_unique<GpuTimer>(); }
+				timer = passTimer.get();
+				timer->begin();
+			}
+
+			pass.execute(*this);
+
+			if (timer != nullptr) { timer->end(); }
+			mTimings.push_back({ pass.name, timer != nullptr ? timer->getMilliseconds() : 0.0, false });
+
+			for (const Access& access : pass.accesses)
+			{
+				Resource& resource = mResources[access.resource];
+				if (lastUse[access.resource] == p && !resource.imported && resource.id != 0)
+				{
+					mPool.release(resource.id);
+					resource.id = 0;
+				}
+			}
+		}
+
+		mPasses.clear();
+		mResources.clear();
+	}
+
+	GLbitfield FrameGraph::getBarrierBit(FrameGraphAccess access, bool isBuffer)
+	{
+		switch (access)
+		{
+		case FrameGraphAccess::Attachment: return GL_FRAMEBUFFER_BARRIER_BIT;
+		case FrameGraphAccess::Sampled: return GL_TEXTURE_FETCH_BARRIER_BIT;
+		case FrameGraphAccess::Storage: return isBuffer ? GL_SHADER_STORAGE_BARRIER_BIT : GL_SHADER_IMAGE_ACCESS_BARRIER_BIT;
+		case FrameGraphAccess::Blit: return isBuffer ? GL_BUFFER_UPDATE_BARRIER_BIT : GL_FRAMEBUFFER_BARRIER_BIT;
+		case FrameGraphAccess::Uniform: return GL_UNIFORM_BARRIER_BIT;
+		case FrameGraphAccess::Vertex: return GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT | GL_ELEMENT_ARRAY_BARRIER_BIT;
+		case FrameGraphAccess::Indirect: return GL_COMMAND_BARRIER_BIT;
+		}
+		return GL_ALL_BARRIER_BITS;
+	}
+}
@@ -0,0 +1,149 @@
+#pragma once
+#include <GL/glew.h>
+#include "RenderTargetPool.h"
+#include "GpuTimer.h"
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace ew {
+	/// <summary>
+	/// How a pass touches a resource. Storage (image/SSBO) writes are the only incoherent
+	/// ones, the access of the next pass to read them decides the glMemoryBarrier bit
+	/// </summary>
+	enum class FrameGraphAccess {
+		Attachment,
+		Sampled,
+		Storage,
+		Blit,
+		Uniform,
+		Vertex,
+		Indirect
+	};
+
+	struct FrameGraphResource {
+		int id = -1;
+		bool isValid() const { return id >= 0; }
+	};
+
+	/// <summary>
+	/// One frame's passes, declared with the resources they read and write, then run in
+	/// declaration order. Rebuilt every frame: passes are added, then execute culls the
+	/// ones nothing depends on, acquires transient textures from a RenderTargetPool just
+	/// before their first use and releases them right after their last (so passes that
+	/// don't overlap share memory), issues only the memory barriers that are needed and
+	/// times each pass on the GPU.
+	/// A pass is kept when it's marked as having a side effect, writes an imported
+	/// resource (the backbuffer included), or writes something a kept pass reads.
+	/// </summary>
+	class FrameGraph {
+	public:
+		/// <summary>
+		/// Handed to a pass's setup to declare what it uses
+		/// </summary>
+		class Builder {
+		public:
+			/// <summary>
+			/// Transient texture, only allocated if a pass using it survives culling.
+			/// The creating pass is its first writer
+			/// </summary>
+			FrameGraphResource createTexture(const std::string& name, int width, int height, GLenum format);
+			FrameGraphResource read(FrameGraphResource resource, FrameGraphAccess access = FrameGraphAccess::Sampled);
+			FrameGraphResource write(FrameGraphResource resource, FrameGraphAccess access = FrameGraphAccess::Attachment);
+			/// <summary>
+			/// Kept even when nothing reads what it writes
+			/// </summary>
+			void setSideEffect();
+		private:
+			friend class FrameGraph;
+			Builder(FrameGraph& graph, int pass) : mGraph(graph), mPass(pass) {}
+			FrameGraph& mGraph;
+			int mPass;
+		};
+
+		struct PassTiming {
+			std::string name;
+			double gpuMilliseconds;
+			bool culled;
+		};
+
+		FrameGraph(RenderTargetPool& pool);
+
+		FrameGraphResource importTexture(const std::string& name, GLuint texture);
+		FrameGraphResource importBuffer(const std::string& name, GLuint buffer);
+		/// <summary>
+		/// The default framebuffer, as texture 0
+		/// </summary>
+		FrameGraphResource importBackbuffer() { return importTexture("Backbuffer", 0); }
+
+		/// <summary>
+		/// setup runs right away, execute during execute() if the pass isn't culled
+		/// </summary>
+		void addPass(const std::string& name, const std::function<void(Builder&)>& setup, const std::function<void(const FrameGraph&)>& execute);
+
+		/// <summary>
+		/// Only valid inside a pass's execute
+		/// </summary>
+		GLuint getTexture(FrameGraphResource resource) const;
+		GLuint getBuffer(FrameGraphResource resource) const { return getTexture(resource); }
+		/// <summary>
+		/// Framebuffer with these attachments, 0 for the backbuffer
+		/// </summary>
+		GLuint getFramebuffer(FrameGraphResource color, FrameGraphResource depth = FrameGraphResource()) const;
+		/// <summary>
+		/// Framebuffer drawing to every color, in order from GL_COLOR_ATTACHMENT0
+		/// </summary>
+		GLuint getFramebuffer(const std::vector<FrameGraphResource>& colors, FrameGraphResource depth = FrameGraphResource()) const;
+
+		/// <summary>
+		/// Culls, runs the surviving passes and clears the graph for the next frame
+		/// </summary>
+		void execute();
+
+		void setTimingEnabled(bool enabled) { mTimingEnabled = enabled; }
+		/// <summary>
+		/// Every pass of the last executed frame, in order. GPU times lag a few frames
+		/// </summary>
+		const std::vector<PassTiming>& getPassTimings() const { return mTimings; }
+		int getNumBarriers() const { return mNumBarriers; }
+	private:
+		FrameGraph(const FrameGraph& r) = delete;
+
+		struct Access {
+			int resource;
+			FrameGraphAccess access;
+			bool write;
+		};
+
+		struct Pass {
+			std::string name;
+			std::function<void(const FrameGraph&)> execute;
+			std::vector<Access> accesses;
+			bool sideEffect = false;
+			bool alive = false;
+		};
+
+		struct Resource {
+			std::string name;
+			bool imported;
+			bool isBuffer;
+			int width;
+			int height;
+			GLenum format;
+			GLuint id;
+		};
+
+		static GLbitfield getBarrierBit(FrameGraphAccess access, bool isBuffer);
+		void cull();
+
+		RenderTargetPool& mPool;
+		std::vector<Pass> mPasses;
+		std::vector<Resource> mResources;
+		std::map<std::string, std::unique_ptr<GpuTimer>> mTimers;
+		std::vector<PassTiming> mTimings;
+		bool mTimingEnabled = true;
+		int mNumBarriers = 0;
+	};
+}
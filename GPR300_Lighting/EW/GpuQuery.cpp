@@ -0,0 +1,42 @@
+#include "GpuQuery.h"
+
+namespace ew {
+	GpuQuery::GpuQuery(GLenum target) : mTarget(target)
+	{
+		// Typed on their first glBeginQuery. Some drivers reject pipeline statistic targets in glCreateQueries
+		glGenQueries(NUM_QUERIES, mQueries);
+	}
+
+	GpuQuery::~GpuQuery()
+	{
+		glDeleteQueries(NUM_QUERIES, mQueries);
+	}
+
+	void GpuQuery::begin()
+	{
+		// Collect whatever has finished, oldest first, before reusing a query
+		for (int i = 1; i <= NUM_QUERIES; i++)
+		{
+			int index = (mCurrent + i) % NUM_QUERIES;
+			if (!mPending[index]) { continue; }
+
+			GLint available = 0;
+			glGetQueryObjectiv(mQueries[index], GL_QUERY_RESULT_AVAILABLE, &available);
+			if (!available) { continue; }
+
+			glGetQueryObjectui64v(mQueries[index], GL_QUERY_RESULT, &mResult);
+			mPending[index] = false;
+		}
+
+		mCurrent = (mCurrent + 1) % NUM_QUERIES;
+		// Out of queries, the oldest is dropped rather than waited on
+		mPending[mCurrent] = false;
+		glBeginQuery(mTarget, mQueries[mCurrent]);
+	}
+
+	void GpuQuery::end()
+	{
+		glEndQuery(mTarget);
+		mPending[mCurrent] = true;
+	}
+}
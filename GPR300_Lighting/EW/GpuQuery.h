@@ -0,0 +1,29 @@
+#pragma once
+#include <GL/glew.h>
+
+namespace ew {
+	/// <summary>
+	/// A query of target (GL_TIME_ELAPSED, GL_SAMPLES_PASSED, a pipeline statistic...) around
+	/// a span of GPU work. Results are read a few frames late from a small ring of queries,
+	/// so reading never stalls the pipeline.
+	/// </summary>
+	class GpuQuery {
+	public:
+		GpuQuery(GLenum target);
+		~GpuQuery();
+		void begin();
+		void end();
+		/// <summary>
+		/// Most recent finished result, 0 until one has come back
+		/// </summary>
+		GLuint64 getResult() const { return mResult; }
+	private:
+		GpuQuery(const GpuQuery& r) = delete;
+		static const int NUM_QUERIES = 4;
+		GLenum mTarget;
+		GLuint mQueries[NUM_QUERIES];
+		bool mPending[NUM_QUERIES] = {};
+		int mCurrent = 0;
+		GLuint64 mResult = 0;
+	};
+}
@@ -0,0 +1,20 @@
+#pragma once
+#include "GpuQuery.h"
+
+namespace ew {
+	/// <summary>
+	/// GL_TIME_ELAPSED GpuQuery around a span of GPU work, in milliseconds
+	/// </summary>
+	class GpuTimer {
+	public:
+		GpuTimer() : mQuery(GL_TIME_ELAPSED) {}
+		void begin() { mQuery.begin(); }
+		void end() { mQuery.end(); }
+		/// <summary>
+		/// Most recent finished measurement, 0 until one has come back
+		/// </summary>
+		double getMilliseconds() const { return mQuery.getResult() / 1000000.0; }
+	private:
+		GpuQuery mQuery;
+	};
+}
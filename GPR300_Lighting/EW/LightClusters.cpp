@@ -0,0 +1,103 @@
+#include "LightClusters.h"
+#include <vector>
+
+namespace ew {
+	// Offsets into the ClusterLights buffer, counted in uints
+	const GLintptr CLUSTER_COUNTS = 0;
+	const GLintptr CLUSTER_REFERENCES = 2 * LightClusters::NUM_CLUSTERS;
+	const GLintptr CLUSTER_INDICES = 3 * LightClusters::NUM_CLUSTERS + 1;
+
+	LightClusters::LightClusters(std::string computeShaderPath, GLuint uniformBinding, GLuint clusterBinding, int maxLightReferences)
+		: mShader(computeShaderPath),
+		mMaxLightReferences(maxLightReferences),
+		mClusterData(uniformBinding, sizeof(ClusterData)),
+		mClusterBinding(clusterBinding)
+	{
+		glCreateBuffers(1, &mClusterBuffer);
+		glNamedBufferStorage(mClusterBuffer, sizeof(GLuint) * (CLUSTER_INDICES + maxLightReferences), nullptr, GL_DYNAMIC_STORAGE_BIT);
+		// Empty until the first build
+		glClearNamedBufferData(mClusterBuffer, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, nullptr);
+		glCreateBuffers(1, &mReadbackBuffer);
+		glNamedBufferStorage(mReadbackBuffer, sizeof(GLuint) * (CLUSTER_REFERENCES + 1), nullptr, GL_CLIENT_STORAGE_BIT);
+	}
+
+	LightClusters::~LightClusters()
+	{
+		if (mReadbackFence != nullptr) { glDeleteSync(mReadbackFence); }
+		glDeleteBuffers(1, &mReadbackBuffer);
+		glDeleteBuffers(1, &mClusterBuffer);
+	}
+
+	void LightClusters::build(Camera& camera, int width, int height, StorageBuffer& lights, int numLights)
+	{
+		readCounts();
+
+		float nearPlane = camera.getNearPlane();
+		float farPlane = camera.getFarPlane();
+		float nearSliceEnd = glm::clamp(mNearSliceEnd, nearPlane * 2.0f, farPlane * 0.5f);
+		// Slice 1 starts at nearSliceEnd and the last ends at the far plane, evenly in log(depth)
+		float sliceScale = (GRID_Z - 1) / logf(farPlane / nearSliceEnd);
+		float tanHalfY = tanf(glm::radians(camera.getFov()) * 0.5f);
+
+		ClusterData data = {};
+		data.view = camera.getViewMatrix();
+		data.scale = glm::vec4((float)GRID_X / width, (float)GRID_Y / height, sliceScale, -logf(nearSliceEnd) * sliceScale);
+		data.frustum = glm::vec4(tanHalfY * camera.getAspectRatio(), tanHalfY, nearPlane, farPlane);
+		data.nearSliceEnd = nearSliceEnd;
+		data.maxLightReferences = (GLuint)mMaxLightReferences;
+		mClusterData.update(data);
+		// Counts, fills and the total
+		glClearNamedBufferSubData(mClusterBuffer, GL_R32UI, 0, sizeof(GLuint) * (CLUSTER_REFERENCES + 1), GL_RED_INTEGER, GL_UNSIGNED_INT, nullptr);
+
+		bind();
+		if (numLights > 0)
+		{
+			GLuint lightGroups = (numLights + GROUP_SIZE - 1) / GROUP_SIZE;
+			mShader.setUint("_NumLights", (GLuint)numLights);
+			mShader.use();
+			lights.bind();
+			for (int pass = 0; pass < 3; pass++)
+			{
+				mShader.setInt("_Pass", pass);
+				glDispatchCompute(pass == 1 ? (NUM_CLUSTERS + GROUP_SIZE - 1) / GROUP_SIZE : lightGroups, 1, 1);
+				glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+			}
+		}
+
+		if (mReadbackFence == nullptr)
+		{
+			// The copy reads what the dispatches wrote
+			glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+			glCopyNamedBufferSubData(mClusterBuffer, mReadbackBuffer, 0, 0, sizeof(GLuint) * (CLUSTER_REFERENCES + 1));
+			mReadbackFence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		}
+	}
+
+	void LightClusters::bind()
+	{
+		mClusterData.bind();
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, mClusterBinding, mClusterBuffer);
+	}
+
+	void LightClusters::readCounts()
+	{
+		if (mReadbackFence == nullptr) { return; }
+		GLenum status = glClientWaitSync(mReadbackFence, 0, 0);
+		if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) { return; }
+
+		std::vector<GLuint> counts(CLUSTER_REFERENCES + 1);
+		glGetNamedBufferSubData(mReadbackBuffer, 0, sizeof(GLuint) * counts.size(), counts.data());
+		mStats = {};
+		for (int cluster = 0; cluster < NUM_CLUSTERS; cluster++)
+		{
+			GLuint count = counts[CLUSTER_COUNTS + cluster];
+			if (count == 0) { continue; }
+			mStats.numOccupied++;
+			mStats.maxLights = glm::max(mStats.maxLights, (int)count);
+		}
+		mStats.numReferences = (int)counts[CLUSTER_REFERENCES];
+		mStats.numDropped = glm::max(mStats.numReferences - mMaxLightReferences, 0);
+		glDeleteSync(mReadbackFence);
+		mReadbackFence = nullptr;
+	}
+}
@@ -0,0 +1,100 @@
+#pragma once
+#include <GL/glew.h>
+#include "Shader.h"
+#include "Camera.h"
+#include "UniformBuffer.h"
+#include "StorageBuffer.h"
+
+namespace ew {
+	/// <summary>
+	/// Clustered forward lighting. The view frustum is split into a grid of cells, GRID_X by
+	/// GRID_Y across the screen and GRID_Z slices growing logarithmically with depth, and a
+	/// compute pass (shaders/lightClusters.comp) lists every local light in the cells its
+	/// bounding volume reaches. The lit shader then only shades its cell's lights, so
+	/// thousands of lights cost what the few around each pixel do.
+	/// The cells' lists are packed into one index list sized for the whole grid, a crowded
+	/// cell takes what the empty ones leave.
+	/// The lit shader reads the lists through the ClusterData block and the ClusterLights
+	/// storage buffer, bound by build.
+	/// </summary>
+	class LightClusters {
+	public:
+		// Must match lightClusters.comp and defaultLit.frag
+		static const int GRID_X = 16;
+		static const int GRID_Y = 9;
+		static const int GRID_Z = 24;
+		static const int NUM_CLUSTERS = GRID_X * GRID_Y * GRID_Z;
+
+		/// <summary>
+		/// uniformBinding and clusterBinding are the bindings of the ClusterData block and the
+		/// ClusterLights buffer. The cells list up to maxLightReferences lights between them, the
+		/// lists of cells reserved after that are cut short
+		/// </summary>
+		LightClusters(std::string computeShaderPath, GLuint uniformBinding, GLuint clusterBinding, int maxLightReferences);
+		~LightClusters();
+		bool isReady() { return mShader.isReady(); }
+
+		/// <summary>
+		/// Bins the first numLights LocalLights of lights into the cells of camera's frustum,
+		/// for a viewport of width by height pixels
+		/// </summary>
+		void build(Camera& camera, int width, int height, StorageBuffer& lights, int numLights);
+		/// <summary>
+		/// Binds the cells' lists for the lit shader
+		/// </summary>
+		void bind();
+
+		/// <summary>
+		/// Depth where the first slice ends, the rest split what is left of the frustum.
+		/// Keeps the slices from being spent on the tiny distances right past the near plane
+		/// </summary>
+		void setNearSliceEnd(float depth) { mNearSliceEnd = depth; }
+		float getNearSliceEnd() const { return mNearSliceEnd; }
+		int getMaxLightReferences() const { return mMaxLightReferences; }
+		GLuint getClusterBuffer() const { return mClusterBuffer; }
+		Shader& getShader() { return mShader; }
+
+		/// <summary>
+		/// Counts of the last build read back, a few frames late
+		/// </summary>
+		struct Stats {
+			// Cells with at least one light, and the most lights in one
+			int numOccupied;
+			int maxLights;
+			// Lights listed over every cell, dropped ones included
+			int numReferences;
+			// References past the end of the index list
+			int numDropped;
+		};
+		const Stats& getStats() const { return mStats; }
+	private:
+		LightClusters(const LightClusters& r) = delete;
+		static const GLuint GROUP_SIZE = 64;
+
+		// std140 mirror of ClusterData in the shaders
+		struct ClusterData {
+			glm::mat4 view;
+			glm::vec4 scale;
+			glm::vec4 frustum;
+			float nearSliceEnd;
+			GLuint maxLightReferences;
+			GLuint padding[2];
+		};
+
+		void readCounts();
+
+		// Counts, reserves and fills the lists, picked by _Pass
+		Shader mShader;
+		int mMaxLightReferences;
+		float mNearSliceEnd = 5.0f;
+		UniformBuffer mClusterData;
+		// Each cell's count and fill, the total, each cell's offset, then the index list
+		GLuint mClusterBuffer;
+		GLuint mClusterBinding;
+
+		// Copy of the counts, read once the fence has passed so it never stalls
+		GLuint mReadbackBuffer;
+		GLsync mReadbackFence = nullptr;
+		Stats mStats = {};
+	};
+}
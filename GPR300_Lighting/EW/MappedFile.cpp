@@ -0,0 +1,129 @@
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace ew {
+	MappedFile::MappedFile()
+	{
+		mData = nullptr;
+		mSize = 0;
+		mFileSize = 0;
+		mIsOpen = false;
+		mView = nullptr;
+		mViewSize = 0;
+#ifdef _WIN32
+		mFile = INVALID_HANDLE_VALUE;
+		mMapping = nullptr;
+#else
+		mFile = -1;
+#endif
+	}
+
+	MappedFile::~MappedFile()
+	{
+		close();
+	}
+
+	bool MappedFile::open(const std::string& filePath)
+	{
+		close();
+
+#ifdef _WIN32
+		mFile = CreateFileA(filePath.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+		if (mFile == INVALID_HANDLE_VALUE) { return false; }
+
+		LARGE_INTEGER fileSize;
+		GetFileSizeEx(mFile, &fileSize);
+		mFileSize = (uint64_t)fileSize.QuadPart;
+
+		// Empty files can't be mapped, but are still valid to open
+		if (mFileSize > 0)
+		{
+			mMapping = CreateFileMappingA(mFile, NULL, PAGE_READONLY, 0, 0, NULL);
+			if (mMapping == nullptr) { close(); return false; }
+		}
+#else
+		mFile = ::open(filePath.c_str(), O_RDONLY);
+		if (mFile < 0) { return false; }
+
+		struct stat fileStat;
+		if (fstat(mFile, &fileStat) != 0) { close(); return false; }
+		mFileSize = (uint64_t)fileStat.st_size;
+#endif
+		mIsOpen = true;
+		return true;
+	}
+
+	bool MappedFile::map(uint64_t offset, size_t length)
+	{
+		unmap();
+		if (!mIsOpen || offset >= mFileSize) { return false; }
+
+		if (offset + length > mFileSize) { length = (size_t)(mFileSize - offset); }
+
+#ifdef _WIN32
+		SYSTEM_INFO systemInfo;
+		GetSystemInfo(&systemInfo);
+		uint64_t alignment = systemInfo.dwAllocationGranularity;
+#else
+		uint64_t alignment = (uint64_t)sysconf(_SC_PAGESIZE);
+#endif
+		// Views have to start on an allocation boundary
+		uint64_t viewOffset = offset - (offset % alignment);
+		size_t viewSize = (size_t)(offset - viewOffset) + length;
+
+#ifdef _WIN32
+		mView = MapViewOfFile(mMapping, FILE_MAP_READ, (DWORD)(viewOffset >> 32), (DWORD)(viewOffset & 0xFFFFFFFF), viewSize);
+		if (mView == nullptr) { return false; }
+#else
+		mView = mmap(nullptr, viewSize, PROT_READ, MAP_PRIVATE, mFile, (off_t)viewOffset);
+		if (mView == MAP_FAILED) { mView = nullptr; return false; }
+		madvise(mView, viewSize, MADV_SEQUENTIAL);
+#endif
+		mViewSize = viewSize;
+		mData = (const char*)mView + (offset - viewOffset);
+		mSize = length;
+		return true;
+	}
+
+	void MappedFile::unmap()
+	{
+		if (mView != nullptr)
+		{
+#ifdef _WIN32
+			UnmapViewOfFile(mView);
+#else
+			munmap(mView, mViewSize);
+#endif
+		}
+		mView = nullptr;
+		mViewSize = 0;
+		mData = nullptr;
+		mSize = 0;
+	}
+
+	void MappedFile::close()
+	{
+		unmap();
+#ifdef _WIN32
+		if (mMapping != nullptr) { CloseHandle(mMapping); }
+		if (mFile != INVALID_HANDLE_VALUE) { CloseHandle(mFile); }
+		mMapping = nullptr;
+		mFile = INVALID_HANDLE_VALUE;
+#else
+		if (mFile >= 0) { ::close(mFile); }
+		mFile = -1;
+#endif
+		mFileSize = 0;
+		mIsOpen = false;
+	}
+}
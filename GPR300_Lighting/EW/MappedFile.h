@@ -0,0 +1,48 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <string>
+
+namespace ew {
+	/// <summary>
+	/// Read only memory mapping of a file (MapViewOfFile on Windows, mmap elsewhere).
+	/// Either the whole file or a window of it can be mapped, which lets large files
+	/// be walked through without ever having all of them resident.
+	/// </summary>
+	class MappedFile {
+	public:
+		MappedFile();
+		~MappedFile();
+		bool open(const std::string& filePath);
+		/// <summary>
+		/// Maps [offset, offset + length) of the opened file, replacing the previous view.
+		/// length is clamped to the end of the file
+		/// </summary>
+		bool map(uint64_t offset, size_t length);
+		bool mapAll() { return map(0, (size_t)mFileSize); }
+		void close();
+		const char* getData() const { return mData; }
+		size_t getSize() const { return mSize; }
+		uint64_t getFileSize() const { return mFileSize; }
+		bool isOpen() const { return mIsOpen; }
+	private:
+		MappedFile(const MappedFile& r) = delete;
+		MappedFile& operator=(const MappedFile& r) = delete;
+		void unmap();
+
+		const char* mData;
+		size_t mSize;
+		uint64_t mFileSize;
+		bool mIsOpen;
+
+		// Start of the actual mapping, which is aligned down from mData
+		void* mView;
+		size_t mViewSize;
+#ifdef _WIN32
+		void* mFile;
+		void* mMapping;
+#else
+		int mFile;
+#endif
+	};
+}
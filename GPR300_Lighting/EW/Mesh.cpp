@@ -2,19 +2,61 @@
 
 #include "Mesh.h"
 namespace ew {
-	Mesh::Mesh(MeshData* meshData) {
+	Mesh::Mesh(MeshData* meshData)
+		: Mesh(meshData->vertices.data(), (GLsizei)meshData->vertices.size(), meshData->indices.data(), (GLsizei)meshData->indices.size()) {
+	}
+
+	Mesh::Mesh(const Vertex* vertices, GLsizei numVertices, const unsigned int* indices, GLsizei numIndices) {
+
+		glGenVertexArrays(1, &mVAO);
+		glBindVertexArray(mVAO);
+
+		glGenBuffers(1, &mVBO);
+		glBindBuffer(GL_ARRAY_BUFFER, mVBO);
+		glBufferData(GL_ARRAY_BUFFER, numVertices * sizeof(Vertex), vertices, GL_STATIC_DRAW);
+
+		glGenBuffers(1, &mEBO);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mEBO);
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, numIndices * sizeof(unsigned int), indices, GL_STATIC_DRAW);
+
+		setupVertexAttributes();
+
+		mNumIndices = numIndices;
+		mNumVertices = numVertices;
+		mMaxIndices = mNumIndices;
+		mMaxVertices = mNumVertices;
+	}
+
+	Mesh::Mesh(GLsizei maxVertices, GLsizei maxIndices) {
 
 		glGenVertexArrays(1, &mVAO);
 		glBindVertexArray(mVAO);
 
 		glGenBuffers(1, &mVBO);
 		glBindBuffer(GL_ARRAY_BUFFER, mVBO);
-		glBufferData(GL_ARRAY_BUFFER, meshData->vertices.size() * sizeof(Vertex), &meshData->vertices[0], GL_STATIC_DRAW);
+		glBufferData(GL_ARRAY_BUFFER, maxVertices * sizeof(Vertex), nullptr, GL_DYNAMIC_DRAW);
 
 		glGenBuffers(1, &mEBO);
 		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mEBO);
-		glBufferData(GL_ELEMENT_ARRAY_BUFFER, meshData->indices.size() * sizeof(unsigned int), &meshData->indices[0], GL_STATIC_DRAW);
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, maxIndices * sizeof(unsigned int), nullptr, GL_DYNAMIC_DRAW);
+
+		setupVertexAttributes();
+
+		mNumIndices = 0;
+		mNumVertices = 0;
+		mMaxIndices = maxIndices;
+		mMaxVertices = maxVertices;
+	}
+
+	Mesh::~Mesh()
+	{
+		glDeleteVertexArrays(1, &mVAO);
+		glDeleteBuffers(1, &mVBO);
+		glDeleteBuffers(1, &mEBO);
+	}
 
+	void Mesh::setupVertexAttributes()
+	{
 		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (const void*)(offsetof(Vertex, position)));
 		glEnableVertexAttribArray(0);
 
@@ -26,22 +68,60 @@ namespace ew {
 
 		glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (const void*)(offsetof(Vertex, tangent)));
 		glEnableVertexAttribArray(3);
-
-		mNumIndices = (GLsizei)meshData->indices.size();
-		mNumVertices = (GLsizei)meshData->vertices.size();
 	}
 
-	Mesh::~Mesh()
+	void Mesh::draw()
 	{
-		glDeleteVertexArrays(1, &mVAO);
-		glDeleteBuffers(1, &mVBO);
-		glDeleteBuffers(1, &mEBO);
+		glBindVertexArray(mVAO);
+		glDrawElements(GL_TRIANGLES, mNumIndices, GL_UNSIGNED_INT, 0);
 	}
 
-	void Mesh::draw()
+	void Mesh::draw(GLsizei firstIndex, GLsizei numIndices, GLint baseVertex)
 	{
 		glBindVertexArray(mVAO);
-		glDrawElements(GL_TRIANGLES, mNumIndices, GL_UNSIGNED_INT, 0);
+		glDrawElementsBaseVertex(GL_TRIANGLES, numIndices, GL_UNSIGNED_INT, (void*)(firstIndex * sizeof(unsigned int)), baseVertex);
+	}
+
+	// Named (DSA) mapping so the element buffer binding of whatever VAO is bound is left alone
+	Vertex* Mesh::mapVertices()
+	{
+		return (Vertex*)glMapNamedBufferRange(mVBO, 0, mMaxVertices * sizeof(Vertex), GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+	}
+
+	unsigned int* Mesh::mapIndices()
+	{
+		return (unsigned int*)glMapNamedBufferRange(mEBO, 0, mMaxIndices * sizeof(unsigned int), GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+	}
+
+	void Mesh::unmap(GLsizei numVertices, GLsizei numIndices)
+	{
+		glUnmapNamedBuffer(mVBO);
+		glUnmapNamedBuffer(mEBO);
+
+		setCounts(numVertices, numIndices);
+	}
+
+	void Mesh::setCounts(GLsizei numVertices, GLsizei numIndices)
+	{
+		mNumVertices = numVertices;
+		mNumIndices = numIndices;
+	}
+
+	void Mesh::setLods(const MeshLod* lods, uint32_t numLods)
+	{
+		mLods.assign(lods, lods + numLods);
+		if (numLods > 0) { setCounts(lods[0].numVertices, lods[0].numIndices); }
+	}
+
+	void Mesh::drawLod(uint32_t lod)
+	{
+		if (mLods.empty())
+		{
+			draw();
+			return;
+		}
+		const MeshLod& entry = mLods[lod < mLods.size() ? lod : mLods.size() - 1];
+		draw((GLsizei)entry.firstIndex, (GLsizei)entry.numIndices, (GLint)entry.firstVertex);
 	}
 
 }
@@ -3,7 +3,9 @@
 #pragma once
 #include <GL/glew.h>
 #include <glm/glm.hpp>
+#include <cstdint>
 #include <vector>
+#include <array>
 
 namespace ew {
 	struct Vertex {
@@ -11,7 +13,8 @@ namespace ew {
 		glm::vec3 normal;
 		glm::vec2 uv;
 		glm::vec3 tangent;
-		Vertex(glm::vec3 position, glm::vec3 normal, glm::vec2 uv, glm::vec3 tangent)
+		Vertex() {};
+		constexpr Vertex(glm::vec3 position, glm::vec3 normal, glm::vec2 uv, glm::vec3 tangent)
 			: position(position), normal(normal), uv(uv), tangent(tangent) {};
 	};
 
@@ -23,19 +26,83 @@ namespace ew {
 		std::vector<unsigned int> indices;
 	};
 
+	/// <summary>
+	/// One level of detail. Indices are relative to firstVertex
+	/// </summary>
+	struct MeshLod {
+		uint32_t firstVertex;
+		uint32_t numVertices;
+		uint32_t firstIndex;
+		uint32_t numIndices;
+	};
+
+	/// <summary>
+	/// Fixed size vertex + face data that can be built at compile time (see createCubeStatic)
+	/// </summary>
+	template<std::size_t NumVertices, std::size_t NumIndices>
+	struct StaticMeshData {
+		std::array<Vertex, NumVertices> vertices;
+		std::array<unsigned int, NumIndices> indices;
+	};
+
 	/// <summary>
 	/// Holds OpenGL buffers, can be drawn
 	/// </summary>
 	class Mesh {
 	public:
 		Mesh(MeshData* meshData);
+		Mesh(const Vertex* vertices, GLsizei numVertices, const unsigned int* indices, GLsizei numIndices);
+		template<std::size_t NumVertices, std::size_t NumIndices>
+		Mesh(const StaticMeshData<NumVertices, NumIndices>& meshData)
+			: Mesh(meshData.vertices.data(), (GLsizei)NumVertices, meshData.indices.data(), (GLsizei)NumIndices) {};
+		/// <summary>
+		/// Allocates dynamic buffers with room for the given amounts, to be
+		/// filled through mapVertices / mapIndices (ie. by the ShapeGen pointer overloads)
+		/// </summary>
+		Mesh(GLsizei maxVertices, GLsizei maxIndices);
 		~Mesh();
 		void draw();
+		/// <summary>
+		/// Draws a sub range of the index buffer, ie. one LOD of a cached mesh
+		/// </summary>
+		void draw(GLsizei firstIndex, GLsizei numIndices, GLint baseVertex);
+		/// <summary>
+		/// Maps the buffers write only, their previous contents are discarded. Both can be mapped at once.
+		/// The ShapeGen pointer overloads never read back what they write, so they can fill them
+		/// </summary>
+		Vertex* mapVertices();
+		unsigned int* mapIndices();
+		/// <summary>
+		/// Unmaps both buffers and sets how much of them is drawn
+		/// </summary>
+		void unmap(GLsizei numVertices, GLsizei numIndices);
+		/// <summary>
+		/// Sets how much of the buffers is drawn, for when they were filled on the GPU
+		/// </summary>
+		void setCounts(GLsizei numVertices, GLsizei numIndices);
+		/// <summary>
+		/// Sets the LODs packed in the buffers (LOD 0 first), drawn by drawLod.
+		/// draw() keeps drawing LOD 0
+		/// </summary>
+		void setLods(const MeshLod* lods, uint32_t numLods);
+		/// <summary>
+		/// Draws one LOD, clamped to the coarsest. Without a LOD table it is the same as draw()
+		/// </summary>
+		void drawLod(uint32_t lod);
+		uint32_t getNumLods() { return (uint32_t)mLods.size(); }
 		GLuint getVAO() { return mVAO; }
+		GLuint getVBO() { return mVBO; }
+		GLuint getEBO() { return mEBO; }
 		GLsizei getNumIndicies() { return mNumIndices; }
+		GLsizei getMaxVertices() { return mMaxVertices; }
+		GLsizei getMaxIndices() { return mMaxIndices; }
 	private:
+		void setupVertexAttributes();
 		GLuint mVAO, mVBO, mEBO;
 		GLsizei mNumIndices;
 		GLsizei mNumVertices;
+		GLsizei mMaxIndices;
+		GLsizei mMaxVertices;
+		std::vector<MeshLod> mLods;
 	};
 }
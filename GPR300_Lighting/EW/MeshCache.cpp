@@ -0,0 +1,290 @@
+#include "MeshCache.h"
+#include <cfloat>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <stdio.h>
+
+namespace ew {
+	static const char MESH_CACHE_MAGIC[4] = { 'E', 'W', 'M', 'C' };
+	static const uint64_t MESH_CACHE_ALIGNMENT = 16;
+
+	static uint64_t alignOffset(uint64_t offset)
+	{
+		return (offset + MESH_CACHE_ALIGNMENT - 1) & ~(MESH_CACHE_ALIGNMENT - 1);
+	}
+
+	uint64_t hashMeshParams(const char* generator, std::initializer_list<float> params)
+	{
+		uint64_t hash = hashBytes(generator, strlen(generator));
+		for (float param : params)
+		{
+			hash = hashBytes(&param, sizeof(float), hash);
+		}
+		// Changing the vertex layout invalidates every file
+		uint32_t vertexSize = sizeof(Vertex);
+		return hashBytes(&vertexSize, sizeof(vertexSize), hash);
+	}
+
+	uint64_t hashFile(const std::string& filePath)
+	{
+		MappedFile file;
+		if (!file.open(filePath) || !file.mapAll()) { return 0; }
+		return hashBytes(file.getData(), file.getSize());
+	}
+
+	// Greedily packs LOD 0's triangles, in index order, into meshlets
+	static void buildMeshlets(const MeshData& meshData, std::vector<Meshlet>& meshlets, std::vector<uint32_t>& meshletVertices, std::vector<uint8_t>& meshletTriangles)
+	{
+		// Local index of each vertex within the current meshlet, valid when its stamp matches
+		std::vector<uint8_t> localIndex(meshData.vertices.size());
+		std::vector<uint32_t> stamp(meshData.vertices.size(), 0);
+
+		Meshlet meshlet = {};
+		uint32_t currentStamp = 1;
+
+		auto finishMeshlet = [&]()
+		{
+			if (meshlet.triangleCount == 0) { return; }
+
+			glm::vec3 minBounds = glm::vec3(FLT_MAX);
+			glm::vec3 maxBounds = glm::vec3(-FLT_MAX);
+			for (uint32_t i = 0; i < meshlet.vertexCount; i++)
+			{
+				glm::vec3 position = meshData.vertices[meshletVertices[meshlet.vertexOffset + i]].position;
+				minBounds = glm::min(minBounds, position);
+				maxBounds = glm::max(maxBounds, position);
+			}
+			glm::vec3 center = (minBounds + maxBounds) * 0.5f;
+			float radius = 0.0f;
+			for (uint32_t i = 0; i < meshlet.vertexCount; i++)
+			{
+				radius = glm::max(radius, glm::distance(center, meshData.vertices[meshletVertices[meshlet.vertexOffset + i]].position));
+			}
+			meshlet.boundsCenter[0] = center.x;
+			meshlet.boundsCenter[1] = center.y;
+			meshlet.boundsCenter[2] = center.z;
+			meshlet.boundsRadius = radius;
+
+			meshlets.push_back(meshlet);
+
+			meshlet = {};
+			meshlet.vertexOffset = (uint32_t)meshletVertices.size();
+			meshlet.triangleOffset = (uint32_t)meshletTriangles.size() / 3;
+			currentStamp++;
+		};
+
+		for (size_t i = 0; i + 2 < meshData.indices.size(); i += 3)
+		{
+			uint32_t newVertices = 0;
+			for (int corner = 0; corner < 3; corner++)
+			{
+				if (stamp[meshData.indices[i + corner]] != currentStamp) { newVertices++; }
+			}
+
+			if (meshlet.vertexCount + newVertices > MAX_MESHLET_VERTICES || meshlet.triangleCount + 1 > MAX_MESHLET_TRIANGLES)
+			{
+				finishMeshlet();
+			}
+
+			for (int corner = 0; corner < 3; corner++)
+			{
+				unsigned int vertex = meshData.indices[i + corner];
+				if (stamp[vertex] != currentStamp)
+				{
+					stamp[vertex] = currentStamp;
+					localIndex[vertex] = (uint8_t)meshlet.vertexCount++;
+					meshletVertices.push_back(vertex);
+				}
+				meshletTriangles.push_back(localIndex[vertex]);
+			}
+			meshlet.triangleCount++;
+		}
+		finishMeshlet();
+	}
+
+	bool writeMeshCache(const std::string& filePath, uint64_t key, const std::vector<MeshData>& lods)
+	{
+		if (lods.empty() || lods[0].vertices.empty()) { return false; }
+
+		MeshCacheHeader header = {};
+		memcpy(header.magic, MESH_CACHE_MAGIC, sizeof(header.magic));
+		header.version = MESH_CACHE_VERSION;
+		header.key = key;
+		header.vertexSize = sizeof(Vertex);
+		header.numLods = (uint32_t)lods.size();
+
+		std::vector<MeshLod> lodTable;
+		for (const MeshData& lod : lods)
+		{
+			MeshLod entry;
+			entry.firstVertex = header.numVertices;
+			entry.numVertices = (uint32_t)lod.vertices.size();
+			entry.firstIndex = header.numIndices;
+			entry.numIndices = (uint32_t)lod.indices.size();
+			lodTable.push_back(entry);
+
+			header.numVertices += entry.numVertices;
+			header.numIndices += entry.numIndices;
+		}
+
+		glm::vec3 minBounds = glm::vec3(FLT_MAX);
+		glm::vec3 maxBounds = glm::vec3(-FLT_MAX);
+		for (const Vertex& vertex : lods[0].vertices)
+		{
+			minBounds = glm::min(minBounds, vertex.position);
+			maxBounds = glm::max(maxBounds, vertex.position);
+		}
+		memcpy(header.boundsMin, &minBounds, sizeof(header.boundsMin));
+		memcpy(header.boundsMax, &maxBounds, sizeof(header.boundsMax));
+
+		std::vector<Meshlet> meshlets;
+		std::vector<uint32_t> meshletVertices;
+		std::vector<uint8_t> meshletTriangles;
+		buildMeshlets(lods[0], meshlets, meshletVertices, meshletTriangles);
+		header.numMeshlets = (uint32_t)meshlets.size();
+		header.numMeshletVertices = (uint32_t)meshletVertices.size();
+		header.numMeshletTriangles = (uint32_t)meshletTriangles.size() / 3;
+
+		header.lodsOffset = alignOffset(sizeof(MeshCacheHeader));
+		header.meshletsOffset = alignOffset(header.lodsOffset + lodTable.size() * sizeof(MeshLod));
+		header.verticesOffset = alignOffset(header.meshletsOffset + meshlets.size() * sizeof(Meshlet));
+		header.indicesOffset = alignOffset(header.verticesOffset + (uint64_t)header.numVertices * sizeof(Vertex));
+		header.meshletVerticesOffset = alignOffset(header.indicesOffset + (uint64_t)header.numIndices * sizeof(unsigned int));
+		header.meshletTrianglesOffset = alignOffset(header.meshletVerticesOffset + meshletVertices.size() * sizeof(uint32_t));
+
+		// Written to a temporary first so a crash never leaves a truncated cache behind
+		std::string tempPath = filePath + ".tmp";
+		std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+		if (!file.is_open())
+		{
+			printf("Failed to write mesh cache %s\n", filePath.c_str());
+			return false;
+		}
+
+		auto writeAt = [&file](uint64_t offset, const void* data, size_t size)
+		{
+			static const char padding[MESH_CACHE_ALIGNMENT] = {};
+			uint64_t position = (uint64_t)file.tellp();
+			file.write(padding, (std::streamsize)(offset - position));
+			file.write((const char*)data, (std::streamsize)size);
+		};
+
+		writeAt(0, &header, sizeof(header));
+		writeAt(header.lodsOffset, lodTable.data(), lodTable.size() * sizeof(MeshLod));
+		writeAt(header.meshletsOffset, meshlets.data(), meshlets.size() * sizeof(Meshlet));
+		uint64_t offset = header.verticesOffset;
+		for (const MeshData& lod : lods)
+		{
+			writeAt(offset, lod.vertices.data(), lod.vertices.size() * sizeof(Vertex));
+			offset += lod.vertices.size() * sizeof(Vertex);
+		}
+		offset = header.indicesOffset;
+		for (const MeshData& lod : lods)
+		{
+			writeAt(offset, lod.indices.data(), lod.indices.size() * sizeof(unsigned int));
+			offset += lod.indices.size() * sizeof(unsigned int);
+		}
+		writeAt(header.meshletVerticesOffset, meshletVertices.data(), meshletVertices.size() * sizeof(uint32_t));
+		writeAt(header.meshletTrianglesOffset, meshletTriangles.data(), meshletTriangles.size());
+		file.close();
+
+		std::error_code error;
+		// A full disk shows up as a failed write or close, never keep what made it out
+		if (!file.good())
+		{
+			printf("Failed to write mesh cache %s\n", filePath.c_str());
+			std::filesystem::remove(tempPath, error);
+			return false;
+		}
+		std::filesystem::rename(tempPath, filePath, error);
+		return !error;
+	}
+
+	CachedMesh::CachedMesh()
+	{
+		mHeader = nullptr;
+	}
+
+	bool CachedMesh::load(const std::string& filePath, uint64_t key)
+	{
+		mHeader = nullptr;
+		if (!mFile.open(filePath) || !mFile.mapAll()) { return false; }
+		if (mFile.getSize() < sizeof(MeshCacheHeader)) { return false; }
+
+		const MeshCacheHeader* header = (const MeshCacheHeader*)mFile.getData();
+		if (memcmp(header->magic, MESH_CACHE_MAGIC, sizeof(header->magic)) != 0
+			|| header->version != MESH_CACHE_VERSION
+			|| header->vertexSize != sizeof(Vertex)
+			|| header->key != key
+			|| header->numLods == 0)
+		{
+			return false;
+		}
+
+		uint64_t end = header->meshletTrianglesOffset + (uint64_t)header->numMeshletTriangles * 3;
+		if (end > mFile.getSize()) { return false; }
+
+		mHeader = header;
+		return true;
+	}
+
+	const MeshLod& CachedMesh::getLod(uint32_t lod) const
+	{
+		const MeshLod* lods = (const MeshLod*)(mFile.getData() + mHeader->lodsOffset);
+		return lods[glm::min(lod, mHeader->numLods - 1)];
+	}
+
+	const Meshlet* CachedMesh::getMeshlets() const
+	{
+		return (const Meshlet*)(mFile.getData() + mHeader->meshletsOffset);
+	}
+
+	const Vertex* CachedMesh::getVertices() const
+	{
+		return (const Vertex*)(mFile.getData() + mHeader->verticesOffset);
+	}
+
+	const unsigned int* CachedMesh::getIndices() const
+	{
+		return (const unsigned int*)(mFile.getData() + mHeader->indicesOffset);
+	}
+
+	const uint32_t* CachedMesh::getMeshletVertices() const
+	{
+		return (const uint32_t*)(mFile.getData() + mHeader->meshletVerticesOffset);
+	}
+
+	const uint8_t* CachedMesh::getMeshletTriangles() const
+	{
+		return (const uint8_t*)(mFile.getData() + mHeader->meshletTrianglesOffset);
+	}
+
+	Mesh* CachedMesh::createMesh() const
+	{
+		// Straight from the mapping into the buffers
+		Mesh* mesh = new Mesh(getVertices(), (GLsizei)mHeader->numVertices, getIndices(), (GLsizei)mHeader->numIndices);
+		mesh->setLods(&getLod(0), mHeader->numLods);
+		return mesh;
+	}
+
+	Mesh* loadOrBuildMesh(const std::string& filePath, uint64_t key, const std::function<void(std::vector<MeshData>&)>& generate, bool* cacheHit)
+	{
+		CachedMesh cachedMesh;
+		bool hit = cachedMesh.load(filePath, key);
+		if (cacheHit != nullptr) { *cacheHit = hit; }
+		if (hit) { return cachedMesh.createMesh(); }
+
+		std::vector<MeshData> lods;
+		generate(lods);
+
+		std::error_code error;
+		std::filesystem::create_directories(std::filesystem::path(filePath).parent_path(), error);
+
+		if (writeMeshCache(filePath, key, lods) && cachedMesh.load(filePath, key))
+		{
+			return cachedMesh.createMesh();
+		}
+		return new Mesh(&lods[0]);
+	}
+}
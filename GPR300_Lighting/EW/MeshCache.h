@@ -0,0 +1,104 @@
+#pragma once
+#include "Mesh.h"
+#include "Hash.h"
+#include "MappedFile.h"
+#include <cstdint>
+#include <functional>
+#include <initializer_list>
+#include <string>
+#include <vector>
+
+namespace ew {
+	const uint32_t MESH_CACHE_VERSION = 1;
+
+	/// <summary>
+	/// A cluster of at most MAX_MESHLET_VERTICES / MAX_MESHLET_TRIANGLES from LOD 0.
+	/// Its triangles index into its own slice of the meshlet vertex list,
+	/// which in turn indexes the vertex blob.
+	/// </summary>
+	struct Meshlet {
+		uint32_t vertexOffset;
+		uint32_t vertexCount;
+		uint32_t triangleOffset;
+		uint32_t triangleCount;
+		float boundsCenter[3];
+		float boundsRadius;
+	};
+
+	const uint32_t MAX_MESHLET_VERTICES = 64;
+	const uint32_t MAX_MESHLET_TRIANGLES = 124;
+
+	/// <summary>
+	/// File layout, every section 16 byte aligned:
+	/// header | lods | meshlets | vertices | indices | meshlet vertices | meshlet triangles (3 bytes each)
+	/// </summary>
+	struct MeshCacheHeader {
+		char magic[4];
+		uint32_t version;
+		uint64_t key;
+		uint32_t vertexSize;
+		uint32_t numLods;
+		uint32_t numMeshlets;
+		uint32_t numVertices;
+		uint32_t numIndices;
+		uint32_t numMeshletVertices;
+		uint32_t numMeshletTriangles;
+		float boundsMin[3];
+		float boundsMax[3];
+		uint64_t lodsOffset;
+		uint64_t meshletsOffset;
+		uint64_t verticesOffset;
+		uint64_t indicesOffset;
+		uint64_t meshletVerticesOffset;
+		uint64_t meshletTrianglesOffset;
+	};
+
+	/// <summary>
+	/// Key for a ShapeGen mesh: generator name + its parameters
+	/// </summary>
+	uint64_t hashMeshParams(const char* generator, std::initializer_list<float> params);
+	/// <summary>
+	/// Key for a mesh imported from a file: hash of the file's contents
+	/// </summary>
+	uint64_t hashFile(const std::string& filePath);
+
+	/// <summary>
+	/// Writes lods (LOD 0 first) to a cache file, building bounds and meshlets
+	/// </summary>
+	bool writeMeshCache(const std::string& filePath, uint64_t key, const std::vector<MeshData>& lods);
+
+	/// <summary>
+	/// A cache file mapped into memory. Nothing is parsed or copied,
+	/// the getters point straight into the mapping.
+	/// </summary>
+	class CachedMesh {
+	public:
+		CachedMesh();
+		/// <summary>
+		/// Fails when the file is missing, was written by another version or has a different key
+		/// </summary>
+		bool load(const std::string& filePath, uint64_t key);
+		const MeshCacheHeader& getHeader() const { return *mHeader; }
+		const MeshLod& getLod(uint32_t lod) const;
+		const Meshlet* getMeshlets() const;
+		const Vertex* getVertices() const;
+		const unsigned int* getIndices() const;
+		const uint32_t* getMeshletVertices() const;
+		const uint8_t* getMeshletTriangles() const;
+		/// <summary>
+		/// Uploads every LOD in one vertex and one index buffer and gives the mesh
+		/// the LOD table, so it can be drawn at any of them (see Mesh::drawLod)
+		/// </summary>
+		Mesh* createMesh() const;
+	private:
+		MappedFile mFile;
+		const MeshCacheHeader* mHeader;
+	};
+
+	/// <summary>
+	/// Maps the cache file for key and uploads it. On a miss, generate fills the LODs
+	/// (LOD 0 first) which are written to the cache for the next launch.
+	/// Still returns a mesh if the cache can't be written, then with LOD 0 only.
+	/// </summary>
+	Mesh* loadOrBuildMesh(const std::string& filePath, uint64_t key, const std::function<void(std::vector<MeshData>&)>& generate, bool* cacheHit = nullptr);
+}
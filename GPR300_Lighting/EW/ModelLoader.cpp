@@ -0,0 +1,882 @@
+#include "ModelLoader.h"
+#include "MappedFile.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include <stdio.h>
+
+namespace ew {
+	// OBJ files are walked through this much text at a time
+	static const size_t OBJ_WINDOW_SIZE = 64 * 1024 * 1024;
+	// Below this a chunk isn't worth a thread
+	static const size_t OBJ_MIN_CHUNK_SIZE = 256 * 1024;
+
+	static unsigned int getThreadCount()
+	{
+		return std::max(1u, std::thread::hardware_concurrency());
+	}
+
+	static double getSeconds()
+	{
+		using namespace std::chrono;
+		return duration<double>(steady_clock::now().time_since_epoch()).count();
+	}
+
+	// Fills in normals for vertices that have none (area weighted) and tangents for all vertices
+	static void generateNormalsAndTangents(MeshData& meshData, const std::vector<bool>& missingNormals, bool generateTangents)
+	{
+		std::vector<Vertex>& vertices = meshData.vertices;
+		const std::vector<unsigned int>& indices = meshData.indices;
+
+		bool anyMissingNormals = std::find(missingNormals.begin(), missingNormals.end(), true) != missingNormals.end();
+		std::vector<glm::vec3> normals(anyMissingNormals ? vertices.size() : 0, glm::vec3(0));
+		std::vector<glm::vec3> tangents(generateTangents ? vertices.size() : 0, glm::vec3(0));
+
+		for (size_t i = 0; i + 2 < indices.size(); i += 3)
+		{
+			const Vertex& vertex1 = vertices[indices[i]];
+			const Vertex& vertex2 = vertices[indices[i + 1]];
+			const Vertex& vertex3 = vertices[indices[i + 2]];
+
+			glm::vec3 edge1 = vertex2.position - vertex1.position;
+			glm::vec3 edge2 = vertex3.position - vertex1.position;
+
+			if (anyMissingNormals)
+			{
+				// Not normalized, so bigger faces weigh more
+				glm::vec3 faceNormal = glm::cross(edge1, edge2);
+				for (int corner = 0; corner < 3; corner++) { normals[indices[i + corner]] += faceNormal; }
+			}
+
+			if (generateTangents)
+			{
+				glm::vec2 deltaUV1 = vertex2.uv - vertex1.uv;
+				glm::vec2 deltaUV2 = vertex3.uv - vertex1.uv;
+
+				float determinant = deltaUV1.x * deltaUV2.y - deltaUV2.x * deltaUV1.y;
+				if (fabsf(determinant) < 1e-12f) { continue; }
+
+				float f = 1.0f / determinant;
+				glm::vec3 tangent = f * (deltaUV2.y * edge1 - deltaUV1.y * edge2);
+				for (int corner = 0; corner < 3; corner++) { tangents[indices[i + corner]] += tangent; }
+			}
+		}
+
+		for (size_t i = 0; i < vertices.size(); i++)
+		{
+			Vertex& vertex = vertices[i];
+			if (anyMissingNormals && missingNormals[i])
+			{
+				float length = glm::length(normals[i]);
+				vertex.normal = length > 0.0f ? normals[i] / length : glm::vec3(0, 1, 0);
+			}
+
+			if (generateTangents)
+			{
+				// Gram-Schmidt against the normal, falling back to any perpendicular axis
+				glm::vec3 tangent = tangents[i] - vertex.normal * glm::dot(vertex.normal, tangents[i]);
+				if (glm::dot(tangent, tangent) < 1e-12f)
+				{
+					glm::vec3 axis = fabsf(vertex.normal.x) < 0.9f ? glm::vec3(1, 0, 0) : glm::vec3(0, 1, 0);
+					tangent = glm::cross(vertex.normal, axis);
+				}
+				vertex.tangent = glm::normalize(tangent);
+			}
+		}
+	}
+
+	//OBJ
+	//-------------
+
+	// Indices into the attribute arrays, -1 when missing.
+	// Negative (relative) OBJ indices are resolved against the chunk first and
+	// marked in relativeMask, then offset once every earlier chunk's counts are known.
+	struct ObjCorner {
+		int32_t position;
+		int32_t uv;
+		int32_t normal;
+		uint8_t relativeMask;
+	};
+
+	struct ObjChunk {
+		std::vector<glm::vec3> positions;
+		std::vector<glm::vec2> uvs;
+		std::vector<glm::vec3> normals;
+		std::vector<ObjCorner> corners;
+		bool failed = false;
+	};
+
+	static inline bool isLineEnd(char c) { return c == '\n' || c == '\r'; }
+	static inline bool isSpace(char c) { return c == ' ' || c == '\t'; }
+
+	static inline const char* skipSpaces(const char* c, const char* end)
+	{
+		while (c < end && isSpace(*c)) { c++; }
+		return c;
+	}
+
+	static inline const char* skipLine(const char* c, const char* end)
+	{
+		while (c < end && *c != '\n') { c++; }
+		return c < end ? c + 1 : end;
+	}
+
+	// Much faster than strtod and not affected by the locale.
+	// Integers up to 2^53 come out exact, other values to float precision at least.
+	static const char* parseDouble(const char* c, const char* end, double& value)
+	{
+		static const double POWERS_OF_TEN[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18 };
+
+		c = skipSpaces(c, end);
+		bool negative = false;
+		if (c < end && (*c == '-' || *c == '+')) { negative = *c == '-'; c++; }
+
+		uint64_t mantissa = 0;
+		int exponent = 0;
+		int digits = 0;
+		for (; c < end && *c >= '0' && *c <= '9'; c++)
+		{
+			if (digits < 18) { mantissa = mantissa * 10 + (*c - '0'); digits += mantissa > 0 ? 1 : 0; }
+			else { exponent++; }
+		}
+		if (c < end && *c == '.')
+		{
+			c++;
+			for (; c < end && *c >= '0' && *c <= '9'; c++)
+			{
+				if (digits < 18) { mantissa = mantissa * 10 + (*c - '0'); digits += mantissa > 0 ? 1 : 0; exponent--; }
+			}
+		}
+		if (c < end && (*c == 'e' || *c == 'E'))
+		{
+			c++;
+			bool negativeExponent = false;
+			if (c < end && (*c == '-' || *c == '+')) { negativeExponent = *c == '-'; c++; }
+			int explicitExponent = 0;
+			for (; c < end && *c >= '0' && *c <= '9'; c++) { explicitExponent = explicitExponent * 10 + (*c - '0'); }
+			exponent += negativeExponent ? -explicitExponent : explicitExponent;
+		}
+
+		double result = (double)mantissa;
+		while (exponent > 0) { int step = std::min(exponent, 18); result *= POWERS_OF_TEN[step]; exponent -= step; }
+		while (exponent < 0) { int step = std::min(-exponent, 18); result /= POWERS_OF_TEN[step]; exponent += step; }
+
+		value = negative ? -result : result;
+		return c;
+	}
+
+	// Accurate to float precision for the values OBJ exporters write
+	static inline const char* parseFloat(const char* c, const char* end, float& value)
+	{
+		double result;
+		c = parseDouble(c, end, result);
+		value = (float)result;
+		return c;
+	}
+
+	static inline const char* parseInt(const char* c, const char* end, int32_t& value)
+	{
+		bool negative = false;
+		if (c < end && (*c == '-' || *c == '+')) { negative = *c == '-'; c++; }
+		int32_t result = 0;
+		for (; c < end && *c >= '0' && *c <= '9'; c++) { result = result * 10 + (*c - '0'); }
+		value = negative ? -result : result;
+		return c;
+	}
+
+	// OBJ indices are 1 based, or relative to the end of the list when negative
+	static inline int32_t resolveIndex(int32_t index, size_t localCount, uint8_t bit, uint8_t& relativeMask)
+	{
+		if (index > 0) { return index - 1; }
+		if (index < 0)
+		{
+			relativeMask |= bit;
+			return (int32_t)localCount + index;
+		}
+		return -1;
+	}
+
+	static void parseObjChunk(const char* c, const char* end, ObjChunk& chunk)
+	{
+		// Reused between faces
+		std::vector<ObjCorner> polygon;
+
+		while (c < end)
+		{
+			c = skipSpaces(c, end);
+			if (c >= end) { break; }
+
+			if (c + 1 < end && c[0] == 'v' && isSpace(c[1]))
+			{
+				glm::vec3 position;
+				c = parseFloat(c + 1, end, position.x);
+				c = parseFloat(c, end, position.y);
+				c = parseFloat(c, end, position.z);
+				chunk.positions.push_back(position);
+			}
+			else if (c + 2 < end && c[0] == 'v' && c[1] == 't' && isSpace(c[2]))
+			{
+				glm::vec2 uv;
+				c = parseFloat(c + 2, end, uv.x);
+				c = parseFloat(c, end, uv.y);
+				chunk.uvs.push_back(uv);
+			}
+			else if (c + 2 < end && c[0] == 'v' && c[1] == 'n' && isSpace(c[2]))
+			{
+				glm::vec3 normal;
+				c = parseFloat(c + 2, end, normal.x);
+				c = parseFloat(c, end, normal.y);
+				c = parseFloat(c, end, normal.z);
+				chunk.normals.push_back(normal);
+			}
+			else if (c + 1 < end && c[0] == 'f' && isSpace(c[1]))
+			{
+				polygon.clear();
+				c++;
+				while (true)
+				{
+					c = skipSpaces(c, end);
+					if (c >= end || isLineEnd(*c)) { break; }
+
+					ObjCorner corner = { -1, -1, -1, 0 };
+					int32_t index = 0;
+					c = parseInt(c, end, index);
+					corner.position = resolveIndex(index, chunk.positions.size(), 1, corner.relativeMask);
+					if (c < end && *c == '/')
+					{
+						c++;
+						if (c < end && *c != '/')
+						{
+							c = parseInt(c, end, index);
+							corner.uv = resolveIndex(index, chunk.uvs.size(), 2, corner.relativeMask);
+						}
+						if (c < end && *c == '/')
+						{
+							c = parseInt(c + 1, end, index);
+							corner.normal = resolveIndex(index, chunk.normals.size(), 4, corner.relativeMask);
+						}
+					}
+					if (corner.position == -1 && !(corner.relativeMask & 1))
+					{
+						chunk.failed = true;
+						return;
+					}
+					polygon.push_back(corner);
+
+					// Skip anything unexpected so a bad token can't stall the loop
+					while (c < end && !isSpace(*c) && !isLineEnd(*c)) { c++; }
+				}
+
+				for (size_t i = 2; i < polygon.size(); i++)
+				{
+					chunk.corners.push_back(polygon[0]);
+					chunk.corners.push_back(polygon[i - 1]);
+					chunk.corners.push_back(polygon[i]);
+				}
+			}
+			c = skipLine(c, end);
+		}
+	}
+
+	struct ObjCornerHash {
+		size_t operator()(const ObjCorner& corner) const
+		{
+			uint64_t hash = (uint64_t)(uint32_t)corner.position * 0x9E3779B97F4A7C15ull;
+			hash ^= (uint64_t)(uint32_t)corner.uv * 0xC2B2AE3D27D4EB4Full + (hash << 6) + (hash >> 2);
+			hash ^= (uint64_t)(uint32_t)corner.normal * 0x165667B19E3779F9ull + (hash << 6) + (hash >> 2);
+			return (size_t)hash;
+		}
+	};
+
+	struct ObjCornerEqual {
+		bool operator()(const ObjCorner& a, const ObjCorner& b) const
+		{
+			return a.position == b.position && a.uv == b.uv && a.normal == b.normal;
+		}
+	};
+
+	bool loadOBJ(const std::string& filePath, MeshData& meshData, ModelLoadStats* stats)
+	{
+		double startTime = getSeconds();
+
+		MappedFile file;
+		if (!file.open(filePath))
+		{
+			printf("Failed to open model %s\n", filePath.c_str());
+			return false;
+		}
+
+		std::vector<glm::vec3> positions;
+		std::vector<glm::vec2> uvs;
+		std::vector<glm::vec3> normals;
+		std::vector<ObjCorner> corners;
+
+		unsigned int threadCount = getThreadCount();
+		std::vector<ObjChunk> chunks(threadCount);
+
+		uint64_t offset = 0;
+		while (offset < file.getFileSize())
+		{
+			if (!file.map(offset, OBJ_WINDOW_SIZE)) { return false; }
+
+			const char* begin = file.getData();
+			const char* end = begin + file.getSize();
+
+			// Only whole lines are parsed, a cut off line is picked up again by the next window
+			if (offset + file.getSize() < file.getFileSize())
+			{
+				const char* lastLine = end;
+				while (lastLine > begin && lastLine[-1] != '\n') { lastLine--; }
+				if (lastLine == begin)
+				{
+					printf("Line longer than %zu bytes in %s\n", OBJ_WINDOW_SIZE, filePath.c_str());
+					return false;
+				}
+				end = lastLine;
+			}
+
+			// Split the window at line breaks, one chunk per thread
+			size_t chunkCount = std::max<size_t>(1, std::min<size_t>(threadCount, (end - begin) / OBJ_MIN_CHUNK_SIZE));
+			std::vector<const char*> bounds(chunkCount + 1);
+			bounds[0] = begin;
+			bounds[chunkCount] = end;
+			for (size_t i = 1; i < chunkCount; i++)
+			{
+				const char* split = begin + (end - begin) * i / chunkCount;
+				split = std::max(split, bounds[i - 1]);
+				while (split < end && split[-1] != '\n') { split++; }
+				bounds[i] = split;
+			}
+
+			std::vector<std::thread> workers;
+			for (size_t i = 0; i < chunkCount; i++)
+			{
+				chunks[i] = ObjChunk();
+				if (i + 1 < chunkCount)
+				{
+					workers.emplace_back(parseObjChunk, bounds[i], bounds[i + 1], std::ref(chunks[i]));
+				}
+			}
+			// The calling thread takes the last chunk
+			parseObjChunk(bounds[chunkCount - 1], bounds[chunkCount], chunks[chunkCount - 1]);
+			for (std::thread& worker : workers) { worker.join(); }
+
+			// Append in file order, making chunk relative indices global
+			for (size_t i = 0; i < chunkCount; i++)
+			{
+				ObjChunk& chunk = chunks[i];
+				if (chunk.failed)
+				{
+					printf("Malformed face in %s\n", filePath.c_str());
+					return false;
+				}
+
+				int32_t positionBase = (int32_t)positions.size();
+				int32_t uvBase = (int32_t)uvs.size();
+				int32_t normalBase = (int32_t)normals.size();
+				for (ObjCorner& corner : chunk.corners)
+				{
+					if (corner.relativeMask & 1) { corner.position += positionBase; }
+					if (corner.relativeMask & 2) { corner.uv += uvBase; }
+					if (corner.relativeMask & 4) { corner.normal += normalBase; }
+					// Reaching back past the start of the file, which would otherwise read as a missing uv or normal
+					if (((corner.relativeMask & 2) && corner.uv < 0) || ((corner.relativeMask & 4) && corner.normal < 0))
+					{
+						printf("Index out of range in %s\n", filePath.c_str());
+						return false;
+					}
+					corner.relativeMask = 0;
+				}
+
+				positions.insert(positions.end(), chunk.positions.begin(), chunk.positions.end());
+				uvs.insert(uvs.end(), chunk.uvs.begin(), chunk.uvs.end());
+				normals.insert(normals.end(), chunk.normals.begin(), chunk.normals.end());
+				corners.insert(corners.end(), chunk.corners.begin(), chunk.corners.end());
+				chunk = ObjChunk();
+			}
+
+			offset += end - begin;
+		}
+		uint64_t fileSize = file.getFileSize();
+		file.close();
+
+		// Deduplicate position/uv/normal combinations into vertices
+		meshData.vertices.clear();
+		meshData.indices.clear();
+		meshData.indices.reserve(corners.size());
+
+		std::unordered_map<ObjCorner, unsigned int, ObjCornerHash, ObjCornerEqual> vertexLookup;
+		vertexLookup.reserve(positions.size() * 2);
+		std::vector<bool> missingNormals;
+
+		for (const ObjCorner& corner : corners)
+		{
+			auto inserted = vertexLookup.emplace(corner, (unsigned int)meshData.vertices.size());
+			if (inserted.second)
+			{
+				if (corner.position < 0 || corner.position >= (int32_t)positions.size()
+					|| corner.uv >= (int32_t)uvs.size() || corner.normal >= (int32_t)normals.size())
+				{
+					printf("Index out of range in %s\n", filePath.c_str());
+					meshData.vertices.clear();
+					meshData.indices.clear();
+					return false;
+				}
+
+				bool hasNormal = corner.normal >= 0;
+				meshData.vertices.push_back(Vertex(
+					positions[corner.position],
+					hasNormal ? normals[corner.normal] : glm::vec3(0),
+					corner.uv >= 0 ? uvs[corner.uv] : glm::vec2(0),
+					glm::vec3(0)));
+				missingNormals.push_back(!hasNormal);
+			}
+			meshData.indices.push_back(inserted.first->second);
+		}
+
+		generateNormalsAndTangents(meshData, missingNormals, true);
+
+		if (stats != nullptr)
+		{
+			stats->fileSize = fileSize;
+			stats->seconds = getSeconds() - startTime;
+			stats->threads = threadCount;
+			stats->numTriangles = (unsigned int)(meshData.indices.size() / 3);
+			stats->numVertices = (unsigned int)meshData.vertices.size();
+		}
+		return !meshData.indices.empty();
+	}
+
+	//GLB
+	//-------------
+
+	// Just enough JSON for a glTF document
+	struct JsonValue {
+		enum Type { JSON_NULL, JSON_BOOL, JSON_NUMBER, JSON_STRING, JSON_ARRAY, JSON_OBJECT };
+		Type type = JSON_NULL;
+		double number = 0.0;
+		std::string string;
+		std::vector<JsonValue> items;
+		std::vector<std::pair<std::string, JsonValue>> members;
+
+		const JsonValue* find(const char* key) const
+		{
+			for (const auto& member : members)
+			{
+				if (member.first == key) { return &member.second; }
+			}
+			return nullptr;
+		}
+
+		double getNumber(const char* key, double fallback) const
+		{
+			const JsonValue* value = find(key);
+			return value != nullptr && value->type == JSON_NUMBER ? value->number : fallback;
+		}
+	};
+
+	struct JsonParser {
+		const char* c;
+		const char* end;
+
+		void skipWhitespace()
+		{
+			while (c < end && (*c == ' ' || *c == '\t' || *c == '\n' || *c == '\r')) { c++; }
+		}
+
+		bool parseString(std::string& out)
+		{
+			if (c >= end || *c != '"') { return false; }
+			c++;
+			while (c < end && *c != '"')
+			{
+				if (*c == '\\' && c + 1 < end)
+				{
+					c++;
+					switch (*c)
+					{
+					case 'n': out += '\n'; break;
+					case 't': out += '\t'; break;
+					case 'r': out += '\r'; break;
+					case 'b': out += '\b'; break;
+					case 'f': out += '\f'; break;
+					// Names glTF cares about are ASCII, anything else is kept as a placeholder
+					case 'u': out += '?'; c += std::min<ptrdiff_t>(4, end - c - 1); break;
+					default: out += *c; break;
+					}
+					c++;
+				}
+				else
+				{
+					out += *c++;
+				}
+			}
+			if (c >= end) { return false; }
+			c++;
+			return true;
+		}
+
+		bool parseValue(JsonValue& value, int depth)
+		{
+			if (depth > 64) { return false; }
+			skipWhitespace();
+			if (c >= end) { return false; }
+
+			if (*c == '{')
+			{
+				value.type = JsonValue::JSON_OBJECT;
+				c++;
+				skipWhitespace();
+				if (c < end && *c == '}') { c++; return true; }
+				while (c < end)
+				{
+					skipWhitespace();
+					std::pair<std::string, JsonValue> member;
+					if (!parseString(member.first)) { return false; }
+					skipWhitespace();
+					if (c >= end || *c != ':') { return false; }
+					c++;
+					if (!parseValue(member.second, depth + 1)) { return false; }
+					value.members.push_back(std::move(member));
+					skipWhitespace();
+					if (c < end && *c == ',') { c++; continue; }
+					if (c < end && *c == '}') { c++; return true; }
+					return false;
+				}
+				return false;
+			}
+			if (*c == '[')
+			{
+				value.type = JsonValue::JSON_ARRAY;
+				c++;
+				skipWhitespace();
+				if (c < end && *c == ']') { c++; return true; }
+				while (c < end)
+				{
+					value.items.emplace_back();
+					if (!parseValue(value.items.back(), depth + 1)) { return false; }
+					skipWhitespace();
+					if (c < end && *c == ',') { c++; continue; }
+					if (c < end && *c == ']') { c++; return true; }
+					return false;
+				}
+				return false;
+			}
+			if (*c == '"')
+			{
+				value.type = JsonValue::JSON_STRING;
+				return parseString(value.string);
+			}
+			if (end - c >= 4 && strncmp(c, "true", 4) == 0) { value.type = JsonValue::JSON_BOOL; value.number = 1; c += 4; return true; }
+			if (end - c >= 5 && strncmp(c, "false", 5) == 0) { value.type = JsonValue::JSON_BOOL; c += 5; return true; }
+			if (end - c >= 4 && strncmp(c, "null", 4) == 0) { c += 4; return true; }
+
+			value.type = JsonValue::JSON_NUMBER;
+			// As a double, so byte offsets and counts past 2^24 stay exact
+			const char* start = c;
+			c = parseDouble(c, end, value.number);
+			return c != start;
+		}
+	};
+
+	// glTF constants
+	static const uint32_t GLB_MAGIC = 0x46546C67; // "glTF"
+	static const uint32_t GLB_CHUNK_JSON = 0x4E4F534A;
+	static const uint32_t GLB_CHUNK_BIN = 0x004E4942;
+	static const int GLTF_FLOAT = 5126;
+	static const int GLTF_UNSIGNED_BYTE = 5121;
+	static const int GLTF_UNSIGNED_SHORT = 5123;
+	static const int GLTF_UNSIGNED_INT = 5125;
+	static const int GLTF_TRIANGLES = 4;
+
+	struct GlbAccessor {
+		uint64_t offset = 0; // from the start of the file
+		uint32_t count = 0;
+		uint32_t stride = 0;
+		int componentType = 0;
+		int components = 0;
+		bool valid = false;
+	};
+
+	struct GlbPrimitive {
+		GlbAccessor position;
+		GlbAccessor normal;
+		GlbAccessor uv;
+		GlbAccessor tangent;
+		GlbAccessor indices;
+	};
+
+	static int getComponentCount(const std::string& type)
+	{
+		if (type == "SCALAR") { return 1; }
+		if (type == "VEC2") { return 2; }
+		if (type == "VEC3") { return 3; }
+		if (type == "VEC4") { return 4; }
+		return 0;
+	}
+
+	static int getComponentSize(int componentType)
+	{
+		switch (componentType)
+		{
+		case GLTF_UNSIGNED_BYTE: return 1;
+		case GLTF_UNSIGNED_SHORT: return 2;
+		default: return 4;
+		}
+	}
+
+	static GlbAccessor resolveAccessor(const JsonValue& document, const JsonValue* index, uint64_t binOffset, uint64_t binSize)
+	{
+		GlbAccessor result;
+		const JsonValue* accessors = document.find("accessors");
+		const JsonValue* bufferViews = document.find("bufferViews");
+		if (index == nullptr || accessors == nullptr || bufferViews == nullptr) { return result; }
+
+		size_t accessorIndex = (size_t)index->number;
+		if (accessorIndex >= accessors->items.size()) { return result; }
+		const JsonValue& accessor = accessors->items[accessorIndex];
+
+		// Sparse accessors and accessors without a view aren't supported
+		size_t viewIndex = (size_t)accessor.getNumber("bufferView", -1);
+		if (accessor.find("sparse") != nullptr || viewIndex >= bufferViews->items.size()) { return result; }
+		const JsonValue& view = bufferViews->items[viewIndex];
+		if (view.getNumber("buffer", 0) != 0) { return result; }
+
+		const JsonValue* type = accessor.find("type");
+		result.componentType = (int)accessor.getNumber("componentType", 0);
+		result.components = type != nullptr ? getComponentCount(type->string) : 0;
+		result.count = (uint32_t)accessor.getNumber("count", 0);
+
+		uint32_t elementSize = (uint32_t)(getComponentSize(result.componentType) * result.components);
+		result.stride = (uint32_t)view.getNumber("byteStride", 0);
+		if (result.stride == 0) { result.stride = elementSize; }
+
+		uint64_t relativeOffset = (uint64_t)view.getNumber("byteOffset", 0) + (uint64_t)accessor.getNumber("byteOffset", 0);
+		uint64_t lastByte = result.count == 0 ? relativeOffset : relativeOffset + (uint64_t)(result.count - 1) * result.stride + elementSize;
+		if (result.components == 0 || lastByte > binSize) { return result; }
+
+		result.offset = binOffset + relativeOffset;
+		result.valid = true;
+		return result;
+	}
+
+	// Maps just the bytes an accessor covers
+	static bool mapAccessor(MappedFile& file, const GlbAccessor& accessor)
+	{
+		uint32_t elementSize = (uint32_t)(getComponentSize(accessor.componentType) * accessor.components);
+		size_t length = accessor.count == 0 ? 0 : (size_t)(accessor.count - 1) * accessor.stride + elementSize;
+		return length > 0 && file.map(accessor.offset, length);
+	}
+
+	static bool readFloatAccessor(MappedFile& file, const GlbAccessor& accessor, int components, std::vector<float>& out)
+	{
+		if (!accessor.valid || accessor.componentType != GLTF_FLOAT || accessor.components < components) { return false; }
+		if (!mapAccessor(file, accessor)) { return false; }
+
+		out.resize((size_t)accessor.count * components);
+		const char* data = file.getData();
+		for (uint32_t i = 0; i < accessor.count; i++)
+		{
+			memcpy(&out[(size_t)i * components], data + (size_t)i * accessor.stride, components * sizeof(float));
+		}
+		return true;
+	}
+
+	static bool decodePrimitive(const std::string& filePath, const GlbPrimitive& primitive, MeshData& meshData)
+	{
+		MappedFile file;
+		if (!file.open(filePath)) { return false; }
+
+		std::vector<float> positions, normals, uvs, tangents;
+		if (!readFloatAccessor(file, primitive.position, 3, positions)) { return false; }
+		bool hasNormals = readFloatAccessor(file, primitive.normal, 3, normals);
+		bool hasUVs = readFloatAccessor(file, primitive.uv, 2, uvs);
+		bool hasTangents = readFloatAccessor(file, primitive.tangent, 3, tangents);
+
+		uint32_t numVertices = primitive.position.count;
+		meshData.vertices.resize(numVertices);
+		for (uint32_t i = 0; i < numVertices; i++)
+		{
+			Vertex& vertex = meshData.vertices[i];
+			vertex.position = glm::vec3(positions[i * 3], positions[i * 3 + 1], positions[i * 3 + 2]);
+			vertex.normal = hasNormals ? glm::vec3(normals[i * 3], normals[i * 3 + 1], normals[i * 3 + 2]) : glm::vec3(0);
+			vertex.uv = hasUVs ? glm::vec2(uvs[i * 2], uvs[i * 2 + 1]) : glm::vec2(0);
+			vertex.tangent = hasTangents ? glm::vec3(tangents[i * 3], tangents[i * 3 + 1], tangents[i * 3 + 2]) : glm::vec3(0);
+		}
+
+		if (primitive.indices.valid)
+		{
+			const GlbAccessor& accessor = primitive.indices;
+			if (accessor.components != 1 || !mapAccessor(file, accessor)) { return false; }
+
+			meshData.indices.resize(accessor.count);
+			const char* data = file.getData();
+			for (uint32_t i = 0; i < accessor.count; i++)
+			{
+				const char* element = data + (size_t)i * accessor.stride;
+				unsigned int index = 0;
+				switch (accessor.componentType)
+				{
+				case GLTF_UNSIGNED_BYTE: index = *(const uint8_t*)element; break;
+				case GLTF_UNSIGNED_SHORT: { uint16_t value; memcpy(&value, element, 2); index = value; break; }
+				case GLTF_UNSIGNED_INT: memcpy(&index, element, 4); break;
+				default: return false;
+				}
+				if (index >= numVertices) { return false; }
+				meshData.indices[i] = index;
+			}
+		}
+		else
+		{
+			meshData.indices.resize(numVertices);
+			for (uint32_t i = 0; i < numVertices; i++) { meshData.indices[i] = i; }
+		}
+
+		std::vector<bool> missingNormals(hasNormals ? 0 : numVertices, true);
+		if (!hasNormals || !hasTangents)
+		{
+			missingNormals.resize(numVertices, !hasNormals);
+			generateNormalsAndTangents(meshData, missingNormals, !hasTangents);
+		}
+		return true;
+	}
+
+	bool loadGLB(const std::string& filePath, MeshData& meshData, ModelLoadStats* stats)
+	{
+		double startTime = getSeconds();
+
+		MappedFile file;
+		if (!file.open(filePath) || !file.map(0, 20))
+		{
+			printf("Failed to open model %s\n", filePath.c_str());
+			return false;
+		}
+
+		uint32_t header[5];
+		memcpy(header, file.getData(), sizeof(header));
+		if (header[0] != GLB_MAGIC || header[1] != 2 || header[4] != GLB_CHUNK_JSON)
+		{
+			printf("%s is not a glTF 2.0 binary\n", filePath.c_str());
+			return false;
+		}
+
+		uint64_t fileSize = file.getFileSize();
+		uint64_t jsonOffset = 20;
+		uint64_t jsonSize = header[3];
+		uint64_t binOffset = 0;
+		uint64_t binSize = 0;
+
+		// The binary chunk follows the (4 byte aligned) JSON chunk
+		uint64_t binHeaderOffset = jsonOffset + ((jsonSize + 3) & ~3ull);
+		if (binHeaderOffset + 8 <= fileSize && file.map(binHeaderOffset, 8))
+		{
+			uint32_t binHeader[2];
+			memcpy(binHeader, file.getData(), sizeof(binHeader));
+			if (binHeader[1] == GLB_CHUNK_BIN)
+			{
+				binOffset = binHeaderOffset + 8;
+				binSize = std::min<uint64_t>(binHeader[0], fileSize - binOffset);
+			}
+		}
+
+		JsonValue document;
+		if (!file.map(jsonOffset, (size_t)jsonSize)) { return false; }
+		JsonParser parser = { file.getData(), file.getData() + file.getSize() };
+		if (!parser.parseValue(document, 0))
+		{
+			printf("Invalid JSON in %s\n", filePath.c_str());
+			return false;
+		}
+		file.close();
+
+		std::vector<GlbPrimitive> primitives;
+		const JsonValue* meshes = document.find("meshes");
+		if (meshes != nullptr)
+		{
+			for (const JsonValue& mesh : meshes->items)
+			{
+				const JsonValue* meshPrimitives = mesh.find("primitives");
+				if (meshPrimitives == nullptr) { continue; }
+				for (const JsonValue& primitive : meshPrimitives->items)
+				{
+					const JsonValue* attributes = primitive.find("attributes");
+					if (attributes == nullptr || primitive.getNumber("mode", GLTF_TRIANGLES) != GLTF_TRIANGLES) { continue; }
+
+					GlbPrimitive entry;
+					entry.position = resolveAccessor(document, attributes->find("POSITION"), binOffset, binSize);
+					entry.normal = resolveAccessor(document, attributes->find("NORMAL"), binOffset, binSize);
+					entry.uv = resolveAccessor(document, attributes->find("TEXCOORD_0"), binOffset, binSize);
+					entry.tangent = resolveAccessor(document, attributes->find("TANGENT"), binOffset, binSize);
+					entry.indices = resolveAccessor(document, primitive.find("indices"), binOffset, binSize);
+					if (entry.position.valid) { primitives.push_back(entry); }
+				}
+			}
+		}
+
+		if (primitives.empty())
+		{
+			printf("No triangle meshes in %s\n", filePath.c_str());
+			return false;
+		}
+
+		// Decode the primitives on one worker per core, each taking the next one left, then concatenate
+		std::vector<MeshData> decoded(primitives.size());
+		std::vector<char> results(primitives.size(), 0);
+		std::atomic<size_t> nextPrimitive(0);
+		auto decodeNext = [&]()
+		{
+			for (size_t i = nextPrimitive++; i < primitives.size(); i = nextPrimitive++)
+			{
+				results[i] = decodePrimitive(filePath, primitives[i], decoded[i]) ? 1 : 0;
+			}
+		};
+		unsigned int threadCount = (unsigned int)std::min<size_t>(getThreadCount(), primitives.size());
+		std::vector<std::thread> workers;
+		for (unsigned int i = 1; i < threadCount; i++) { workers.emplace_back(decodeNext); }
+		// The calling thread is the last worker
+		decodeNext();
+		for (std::thread& worker : workers) { worker.join(); }
+
+		meshData.vertices.clear();
+		meshData.indices.clear();
+		bool success = true;
+		for (size_t i = 0; i < primitives.size(); i++)
+		{
+			if (!results[i])
+			{
+				printf("Failed to decode primitive %zu of %s\n", i, filePath.c_str());
+				success = false;
+				continue;
+			}
+			unsigned int baseVertex = (unsigned int)meshData.vertices.size();
+			meshData.vertices.insert(meshData.vertices.end(), decoded[i].vertices.begin(), decoded[i].vertices.end());
+			for (unsigned int index : decoded[i].indices) { meshData.indices.push_back(baseVertex + index); }
+		}
+
+		if (stats != nullptr)
+		{
+			stats->fileSize = fileSize;
+			stats->seconds = getSeconds() - startTime;
+			stats->threads = threadCount;
+			stats->numTriangles = (unsigned int)(meshData.indices.size() / 3);
+			stats->numVertices = (unsigned int)meshData.vertices.size();
+		}
+		return success && !meshData.indices.empty();
+	}
+
+	bool loadModel(const std::string& filePath, MeshData& meshData, ModelLoadStats* stats)
+	{
+		std::string extension = filePath.substr(filePath.find_last_of('.') + 1);
+		std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return (char)tolower(c); });
+
+		if (extension == "obj") { return loadOBJ(filePath, meshData, stats); }
+		if (extension == "glb") { return loadGLB(filePath, meshData, stats); }
+
+		printf("Unsupported model format %s\n", filePath.c_str());
+		return false;
+	}
+}
@@ -0,0 +1,38 @@
+#pragma once
+#include "Mesh.h"
+#include <cstdint>
+#include <string>
+
+namespace ew {
+	/// <summary>
+	/// Filled in by the loaders, for measuring parse throughput
+	/// </summary>
+	struct ModelLoadStats {
+		uint64_t fileSize = 0;
+		double seconds = 0.0;
+		unsigned int threads = 0;
+		unsigned int numTriangles = 0;
+		unsigned int numVertices = 0;
+		double getMegabytesPerSecond() const { return seconds > 0.0 ? (fileSize / (1024.0 * 1024.0)) / seconds : 0.0; }
+	};
+
+	/// <summary>
+	/// Wavefront OBJ. The file is memory mapped a window at a time, each window is split
+	/// at line breaks and parsed on every core. Corners are then deduplicated into vertices.
+	/// Polygons are fan triangulated. Normals are generated when the file has none,
+	/// tangents are always generated.
+	/// </summary>
+	bool loadOBJ(const std::string& filePath, MeshData& meshData, ModelLoadStats* stats = nullptr);
+
+	/// <summary>
+	/// Binary glTF 2.0 (.glb). Every triangle primitive of every mesh is merged into meshData,
+	/// without node transforms. Primitives are decoded in parallel, each mapping only the
+	/// buffer ranges it reads. Tangents are generated when the file has none.
+	/// </summary>
+	bool loadGLB(const std::string& filePath, MeshData& meshData, ModelLoadStats* stats = nullptr);
+
+	/// <summary>
+	/// Picks a loader from the file extension (.obj or .glb)
+	/// </summary>
+	bool loadModel(const std::string& filePath, MeshData& meshData, ModelLoadStats* stats = nullptr);
+}
@@ -0,0 +1,111 @@
+#include "PostChain.h"
+
+namespace ew {
+	const GLuint POST_GROUP_SIZE = 8;
+	const GLuint POST_SOURCE_UNIT = 4;
+
+	const char* getPostEffectName(int effect)
+	{
+		static const char* names[NUM_POST_EFFECTS] = { "None", "Invert", "Red Overlay", "Zooming Out", "Wave", "Blur" };
+		return effect >= 0 && effect < NUM_POST_EFFECTS ? names[effect] : "Unknown";
+	}
+
+	bool isNeighborhoodEffect(int effect)
+	{
+		return effect == POST_EFFECT_ZOOM_OUT || effect == POST_EFFECT_WAVE || effect == POST_EFFECT_BLUR;
+	}
+
+	PostChain::PostChain(std::string computeShaderPath) : mVariants(computeShaderPath)
+	{
+	}
+
+	void PostChain::setEffects(const std::vector<int>& effects)
+	{
+		if (effects == mEffects) { return; }
+		mEffects = effects;
+		mStages = buildStages(effects);
+
+		// Starts the compiles now, swapped in by update once they're done
+		for (const Stage& stage : mStages) { mVariants.get(getStageDefines(stage)); }
+		update();
+	}
+
+	void PostChain::prewarm(const std::vector<std::vector<int>>& chains)
+	{
+		for (const std::vector<int>& effects : chains)
+		{
+			for (const Stage& stage : buildStages(effects)) { mVariants.get(getStageDefines(stage)); }
+		}
+	}
+
+	void PostChain::update()
+	{
+		mVariants.update();
+		for (const Stage& stage : mStages)
+		{
+			if (!mVariants.get(getStageDefines(stage)).isReady()) { return; }
+		}
+		mActiveStages = mStages;
+	}
+
+	GLuint PostChain::apply(RenderTargetPool& pool, GLuint sourceTexture, int width, int height, float time, GLuint destination)
+	{
+		GLuint input = sourceTexture;
+		for (size_t i = 0; i < mActiveStages.size(); i++)
+		{
+			const Stage& stage = mActiveStages[i];
+			bool last = i + 1 == mActiveStages.size();
+			GLuint output = last && destination != 0 ? destination : pool.acquire(width, height, GL_RGBA8);
+
+			Shader& shader = mVariants.get(getStageDefines(stage));
+			shader.use();
+			shader.setFloat("time", time);
+			glBindTextureUnit(POST_SOURCE_UNIT, input);
+			glBindImageTexture(0, output, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA8);
+			glDispatchCompute((width + POST_GROUP_SIZE - 1) / POST_GROUP_SIZE, (height + POST_GROUP_SIZE - 1) / POST_GROUP_SIZE, 1);
+
+			// The next stage samples it, or it gets blitted. A destination is the caller's to synchronize
+			if (output != destination) { glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT | GL_FRAMEBUFFER_BARRIER_BIT); }
+
+			// Commands run in order, so the next stage can already write over it
+			if (input != sourceTexture) { pool.release(input); }
+			input = output;
+		}
+		return input;
+	}
+
+	std::vector<PostChain::Stage> PostChain::buildStages(const std::vector<int>& effects)
+	{
+		std::vector<Stage> stages;
+		Stage stage;
+		for (int effect : effects)
+		{
+			if (effect == POST_EFFECT_NONE) { continue; }
+
+			bool stageEmpty = stage.gatherEffect == POST_EFFECT_NONE && stage.pointwiseEffects.empty();
+			if (isNeighborhoodEffect(effect))
+			{
+				// What came before has to be written out for its neighbors to be sampled
+				if (!stageEmpty) { stages.push_back(stage); stage = Stage(); }
+				stage.gatherEffect = effect;
+			}
+			else
+			{
+				if ((int)stage.pointwiseEffects.size() == MAX_FUSED_EFFECTS) { stages.push_back(stage); stage = Stage(); }
+				stage.pointwiseEffects.push_back(effect);
+			}
+		}
+		if (stage.gatherEffect != POST_EFFECT_NONE || !stage.pointwiseEffects.empty()) { stages.push_back(stage); }
+		return stages;
+	}
+
+	ShaderDefines PostChain::getStageDefines(const Stage& stage)
+	{
+		ShaderDefines defines = { { "GATHER_EFFECT", stage.gatherEffect }, { "NUM_POINTWISE", (int)stage.pointwiseEffects.size() } };
+		for (size_t i = 0; i < stage.pointwiseEffects.size(); i++)
+		{
+			defines["POINTWISE_" + std::to_string(i)] = stage.pointwiseEffects[i];
+		}
+		return defines;
+	}
+}
@@ -0,0 +1,78 @@
+#pragma once
+#include <GL/glew.h>
+#include "ShaderVariants.h"
+#include "RenderTargetPool.h"
+#include <vector>
+
+namespace ew {
+	// Must match the EFFECT_ defines in postprocessing.comp
+	enum PostEffect {
+		POST_EFFECT_NONE = 0,
+		POST_EFFECT_INVERT,
+		POST_EFFECT_RED_OVERLAY,
+		POST_EFFECT_ZOOM_OUT,
+		POST_EFFECT_WAVE,
+		POST_EFFECT_BLUR,
+		NUM_POST_EFFECTS
+	};
+
+	const char* getPostEffectName(int effect);
+	/// <summary>
+	/// Effects that read pixels other than their own, and so need the previous effects written out first
+	/// </summary>
+	bool isNeighborhoodEffect(int effect);
+
+	/// <summary>
+	/// Ordered list of post effects run as compute dispatches (shaders/postprocessing.comp).
+	/// Per-pixel effects are fused into the dispatch before them; a new dispatch only starts
+	/// at a neighborhood effect, reading the previous one's output. Outputs come from a
+	/// RenderTargetPool and each intermediate goes back as soon as it's read, so the stages
+	/// ping-pong between two textures however long the chain is.
+	/// </summary>
+	class PostChain {
+	public:
+		PostChain(std::string computeShaderPath);
+		/// <summary>
+		/// None entries are skipped. The new chain replaces the current one once
+		/// all of its stages have compiled, until then the current one keeps running
+		/// </summary>
+		void setEffects(const std::vector<int>& effects);
+		/// <summary>
+		/// Starts compiling the stages of chains likely to be selected soon
+		/// </summary>
+		void prewarm(const std::vector<std::vector<int>>& chains);
+		/// <summary>
+		/// Frame boundary, where a newly compiled chain is swapped in
+		/// </summary>
+		void update();
+		/// <summary>
+		/// No stages, the source can be presented as is
+		/// </summary>
+		bool isIdentity() const { return mActiveStages.empty(); }
+		/// <summary>
+		/// Runs every stage over sourceTexture (width x height), which stays the caller's.
+		/// Returns a texture acquired from pool holding the result, for the caller to release.
+		/// With a destination the last stage writes there instead, and destination is returned
+		/// without a memory barrier after it
+		/// </summary>
+		GLuint apply(RenderTargetPool& pool, GLuint sourceTexture, int width, int height, float time, GLuint destination = 0);
+		int getNumStages() const { return (int)mActiveStages.size(); }
+		ShaderVariants& getVariants() { return mVariants; }
+	private:
+		PostChain(const PostChain& r) = delete;
+		static const int MAX_FUSED_EFFECTS = 4;
+
+		struct Stage {
+			int gatherEffect = POST_EFFECT_NONE;
+			std::vector<int> pointwiseEffects;
+		};
+
+		static std::vector<Stage> buildStages(const std::vector<int>& effects);
+		static ShaderDefines getStageDefines(const Stage& stage);
+
+		ShaderVariants mVariants;
+		std::vector<int> mEffects;
+		std::vector<Stage> mStages;
+		std::vector<Stage> mActiveStages;
+	};
+}
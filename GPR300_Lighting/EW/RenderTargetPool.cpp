@@ -0,0 +1,118 @@
+#include "RenderTargetPool.h"
+#include <algorithm>
+
+namespace ew {
+	RenderTargetPool::~RenderTargetPool()
+	{
+		while (!mTextures.empty()) { deleteTexture(mTextures.size() - 1); }
+	}
+
+	GLuint RenderTargetPool::acquire(int width, int height, GLenum format)
+	{
+		mNumAcquired++;
+		if (mNumAcquired > mPeakThisFrame) { mPeakThisFrame = mNumAcquired; }
+
+		for (Texture& texture : mTextures)
+		{
+			if (!texture.acquired && texture.width == width && texture.height == height && texture.format == format)
+			{
+				texture.acquired = true;
+				texture.lastUsedFrame = mFrame;
+				return texture.id;
+			}
+		}
+
+		Texture texture = { 0, width, height, format, true, mFrame };
+		glCreateTextures(GL_TEXTURE_2D, 1, &texture.id);
+		glTextureStorage2D(texture.id, 1, format, width, height);
+
+		bool isDepth = format == GL_DEPTH_COMPONENT32F || format == GL_DEPTH_COMPONENT24 || format == GL_DEPTH_COMPONENT16 || format == GL_DEPTH24_STENCIL8 || format == GL_DEPTH32F_STENCIL8;
+		glTextureParameteri(texture.id, GL_TEXTURE_MIN_FILTER, isDepth ? GL_NEAREST : GL_LINEAR);
+		glTextureParameteri(texture.id, GL_TEXTURE_MAG_FILTER, isDepth ? GL_NEAREST : GL_LINEAR);
+
+		mMemoryBytes += getBytesPerPixel(format) * width * height;
+		mTextures.push_back(texture);
+		return texture.id;
+	}
+
+	void RenderTargetPool::release(GLuint texture)
+	{
+		for (Texture& pooled : mTextures)
+		{
+			if (pooled.id == texture && pooled.acquired)
+			{
+				pooled.acquired = false;
+				mNumAcquired--;
+				return;
+			}
+		}
+	}
+
+	GLuint RenderTargetPool::getFramebuffer(const std::vector<GLuint>& colorTextures, GLuint depthTexture)
+	{
+		GLuint& fbo = mFramebuffers[{ colorTextures, depthTexture }];
+		if (fbo == 0)
+		{
+			glCreateFramebuffers(1, &fbo);
+			std::vector<GLenum> drawBuffers;
+			for (size_t i = 0; i < colorTextures.size(); i++)
+			{
+				glNamedFramebufferTexture(fbo, GL_COLOR_ATTACHMENT0 + (GLenum)i, colorTextures[i], 0);
+				drawBuffers.push_back(GL_COLOR_ATTACHMENT0 + (GLenum)i);
+			}
+			if (drawBuffers.empty()) { glNamedFramebufferDrawBuffer(fbo, GL_NONE); }
+			else { glNamedFramebufferDrawBuffers(fbo, (GLsizei)drawBuffers.size(), drawBuffers.data()); }
+			if (depthTexture != 0) { glNamedFramebufferTexture(fbo, GL_DEPTH_ATTACHMENT, depthTexture, 0); }
+		}
+		return fbo;
+	}
+
+	GLuint RenderTargetPool::getFramebuffer(GLuint colorTexture, GLuint depthTexture)
+	{
+		return colorTexture != 0 ? getFramebuffer(std::vector<GLuint>{ colorTexture }, depthTexture) : getFramebuffer(std::vector<GLuint>(), depthTexture);
+	}
+
+	void RenderTargetPool::endFrame()
+	{
+		for (size_t i = mTextures.size(); i-- > 0;)
+		{
+			if (!mTextures[i].acquired && mFrame - mTextures[i].lastUsedFrame >= FRAMES_BEFORE_FREE) { deleteTexture(i); }
+		}
+
+		mPeakAcquired = mPeakThisFrame;
+		mPeakThisFrame = mNumAcquired;
+		mFrame++;
+	}
+
+	void RenderTargetPool::deleteTexture(size_t index)
+	{
+		GLuint id = mTextures[index].id;
+		for (auto it = mFramebuffers.begin(); it != mFramebuffers.end();)
+		{
+			const std::vector<GLuint>& colors = it->first.first;
+			if (std::find(colors.begin(), colors.end(), id) != colors.end() || it->first.second == id)
+			{
+				glDeleteFramebuffers(1, &it->second);
+				it = mFramebuffers.erase(it);
+			}
+			else { ++it; }
+		}
+
+		if (mTextures[index].acquired) { mNumAcquired--; }
+		mMemoryBytes -= getBytesPerPixel(mTextures[index].format) * mTextures[index].width * mTextures[index].height;
+		glDeleteTextures(1, &id);
+		mTextures.erase(mTextures.begin() + index);
+	}
+
+	GLsizeiptr RenderTargetPool::getBytesPerPixel(GLenum format)
+	{
+		switch (format)
+		{
+		case GL_R8: return 1;
+		case GL_RG8: case GL_R16F: case GL_DEPTH_COMPONENT16: return 2;
+		case GL_RGBA32F: return 16;
+		case GL_RGBA16F: case GL_RGBA16: case GL_RG32F: case GL_DEPTH32F_STENCIL8: return 8;
+		default: return 4;
+		}
+	}
+}
@@ -0,0 +1,62 @@
+#pragma once
+#include <GL/glew.h>
+#include <map>
+#include <utility>
+#include <vector>
+
+namespace ew {
+	/// <summary>
+	/// Transient render target textures, handed out by size and format. A pass acquires
+	/// what it writes and releases what it no longer reads, so later passes of the same
+	/// frame reuse that memory. Sizes follow whatever is asked for: after a resize the
+	/// old textures go unused and are freed a few frames later.
+	/// </summary>
+	class RenderTargetPool {
+	public:
+		RenderTargetPool() = default;
+		~RenderTargetPool();
+		/// <summary>
+		/// A texture not currently acquired, created if none matches. Single level, linear filtered
+		/// (nearest for depth formats)
+		/// </summary>
+		GLuint acquire(int width, int height, GLenum format);
+		void release(GLuint texture);
+		/// <summary>
+		/// Framebuffer with these attachments, created on first use and kept while its textures live.
+		/// Colors go to GL_COLOR_ATTACHMENT0 onwards, all of them drawn to
+		/// </summary>
+		GLuint getFramebuffer(const std::vector<GLuint>& colorTextures, GLuint depthTexture = 0);
+		GLuint getFramebuffer(GLuint colorTexture, GLuint depthTexture = 0);
+		/// <summary>
+		/// Frees the textures nobody acquired for a few frames
+		/// </summary>
+		void endFrame();
+
+		int getNumTextures() const { return (int)mTextures.size(); }
+		int getPeakAcquired() const { return mPeakAcquired; }
+		GLsizeiptr getMemoryBytes() const { return mMemoryBytes; }
+		static GLsizeiptr getBytesPerPixel(GLenum format);
+	private:
+		RenderTargetPool(const RenderTargetPool& r) = delete;
+		static const int FRAMES_BEFORE_FREE = 3;
+
+		struct Texture {
+			GLuint id;
+			int width;
+			int height;
+			GLenum format;
+			bool acquired;
+			int lastUsedFrame;
+		};
+
+		void deleteTexture(size_t index);
+
+		std::vector<Texture> mTextures;
+		std::map<std::pair<std::vector<GLuint>, GLuint>, GLuint> mFramebuffers;
+		GLsizeiptr mMemoryBytes = 0;
+		int mFrame = 0;
+		int mNumAcquired = 0;
+		int mPeakAcquired = 0;
+		int mPeakThisFrame = 0;
+	};
+}
@@ -1,8 +1,15 @@
 //Author: Eric Winebrenner
 
 #include "Shader.h"
+#include "Hash.h"
+#include "ShaderCompileWorker.h"
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <filesystem>
 #include <fstream>
 #include <sstream>
+#include <thread>
 
 #include <glm/vec3.hpp> // glm::vec3
 #include <glm/vec4.hpp> // glm::vec4
@@ -10,36 +17,416 @@
 #include <glm/ext/matrix_transform.hpp> // glm::translate, glm::rotate, glm::scale
 #include <glm/gtc/type_ptr.hpp>
 
-Shader::Shader(std::string vertexShaderPath, std::string fragmentShaderPath)
+std::string Shader::sBinaryCacheDirectory;
+bool Shader::sAsyncCompile = false;
+ew::ShaderCompileWorker* Shader::sCompileWorker = nullptr;
+
+//Header of a cached program binary, followed by the binary itself
+struct ProgramBinaryHeader {
+	uint32_t magic;
+	uint32_t version;
+	uint64_t key;
+	uint32_t format;
+	uint32_t length;
+};
+static const uint32_t PROGRAM_BINARY_MAGIC = 0x42505745; //"EWPB"
+static const uint32_t PROGRAM_BINARY_VERSION = 1;
+
+//A program being compiled and linked, possibly in the background
+struct Shader::Build {
+	GLuint program;
+	uint64_t key;
+	bool fromBinaryCache = false;
+	bool usesWorker = false;
+	std::atomic<bool> workerDone{ false };
+	std::vector<PendingShader> shaders;
+};
+
+Shader::Shader(std::string vertexShaderPath, std::string fragmentShaderPath, const ShaderDefines& defines)
+	: mDefines(defines)
+{
+	mSourcePaths = { { GL_VERTEX_SHADER, vertexShaderPath }, { GL_FRAGMENT_SHADER, fragmentShaderPath } };
+	createProgram();
+}
+
+Shader::Shader(std::string computeShaderPath, const ShaderDefines& defines)
+	: mDefines(defines)
+{
+	mSourcePaths = { { GL_COMPUTE_SHADER, computeShaderPath } };
+	createProgram();
+}
+
+Shader::~Shader()
+{
+	//A worker may still be writing to the build
+	waitUntilReady();
+	glDeleteProgram(m_id);
+}
+
+void Shader::setBinaryCacheDirectory(const std::string& directory)
+{
+	sBinaryCacheDirectory = directory;
+}
+
+void Shader::setAsyncCompile(bool enabled, ew::ShaderCompileWorker* worker)
+{
+	sAsyncCompile = enabled;
+	sCompileWorker = worker;
+
+	//Let the driver use as many threads as it likes
+	if (enabled && GLEW_KHR_parallel_shader_compile)
+	{
+		glMaxShaderCompilerThreadsKHR(0xFFFFFFFF);
+	}
+}
+
+void Shader::createProgram()
+{
+	m_id = 0;
+	mLinked = false;
+	mFromBinaryCache = false;
+	mReloadRequested = false;
+	startBuild();
+}
+
+bool Shader::usesFile(const std::string& filePath) const
+{
+	for (const SourcePath& source : mSourcePaths)
+	{
+		if (source.path == filePath) { return true; }
+	}
+	return false;
+}
+
+std::vector<std::string> Shader::getSourcePaths() const
+{
+	std::vector<std::string> paths;
+	for (const SourcePath& source : mSourcePaths) { paths.push_back(source.path); }
+	return paths;
+}
+
+void Shader::reload()
 {
-	std::string vertexShaderString = readFile(vertexShaderPath);
-	GLuint vertexShader = compileShader(vertexShaderString.c_str(), GL_VERTEX_SHADER);
+	//Picked up by isReady once the current build, if any, is finished
+	mReloadRequested = true;
+	isReady();
+}
 
-	std::string fragmentShaderString = readFile(fragmentShaderPath);
-	GLuint fragmentShader = compileShader(fragmentShaderString.c_str(), GL_FRAGMENT_SHADER);
+void Shader::startBuild()
+{
+	std::vector<Stage> stages;
+	for (const SourcePath& source : mSourcePaths)
+	{
+		stages.push_back({ source.type, injectDefines(readFile(source.path), mDefines) });
+	}
 
+	mBuild = std::make_unique<Build>();
+	Build* build = mBuild.get();
 	//Create an empty shader program
-	m_id = glCreateProgram();
+	build->program = glCreateProgram();
+	build->key = getBinaryKey(stages);
+
+	if (loadProgramBinary(build->program, build->key))
+	{
+		build->fromBinaryCache = true;
+		finishBuild();
+		return;
+	}
+
+	//Must be set before linking for the driver to keep the binary around
+	glProgramParameteri(build->program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+
+	if (sAsyncCompile && !GLEW_KHR_parallel_shader_compile && sCompileWorker != nullptr)
+	{
+		//glFinish makes the finished program visible to the main context before we flag it
+		build->usesWorker = true;
+		sCompileWorker->push([build, stages]() {
+			compileAndLink(*build, stages);
+			glFinish();
+			build->workerDone.store(true, std::memory_order_release);
+		});
+		return;
+	}
+
+	compileAndLink(*build, stages);
+
+	//With parallel compile the driver keeps working until GL_COMPLETION_STATUS_KHR says it's done
+	if (!sAsyncCompile || !GLEW_KHR_parallel_shader_compile)
+	{
+		finishBuild();
+	}
+}
+
+//Defines go right after #version, which has to stay first.
+//#line keeps compile errors pointing at the right line of the file
+std::string Shader::injectDefines(const std::string& source, const ShaderDefines& defines)
+{
+	if (defines.empty()) { return source; }
+
+	size_t version = source.find("#version");
+	size_t insertAt = version == std::string::npos ? 0 : source.find('\n', version);
+	insertAt = insertAt == std::string::npos ? source.size() : insertAt + 1;
+	int nextLine = 1 + (int)std::count(source.begin(), source.begin() + insertAt, '\n');
 
-	//Attach our shader objects
-	glAttachShader(m_id, vertexShader);
-	glAttachShader(m_id, fragmentShader);
+	std::string injected;
+	for (const auto& define : defines)
+	{
+		injected += "#define " + define.first + " " + std::to_string(define.second) + "\n";
+	}
+	injected += "#line " + std::to_string(nextLine) + "\n";
+
+	return source.substr(0, insertAt) + injected + source.substr(insertAt);
+}
+
+//Issues the work without asking for any results, so nothing here waits on the compiler
+void Shader::compileAndLink(Build& build, const std::vector<Stage>& stages)
+{
+	for (const Stage& stage : stages)
+	{
+		const char* source = stage.source.c_str();
+		GLuint shader = glCreateShader(stage.type);
+		//Provides the source code to the object.
+		glShaderSource(shader, 1, &source, NULL);
+		//Compiles the shader source
+		glCompileShader(shader);
+		//Attach our shader objects
+		glAttachShader(build.program, shader);
+		build.shaders.push_back({ stage.type, shader });
+	}
 
 	//Link program - will create an executable program with the attached shaders
-	glLinkProgram(m_id);
+	glLinkProgram(build.program);
+}
+
+bool Shader::isReady()
+{
+	if (mBuild != nullptr)
+	{
+		if (mBuild->usesWorker)
+		{
+			if (!mBuild->workerDone.load(std::memory_order_acquire)) { return mLinked; }
+		}
+		else
+		{
+			GLint complete = GL_FALSE;
+			glGetProgramiv(mBuild->program, GL_COMPLETION_STATUS_KHR, &complete);
+			if (!complete) { return mLinked; }
+		}
+		finishBuild();
+	}
+
+	if (mReloadRequested && mBuild == nullptr)
+	{
+		mReloadRequested = false;
+		startBuild();
+	}
+	return mLinked;
+}
+
+bool Shader::waitUntilReady()
+{
+	if (mBuild != nullptr)
+	{
+		if (mBuild->usesWorker)
+		{
+			while (!mBuild->workerDone.load(std::memory_order_acquire)) { std::this_thread::yield(); }
+		}
+		//Otherwise the status queries in finishBuild block until the driver is done
+		finishBuild();
+	}
+	return mLinked;
+}
+
+//Swaps a successful build in. A failed one is thrown away and the previous program, if any, stays
+void Shader::finishBuild()
+{
+	std::unique_ptr<Build> build = std::move(mBuild);
+
+	for (const PendingShader& pending : build->shaders)
+	{
+		logCompileErrors(pending.shader, pending.type);
+		glDetachShader(build->program, pending.shader);
+		glDeleteShader(pending.shader);
+	}
 
 	//Logging
 	int success;
-	glGetProgramiv(m_id, GL_LINK_STATUS, &success);
+	glGetProgramiv(build->program, GL_LINK_STATUS, &success);
 	if (!success) {
 
 		GLchar infoLog[512];
-		glGetProgramInfoLog(m_id, 512, NULL, infoLog);
+		glGetProgramInfoLog(build->program, 512, NULL, infoLog);
 		printf("Failed to link shader program: %s", infoLog);
+		glDeleteProgram(build->program);
+		if (mLinked) { printf("Keeping the previous %s program\n", mSourcePaths.back().path.c_str()); }
+		return;
+	}
+
+	if (m_id != 0)
+	{
+		printf("Reloaded %s\n", mSourcePaths.back().path.c_str());
+		glDeleteProgram(m_id);
+	}
+
+	m_id = build->program;
+	mLinked = true;
+	mFromBinaryCache = build->fromBinaryCache;
+	reflectUniforms();
+
+	if (!build->fromBinaryCache)
+	{
+		saveProgramBinary(m_id, build->key);
+	}
+}
+
+//Binaries are only valid for the driver that produced them, so it's part of the key
+uint64_t Shader::getBinaryKey(const std::vector<Stage>& stages)
+{
+	uint64_t key = ew::FNV_OFFSET_BASIS;
+	for (GLenum name : { GL_VENDOR, GL_RENDERER, GL_VERSION })
+	{
+		const char* string = (const char*)glGetString(name);
+		if (string != nullptr) { key = ew::hashBytes(string, strlen(string), key); }
 	}
+	for (const Stage& stage : stages)
+	{
+		key = ew::hashBytes(&stage.type, sizeof(stage.type), key);
+		key = ew::hashBytes(stage.source.data(), stage.source.size(), key);
+	}
+	return key;
+}
 
-	glDeleteShader(vertexShader);
-	glDeleteShader(fragmentShader);
+std::string Shader::getBinaryPath(uint64_t key)
+{
+	char fileName[32];
+	snprintf(fileName, sizeof(fileName), "%016llx.glbin", (unsigned long long)key);
+	return sBinaryCacheDirectory + fileName;
+}
+
+bool Shader::loadProgramBinary(GLuint program, uint64_t key)
+{
+	if (sBinaryCacheDirectory.empty()) { return false; }
+
+	std::ifstream file(getBinaryPath(key), std::ios::binary);
+	if (!file.is_open()) { return false; }
+
+	ProgramBinaryHeader header;
+	if (!file.read((char*)&header, sizeof(header))
+		|| header.magic != PROGRAM_BINARY_MAGIC || header.version != PROGRAM_BINARY_VERSION || header.key != key)
+	{
+		return false;
+	}
+
+	std::vector<char> binary(header.length);
+	if (!file.read(binary.data(), header.length)) { return false; }
+
+	//The driver may still reject it (e.g. after an update), in which case we build from source
+	glProgramBinary(program, header.format, binary.data(), header.length);
+	int success;
+	glGetProgramiv(program, GL_LINK_STATUS, &success);
+	return success;
+}
+
+void Shader::saveProgramBinary(GLuint program, uint64_t key)
+{
+	if (sBinaryCacheDirectory.empty()) { return; }
+
+	GLint length = 0;
+	glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+	if (length <= 0) { return; }
+
+	ProgramBinaryHeader header = { PROGRAM_BINARY_MAGIC, PROGRAM_BINARY_VERSION, key, 0, 0 };
+	std::vector<char> binary(length);
+	GLsizei written = 0;
+	glGetProgramBinary(program, length, &written, (GLenum*)&header.format, binary.data());
+	header.length = (uint32_t)written;
+
+	std::error_code error;
+	std::filesystem::create_directories(sBinaryCacheDirectory, error);
+
+	//Written to a temporary first so a crash never leaves a truncated binary behind
+	std::string filePath = getBinaryPath(key);
+	std::string tempPath = filePath + ".tmp";
+	std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+	if (!file.is_open())
+	{
+		printf("Failed to write program binary %s\n", filePath.c_str());
+		return;
+	}
+	file.write((const char*)&header, sizeof(header));
+	file.write(binary.data(), written);
+	file.close();
+
+	std::filesystem::rename(tempPath, filePath, error);
+}
+
+void Shader::reflectUniforms()
+{
+	mUniforms.clear();
+	mUniformNames.clear();
+
+	GLint numUniforms = 0;
+	GLint maxNameLength = 0;
+	glGetProgramInterfaceiv(m_id, GL_UNIFORM, GL_ACTIVE_RESOURCES, &numUniforms);
+	glGetProgramInterfaceiv(m_id, GL_UNIFORM, GL_MAX_NAME_LENGTH, &maxNameLength);
+
+	std::vector<GLchar> nameBuffer(std::max(maxNameLength, 1));
+	const GLenum properties[] = { GL_LOCATION, GL_ARRAY_SIZE };
+
+	for (GLint i = 0; i < numUniforms; i++)
+	{
+		GLint values[2];
+		glGetProgramResourceiv(m_id, GL_UNIFORM, i, 2, properties, 2, NULL, values);
+
+		//Uniform block members have no location
+		GLint location = values[0];
+		if (location < 0) { continue; }
+
+		GLsizei nameLength = 0;
+		glGetProgramResourceName(m_id, GL_UNIFORM, i, (GLsizei)nameBuffer.size(), &nameLength, nameBuffer.data());
+		std::string name(nameBuffer.data(), nameLength);
+		addUniform(name, location);
+
+		//Arrays are reported once as "name[0]". Register the bare name and every element
+		size_t bracket = name.size() > 3 && name.compare(name.size() - 3, 3, "[0]") == 0 ? name.size() - 3 : std::string::npos;
+		if (bracket != std::string::npos)
+		{
+			std::string baseName = name.substr(0, bracket);
+			addUniform(baseName, location);
+			for (GLint element = 1; element < values[1]; element++)
+			{
+				addUniform(baseName + "[" + std::to_string(element) + "]", location + element);
+			}
+		}
+	}
+
+	std::sort(mUniforms.begin(), mUniforms.end(), [](const UniformEntry& a, const UniformEntry& b) { return a.hash < b.hash; });
+}
+
+void Shader::addUniform(const std::string& name, GLint location)
+{
+	UniformEntry entry;
+	entry.hash = UniformName::hashString(name);
+	entry.location = location;
+	entry.nameOffset = (uint32_t)mUniformNames.size();
+	entry.nameLength = (uint32_t)name.size();
+	mUniformNames += name;
+	mUniforms.push_back(entry);
+}
+
+UniformHandle Shader::getUniform(UniformName name) const
+{
+	auto entry = std::lower_bound(mUniforms.begin(), mUniforms.end(), name.hash, [](const UniformEntry& a, uint32_t hash) { return a.hash < hash; });
+
+	//Names are compared too, in case two hash the same
+	for (; entry != mUniforms.end() && entry->hash == name.hash; entry++)
+	{
+		if (std::string_view(mUniformNames.data() + entry->nameOffset, entry->nameLength) == name.name)
+		{
+			return UniformHandle{ entry->location };
+		}
+	}
+	return UniformHandle();
 }
 
 void Shader::use()
@@ -47,28 +434,34 @@ void Shader::use()
 	glUseProgram(m_id);
 }
 
-void Shader::setFloat(std::string name, float value)
+//Invalid handles are location -1, which GL silently ignores
+void Shader::setFloat(UniformHandle uniform, float value)
 {
-	glProgramUniform1f(m_id, glGetUniformLocation(m_id, name.c_str()), value);
+	glProgramUniform1f(m_id, uniform.location, value);
 }
 
-void Shader::setInt(std::string name, int value)
+void Shader::setInt(UniformHandle uniform, int value)
 {
-	glProgramUniform1i(m_id, glGetUniformLocation(m_id, name.c_str()), value);
+	glProgramUniform1i(m_id, uniform.location, value);
 }
 
-void Shader::setMat4(std::string name, const glm::mat4& value) { 
-	glProgramUniformMatrix4fv(m_id, glGetUniformLocation(m_id, name.c_str()), 1, false, glm::value_ptr(value));
+void Shader::setUint(UniformHandle uniform, unsigned int value)
+{
+	glProgramUniform1ui(m_id, uniform.location, value);
 }
 
-void Shader::setVec3(std::string name, const glm::vec3& value)
+void Shader::setMat4(UniformHandle uniform, const glm::mat4& value) { 
+	glProgramUniformMatrix4fv(m_id, uniform.location, 1, false, glm::value_ptr(value));
+}
+
+void Shader::setVec3(UniformHandle uniform, const glm::vec3& value)
 {
-	glProgramUniform3f(m_id, glGetUniformLocation(m_id, name.c_str()), value.x, value.y, value.z);
+	glProgramUniform3f(m_id, uniform.location, value.x, value.y, value.z);
 }
 
-void Shader::setVec2(std::string name, const glm::vec2& value)
+void Shader::setVec2(UniformHandle uniform, const glm::vec2& value)
 {
-	glProgramUniform2f(m_id, glGetUniformLocation(m_id, name.c_str()), value.x, value.y);
+	glProgramUniform2f(m_id, uniform.location, value.x, value.y);
 }
 
 
@@ -85,23 +478,16 @@ std::string Shader::readFile(const std::string& filePath)
 	return stringStream.str();
 }
 
-GLuint Shader::compileShader(const char* shaderSource, GLenum shaderType)
+void Shader::logCompileErrors(GLuint shader, GLenum shaderType)
 {
-	GLuint shader = glCreateShader(shaderType);
-	//Provides the source code to the object.
-	glShaderSource(shader, 1, &shaderSource, NULL);
-	//Compiles the shader source
-	glCompileShader(shader);
-
 	//Get result of last compile - either GL_TRUE or GL_FALSE
 	GLint success;
 	glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
 	if (!success) {
-		const char* shaderName = shaderType == GL_VERTEX_SHADER ? "VERTEX" : "FRAGMENT";
+		const char* shaderName = shaderType == GL_VERTEX_SHADER ? "VERTEX" : shaderType == GL_COMPUTE_SHADER ? "COMPUTE" : "FRAGMENT";
 		//Dump logs into a char array - 512 is an arbitrary length
 		GLchar infoLog[512];
 		glGetShaderInfoLog(shader, 512, NULL, infoLog);
 		printf("Failed to compile %s shader: %s", shaderName, infoLog);
 	}
-	return shader;
 }
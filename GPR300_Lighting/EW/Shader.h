@@ -3,22 +3,170 @@
 #pragma once
 #include "GL/glew.h"
 #include <glm/glm.hpp>
+#include <cstdint>
+#include <map>
+#include <memory>
 #include <string>
+#include <string_view>
+#include <vector>
+
+namespace ew {
+	class ShaderCompileWorker;
+}
+
+/// <summary>
+/// Uniform name plus its FNV-1a hash. Built from a string literal the hash is
+/// folded at compile time, so setters can find the location without allocating
+/// or asking the driver.
+/// </summary>
+struct UniformName {
+	constexpr UniformName(const char* name) : name(name), hash(hashString(this->name)) {}
+	UniformName(const std::string& name) : name(name), hash(hashString(this->name)) {}
+
+	static constexpr uint32_t hashString(std::string_view string) {
+		uint32_t hash = 2166136261u;
+		for (char c : string) { hash = (hash ^ (uint8_t)c) * 16777619u; }
+		return hash;
+	}
+
+	std::string_view name;
+	uint32_t hash;
+};
+
+/// <summary>
+/// Preprocessor defines injected after #version, e.g. { { "NORMAL_MAP", 1 }, { "PCF_KERNEL", 3 } }.
+/// Ordered, so equal sets always produce the same source (and binary cache key)
+/// </summary>
+using ShaderDefines = std::map<std::string, int>;
+
+/// <summary>
+/// Resolved uniform location, for uniforms set many times per frame.
+/// Only valid for the Shader that returned it
+/// </summary>
+struct UniformHandle {
+	GLint location = -1;
+	bool isValid() const { return location >= 0; }
+};
 
 class Shader
 {
 public:
-	Shader(std::string vertexShaderPath, std::string fragmentShaderPath);
+	Shader(std::string vertexShaderPath, std::string fragmentShaderPath, const ShaderDefines& defines = {});
+	Shader(std::string computeShaderPath, const ShaderDefines& defines = {});
+	~Shader();
 	void use();
-	void setFloat(std::string name, float value);
-	void setInt(std::string name, int value);
-	void setMat4(std::string name, const glm::mat4& value);
-	void setVec2(std::string name, const glm::vec2& value);
-	void setVec3(std::string name, const glm::vec3& value);
+
+	/// <summary>
+	/// Linked programs are saved here (glGetProgramBinary) and reused on later runs
+	/// when the sources and driver match. Empty (the default) disables the cache
+	/// </summary>
+	static void setBinaryCacheDirectory(const std::string& directory);
+	bool isLoadedFromBinaryCache() const { return mFromBinaryCache; }
+
+	/// <summary>
+	/// When enabled, Shaders created afterwards return before their program is built.
+	/// Compiles run on the driver's threads (GL_KHR_parallel_shader_compile) or, without
+	/// that extension, on worker. With neither they build immediately as before
+	/// </summary>
+	static void setAsyncCompile(bool enabled, ew::ShaderCompileWorker* worker = nullptr);
+	/// <summary>
+	/// True once the program is linked and usable. Never blocks, so it can be
+	/// polled every frame while drawing with a fallback. Call it at the start of a frame:
+	/// this is also where a finished reload replaces the current program
+	/// </summary>
+	bool isReady();
+	/// <summary>
+	/// Blocks until the build finishes. Returns whether it linked
+	/// </summary>
+	bool waitUntilReady();
+	bool isLinked() const { return mLinked; }
+
+	/// <summary>
+	/// Rebuilds from the source files (in the background when async compile is on).
+	/// The current program keeps being used until the new one links; if it fails
+	/// to compile the current one is kept. Uniform handles must be looked up again afterwards
+	/// </summary>
+	void reload();
+	bool usesFile(const std::string& filePath) const;
+	std::vector<std::string> getSourcePaths() const;
+	const ShaderDefines& getDefines() const { return mDefines; }
+	GLuint getId() const { return m_id; }
+
+	/// <summary>
+	/// Looks a uniform up in the table built at link time. Returns an invalid
+	/// handle if the uniform doesn't exist or was optimized out
+	/// </summary>
+	UniformHandle getUniform(UniformName name) const;
+
+	void setFloat(UniformName name, float value) { setFloat(getUniform(name), value); }
+	void setInt(UniformName name, int value) { setInt(getUniform(name), value); }
+	void setUint(UniformName name, unsigned int value) { setUint(getUniform(name), value); }
+	void setMat4(UniformName name, const glm::mat4& value) { setMat4(getUniform(name), value); }
+	void setVec2(UniformName name, const glm::vec2& value) { setVec2(getUniform(name), value); }
+	void setVec3(UniformName name, const glm::vec3& value) { setVec3(getUniform(name), value); }
+
+	void setFloat(UniformHandle uniform, float value);
+	void setInt(UniformHandle uniform, int value);
+	void setUint(UniformHandle uniform, unsigned int value);
+	void setMat4(UniformHandle uniform, const glm::mat4& value);
+	void setVec2(UniformHandle uniform, const glm::vec2& value);
+	void setVec3(UniformHandle uniform, const glm::vec3& value);
 private:
+	struct UniformEntry {
+		uint32_t hash;
+		GLint location;
+		uint32_t nameOffset;
+		uint32_t nameLength;
+	};
+
+	struct Stage {
+		GLenum type;
+		std::string source;
+	};
+
 	Shader(const Shader& r) = delete;
-	std::string readFile(const std::string& filePath);
-	GLuint compileShader(const char* shaderSource, GLenum type);
+
+	struct PendingShader {
+		GLenum type;
+		GLuint shader;
+	};
+
+	struct SourcePath {
+		GLenum type;
+		std::string path;
+	};
+
+	struct Build;
+
+	static std::string readFile(const std::string& filePath);
+	static std::string injectDefines(const std::string& source, const ShaderDefines& defines);
+	static void logCompileErrors(GLuint shader, GLenum type);
+	static void compileAndLink(Build& build, const std::vector<Stage>& stages);
+	static uint64_t getBinaryKey(const std::vector<Stage>& stages);
+	static std::string getBinaryPath(uint64_t key);
+	static bool loadProgramBinary(GLuint program, uint64_t key);
+	static void saveProgramBinary(GLuint program, uint64_t key);
+	void createProgram();
+	void startBuild();
+	void finishBuild();
+	void reflectUniforms();
+	void addUniform(const std::string& name, GLint location);
 	GLuint m_id;
+	bool mLinked;
+	bool mFromBinaryCache;
+	std::vector<SourcePath> mSourcePaths;
+	ShaderDefines mDefines;
+
+	// In flight compile, replacing m_id when it finishes
+	std::unique_ptr<Build> mBuild;
+	bool mReloadRequested;
+
+	static std::string sBinaryCacheDirectory;
+	static bool sAsyncCompile;
+	static ew::ShaderCompileWorker* sCompileWorker;
+
+	// Sorted by hash. Names live back to back in mUniformNames
+	std::vector<UniformEntry> mUniforms;
+	std::string mUniformNames;
 };
 
@@ -0,0 +1,47 @@
+#include "ShaderCompileWorker.h"
+
+namespace ew {
+	ShaderCompileWorker::ShaderCompileWorker(std::function<void()> makeContextCurrent, std::function<void()> releaseContext)
+		: mMakeContextCurrent(makeContextCurrent), mReleaseContext(releaseContext), mStopping(false)
+	{
+		mThread = std::thread(&ShaderCompileWorker::run, this);
+	}
+
+	// Jobs still queued are finished first, since Shaders may be waiting on them
+	ShaderCompileWorker::~ShaderCompileWorker()
+	{
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+			mStopping = true;
+		}
+		mWake.notify_one();
+		mThread.join();
+	}
+
+	void ShaderCompileWorker::push(std::function<void()> job)
+	{
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+			mJobs.push_back(std::move(job));
+		}
+		mWake.notify_one();
+	}
+
+	void ShaderCompileWorker::run()
+	{
+		mMakeContextCurrent();
+		while (true)
+		{
+			std::function<void()> job;
+			{
+				std::unique_lock<std::mutex> lock(mMutex);
+				mWake.wait(lock, [this]() { return mStopping || !mJobs.empty(); });
+				if (mJobs.empty()) { break; }
+				job = std::move(mJobs.front());
+				mJobs.pop_front();
+			}
+			job();
+		}
+		mReleaseContext();
+	}
+}
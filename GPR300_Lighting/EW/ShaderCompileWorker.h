@@ -0,0 +1,36 @@
+#pragma once
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+namespace ew {
+	/// <summary>
+	/// Background thread with its own GL context, shared with the main one, that Shader
+	/// hands compiles and links to when the driver lacks GL_KHR_parallel_shader_compile.
+	/// The context is made current through the callbacks so EW doesn't depend on the
+	/// windowing library, e.g. with GLFW:
+	///     makeCurrent = [hiddenWindow]() { glfwMakeContextCurrent(hiddenWindow); }
+	/// </summary>
+	class ShaderCompileWorker {
+	public:
+		ShaderCompileWorker(std::function<void()> makeContextCurrent, std::function<void()> releaseContext);
+		~ShaderCompileWorker();
+		/// <summary>
+		/// Runs job on the worker thread, in the order pushed
+		/// </summary>
+		void push(std::function<void()> job);
+	private:
+		ShaderCompileWorker(const ShaderCompileWorker& r) = delete;
+		void run();
+
+		std::function<void()> mMakeContextCurrent;
+		std::function<void()> mReleaseContext;
+		std::deque<std::function<void()>> mJobs;
+		std::mutex mMutex;
+		std::condition_variable mWake;
+		bool mStopping;
+		std::thread mThread;
+	};
+}
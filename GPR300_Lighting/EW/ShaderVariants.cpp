@@ -0,0 +1,56 @@
+#include "ShaderVariants.h"
+
+ShaderVariants::ShaderVariants(std::string vertexShaderPath, std::string fragmentShaderPath)
+	: mVertexShaderPath(vertexShaderPath), mFragmentShaderPath(fragmentShaderPath)
+{
+}
+
+ShaderVariants::ShaderVariants(std::string computeShaderPath)
+	: mComputeShaderPath(computeShaderPath)
+{
+}
+
+Shader& ShaderVariants::get(const ShaderDefines& defines)
+{
+	std::unique_ptr<Shader>& variant = mVariants[defines];
+	if (variant == nullptr)
+	{
+		variant = mComputeShaderPath.empty() ? std::make_unique<Shader>(mVertexShaderPath, mFragmentShaderPath, defines)
+			: std::make_unique<Shader>(mComputeShaderPath, defines);
+	}
+	return *variant;
+}
+
+void ShaderVariants::prewarm(const std::vector<ShaderDefines>& variants)
+{
+	for (const ShaderDefines& defines : variants) { get(defines); }
+}
+
+void ShaderVariants::update()
+{
+	for (auto& variant : mVariants) { variant.second->isReady(); }
+}
+
+void ShaderVariants::reload()
+{
+	for (auto& variant : mVariants) { variant.second->reload(); }
+}
+
+bool ShaderVariants::usesFile(const std::string& filePath) const
+{
+	if (!mComputeShaderPath.empty()) { return filePath == mComputeShaderPath; }
+	return filePath == mVertexShaderPath || filePath == mFragmentShaderPath;
+}
+
+std::vector<std::string> ShaderVariants::getSourcePaths() const
+{
+	if (!mComputeShaderPath.empty()) { return { mComputeShaderPath }; }
+	return { mVertexShaderPath, mFragmentShaderPath };
+}
+
+int ShaderVariants::getNumLoadedFromBinaryCache() const
+{
+	int count = 0;
+	for (const auto& variant : mVariants) { count += variant.second->isLoadedFromBinaryCache() ? 1 : 0; }
+	return count;
+}
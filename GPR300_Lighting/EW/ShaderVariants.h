@@ -0,0 +1,37 @@
+#pragma once
+#include "Shader.h"
+
+/// <summary>
+/// Every permutation of one vertex/fragment pair (or compute shader), keyed by its defines. A variant is
+/// compiled the first time it's asked for (in the background when async compile is on)
+/// and kept, so switching features never recompiles and draws never branch on them.
+/// </summary>
+class ShaderVariants
+{
+public:
+	ShaderVariants(std::string vertexShaderPath, std::string fragmentShaderPath);
+	ShaderVariants(std::string computeShaderPath);
+	/// <summary>
+	/// The variant for defines, created on first use. Check isReady before drawing with it
+	/// </summary>
+	Shader& get(const ShaderDefines& defines);
+	/// <summary>
+	/// Starts the compiles ahead of time, for variants that will be needed soon
+	/// </summary>
+	void prewarm(const std::vector<ShaderDefines>& variants);
+	/// <summary>
+	/// Frame boundary for all variants, where reloaded programs are swapped in
+	/// </summary>
+	void update();
+	void reload();
+	bool usesFile(const std::string& filePath) const;
+	std::vector<std::string> getSourcePaths() const;
+	size_t getNumVariants() const { return mVariants.size(); }
+	int getNumLoadedFromBinaryCache() const;
+private:
+	ShaderVariants(const ShaderVariants& r) = delete;
+	std::string mVertexShaderPath;
+	std::string mFragmentShaderPath;
+	std::string mComputeShaderPath;
+	std::map<ShaderDefines, std::unique_ptr<Shader>> mVariants;
+};
@@ -0,0 +1,355 @@
+#include "ShadowAtlas.h"
+#include <algorithm>
+
+namespace ew {
+	// Looking down each axis of a point light's cube, in the order of its tiles
+	static const glm::vec3 FACE_DIRECTIONS[ShadowAtlas::POINT_LIGHT_FACES] = {
+		glm::vec3(1, 0, 0), glm::vec3(-1, 0, 0), glm::vec3(0, 1, 0), glm::vec3(0, -1, 0), glm::vec3(0, 0, 1), glm::vec3(0, 0, -1)
+	};
+	static const glm::vec3 FACE_UPS[ShadowAtlas::POINT_LIGHT_FACES] = {
+		glm::vec3(0, -1, 0), glm::vec3(0, -1, 0), glm::vec3(0, 0, 1), glm::vec3(0, 0, -1), glm::vec3(0, -1, 0), glm::vec3(0, -1, 0)
+	};
+	// Keeps a spot light's projection finite
+	const float MAX_SPOT_FOV = 170.0f;
+
+	ShadowAtlas::ShadowAtlas(std::string cullShaderPath, std::string vertexShaderPath, std::string depthFragmentShaderPath, GLuint tileBinding, int size, int maxCastersPerView)
+		: mCasters(cullShaderPath, vertexShaderPath, depthFragmentShaderPath, ShadowCasterDraws::ViewTarget::Viewport, ShadowCasterDraws::MAX_VIEWS, maxCastersPerView),
+		mTiles(tileBinding),
+		mSize(size)
+	{
+		glCreateTextures(GL_TEXTURE_2D, 1, &mTexture);
+		glTextureStorage2D(mTexture, 1, GL_DEPTH_COMPONENT32F, size, size);
+		glTextureParameteri(mTexture, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		glTextureParameteri(mTexture, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		const float farDepth = 1.0f;
+		glClearTexImage(mTexture, 0, GL_DEPTH_COMPONENT, GL_FLOAT, &farDepth);
+
+		glCreateFramebuffers(1, &mFramebuffer);
+		glNamedFramebufferTexture(mFramebuffer, GL_DEPTH_ATTACHMENT, mTexture, 0);
+		glNamedFramebufferDrawBuffer(mFramebuffer, GL_NONE);
+
+		mFreeTiles.resize(getLevel(MIN_TILE_SIZE) + 1);
+		mFreeTiles[0].push_back(glm::ivec2(0));
+	}
+
+	ShadowAtlas::~ShadowAtlas()
+	{
+		glDeleteFramebuffers(1, &mFramebuffer);
+		glDeleteTextures(1, &mTexture);
+	}
+
+	void ShadowAtlas::update(const std::vector<Light>& lights, Camera& camera, int viewportHeight)
+	{
+		mFrame++;
+
+		// Picked last frame but the pass was skipped, so their tiles hold nothing
+		if (!mRendered)
+		{
+			for (int light : mScheduled)
+			{
+				if (light < (int)mEntries.size()) { mEntries[light].valid = false; mEntries[light].dirty = true; }
+			}
+		}
+		mRendered = false;
+
+		while (mEntries.size() > lights.size())
+		{
+			freeTiles(mEntries.back());
+			mEntries.pop_back();
+		}
+		mEntries.resize(lights.size());
+
+		glm::vec4 frustum[6];
+		ShadowCasterDraws::getFrustumPlanes(camera.getProjectionMatrix() * camera.getViewMatrix(), frustum);
+		float pixelsPerUnit = viewportHeight * 0.5f / glm::tan(glm::radians(camera.getFov()) * 0.5f);
+
+		struct VisibleLight {
+			int light;
+			int tileSize;
+			float importance;
+		};
+		std::vector<VisibleLight> visibleLights;
+		for (int i = 0; i < (int)lights.size(); i++)
+		{
+			Entry& entry = mEntries[i];
+			const Light& light = lights[i];
+			if (!sameLight(entry.light, light)) { entry.dirty = true; }
+			entry.light = light;
+
+			bool visible = true;
+			for (const glm::vec4& plane : frustum) { visible = visible && glm::dot(plane, glm::vec4(light.position, 1.0f)) >= -light.range; }
+			if (!visible) { continue; }
+			entry.lastVisibleFrame = mFrame;
+
+			// Radius of the light's sphere on screen, in pixels
+			float distance = glm::length(light.position - camera.getPosition());
+			float importance = distance > light.range ? light.range / glm::sqrt(distance * distance - light.range * light.range) * pixelsPerUnit : (float)viewportHeight;
+			int tileSize = MIN_TILE_SIZE;
+			while (tileSize < MAX_TILE_SIZE && tileSize < importance) { tileSize *= 2; }
+			visibleLights.push_back({ i, tileSize, importance });
+		}
+
+		// Every size is halved until the visible lights fit, with room to spare since
+		// quarters left free by different lights don't always merge
+		mSizeShift = 0;
+		while ((MAX_TILE_SIZE >> mSizeShift) > MIN_TILE_SIZE)
+		{
+			long long texels = 0;
+			for (const VisibleLight& visible : visibleLights)
+			{
+				int size = glm::max(visible.tileSize >> mSizeShift, MIN_TILE_SIZE);
+				texels += (long long)(mEntries[visible.light].light.isSpot ? 1 : POINT_LIGHT_FACES) * size * size;
+			}
+			if (texels * 4 <= (long long)mSize * mSize * 3) { break; }
+			mSizeShift++;
+		}
+
+		std::vector<VisibleLight> candidates;
+		for (VisibleLight visible : visibleLights)
+		{
+			const Entry& entry = mEntries[visible.light];
+			visible.tileSize = glm::max(visible.tileSize >> mSizeShift, MIN_TILE_SIZE);
+			// Against the size asked for, so a light that settled for smaller tiles isn't reallocated every frame
+			bool resized = entry.numTiles > 0 && (entry.requestedSize != visible.tileSize || canGrow(entry));
+			if (entry.dirty || !entry.valid || resized) { candidates.push_back(visible); }
+		}
+
+		// Lights without a shadow first, then by size on screen
+		std::sort(candidates.begin(), candidates.end(), [this](const VisibleLight& a, const VisibleLight& b) {
+			bool aValid = mEntries[a.light].valid;
+			bool bValid = mEntries[b.light].valid;
+			return aValid != bValid ? !aValid : a.importance > b.importance;
+		});
+
+		mScheduled.clear();
+		mViews.clear();
+		mViewTiles.clear();
+		mNumPending = 0;
+		for (const VisibleLight& candidate : candidates)
+		{
+			Entry& entry = mEntries[candidate.light];
+			int numFaces = entry.light.isSpot ? 1 : POINT_LIGHT_FACES;
+			if ((int)mViews.size() + numFaces > mBudget) { mNumPending++; continue; }
+
+			if (entry.numTiles != numFaces || entry.requestedSize != candidate.tileSize || canGrow(entry))
+			{
+				freeTiles(entry);
+				entry.valid = false;
+				if (!allocateTiles(entry, candidate.tileSize)) { mNumPending++; continue; }
+			}
+
+			const Light& light = entry.light;
+			float zNear = light.range * NEAR_FRACTION;
+			if (light.isSpot)
+			{
+				float fov = glm::min(light.outerAngle * 2.0f, MAX_SPOT_FOV);
+				glm::vec3 direction = glm::normalize(light.direction);
+				glm::vec3 up = glm::abs(direction.y) > 0.99f ? glm::vec3(0, 0, 1) : glm::vec3(0, 1, 0);
+				entry.viewProjections[0] = glm::perspective(glm::radians(fov), 1.0f, zNear, light.range) * glm::lookAt(light.position, light.position + direction, up);
+				entry.tanHalfFov = glm::tan(glm::radians(fov) * 0.5f);
+			}
+			else
+			{
+				glm::mat4 projection = glm::perspective(glm::radians(90.0f), 1.0f, zNear, light.range);
+				for (int f = 0; f < POINT_LIGHT_FACES; f++)
+				{
+					entry.viewProjections[f] = projection * glm::lookAt(light.position, light.position + FACE_DIRECTIONS[f], FACE_UPS[f]);
+				}
+				entry.tanHalfFov = 1.0f;
+			}
+			for (int f = 0; f < numFaces; f++)
+			{
+				mViews.push_back({ entry.viewProjections[f], (int)mViews.size() });
+				mViewTiles.push_back(entry.tiles[f]);
+			}
+			// Rendered before anything samples it this frame
+			entry.valid = true;
+			entry.dirty = false;
+			mScheduled.push_back(candidate.light);
+		}
+
+		std::vector<TileData> tiles;
+		for (Entry& entry : mEntries)
+		{
+			entry.shadowIndex = entry.valid ? (int)tiles.size() : -1;
+			if (!entry.valid) { continue; }
+			for (int f = 0; f < entry.numTiles; f++)
+			{
+				const Tile& tile = entry.tiles[f];
+				tiles.push_back({ entry.viewProjections[f], glm::vec4(glm::vec2(tile.position) / (float)mSize, (float)tile.size / mSize, entry.tanHalfFov) });
+			}
+		}
+		mTiles.update(tiles);
+	}
+
+	void ShadowAtlas::cull(Mesh& mesh, GLuint instanceBuffer, int numInstances, const glm::mat4& model, float instanceRadius)
+	{
+		mCasters.cull(mesh, instanceBuffer, numInstances, model, instanceRadius, mViews);
+	}
+
+	void ShadowAtlas::render(Mesh& mesh, GLuint instanceBuffer, const glm::mat4& model)
+	{
+		// Every other tile keeps its depth
+		const float farDepth = 1.0f;
+		for (const Tile& tile : mViewTiles)
+		{
+			glClearTexSubImage(mTexture, 0, tile.position.x, tile.position.y, 0, tile.size, tile.size, 1, GL_DEPTH_COMPONENT, GL_FLOAT, &farDepth);
+		}
+
+		// The scissor keeps triangles crossing a tile's edge out of its neighbors
+		glBindFramebuffer(GL_FRAMEBUFFER, mFramebuffer);
+		glEnable(GL_SCISSOR_TEST);
+		if (mCasters.isMultiDraw())
+		{
+			for (int v = 0; v < (int)mViewTiles.size(); v++)
+			{
+				const Tile& tile = mViewTiles[v];
+				glViewportIndexedf(v, (float)tile.position.x, (float)tile.position.y, (float)tile.size, (float)tile.size);
+				glScissorIndexed(v, tile.position.x, tile.position.y, tile.size, tile.size);
+			}
+		}
+		mCasters.draw(mesh, instanceBuffer, model, [this](int view) {
+			const Tile& tile = mViewTiles[view];
+			glViewport(tile.position.x, tile.position.y, tile.size, tile.size);
+			glScissor(tile.position.x, tile.position.y, tile.size, tile.size);
+		});
+		glDisable(GL_SCISSOR_TEST);
+
+		mNumRendered = (int)mViewTiles.size();
+		mRendered = true;
+	}
+
+	void ShadowAtlas::invalidate()
+	{
+		for (Entry& entry : mEntries) { entry.dirty = true; }
+	}
+
+	void ShadowAtlas::invalidate(glm::vec3 center, float radius)
+	{
+		for (Entry& entry : mEntries)
+		{
+			if (glm::length(entry.light.position - center) <= entry.light.range + radius) { entry.dirty = true; }
+		}
+	}
+
+	bool ShadowAtlas::sameLight(const Light& a, const Light& b)
+	{
+		return a.position == b.position && a.range == b.range && a.isSpot == b.isSpot
+			&& (!a.isSpot || (a.direction == b.direction && a.outerAngle == b.outerAngle));
+	}
+
+	int ShadowAtlas::getLevel(int tileSize) const
+	{
+		int level = 0;
+		while ((mSize >> level) > tileSize) { level++; }
+		return level;
+	}
+
+	bool ShadowAtlas::allocateTile(int level, glm::ivec2& position)
+	{
+		if (level < 0) { return false; }
+		if (!mFreeTiles[level].empty())
+		{
+			position = mFreeTiles[level].back();
+			mFreeTiles[level].pop_back();
+			return true;
+		}
+
+		// Splits a larger square, keeping the other three quarters
+		glm::ivec2 parent;
+		if (!allocateTile(level - 1, parent)) { return false; }
+		int size = mSize >> level;
+		mFreeTiles[level].push_back(parent + glm::ivec2(size, 0));
+		mFreeTiles[level].push_back(parent + glm::ivec2(0, size));
+		mFreeTiles[level].push_back(parent + glm::ivec2(size, size));
+		position = parent;
+		return true;
+	}
+
+	void ShadowAtlas::freeTile(int level, glm::ivec2 position)
+	{
+		// Merges back into the larger square once all four quarters are free
+		std::vector<glm::ivec2>& freeTiles = mFreeTiles[level];
+		if (level > 0)
+		{
+			int parentSize = mSize >> (level - 1);
+			glm::ivec2 parent = position / parentSize * parentSize;
+			int size = parentSize / 2;
+			glm::ivec2 siblings[3];
+			int numSiblings = 0;
+			for (int i = 0; i < 4; i++)
+			{
+				glm::ivec2 quarter = parent + glm::ivec2(i & 1, i >> 1) * size;
+				if (quarter != position) { siblings[numSiblings++] = quarter; }
+			}
+			bool allFree = true;
+			for (const glm::ivec2& sibling : siblings) { allFree = allFree && std::find(freeTiles.begin(), freeTiles.end(), sibling) != freeTiles.end(); }
+			if (allFree)
+			{
+				for (const glm::ivec2& sibling : siblings) { freeTiles.erase(std::find(freeTiles.begin(), freeTiles.end(), sibling)); }
+				freeTile(level - 1, parent);
+				return;
+			}
+		}
+		freeTiles.push_back(position);
+	}
+
+	void ShadowAtlas::freeTiles(Entry& entry)
+	{
+		for (int f = 0; f < entry.numTiles; f++)
+		{
+			freeTile(getLevel(entry.tiles[f].size), entry.tiles[f].position);
+			mTexelsUsed -= entry.tiles[f].size * entry.tiles[f].size;
+		}
+		mNumTiles -= entry.numTiles;
+		entry.numTiles = 0;
+		entry.shadowIndex = -1;
+	}
+
+	bool ShadowAtlas::allocateTiles(Entry& entry, int tileSize)
+	{
+		int numFaces = entry.light.isSpot ? 1 : POINT_LIGHT_FACES;
+		for (int size = tileSize; size >= MIN_TILE_SIZE; size /= 2)
+		{
+			int level = getLevel(size);
+			while (true)
+			{
+				glm::ivec2 positions[POINT_LIGHT_FACES];
+				int numAllocated = 0;
+				while (numAllocated < numFaces && allocateTile(level, positions[numAllocated])) { numAllocated++; }
+				if (numAllocated == numFaces)
+				{
+					for (int f = 0; f < numFaces; f++) { entry.tiles[f] = { positions[f], size }; }
+					entry.numTiles = numFaces;
+					entry.requestedSize = tileSize;
+					mNumTiles += numFaces;
+					mTexelsUsed += numFaces * size * size;
+					entry.texelsUsedAtGrant = mTexelsUsed;
+					return true;
+				}
+				for (int f = 0; f < numAllocated; f++) { freeTile(level, positions[f]); }
+
+				// Makes room by taking the tiles of the light out of view for longest,
+				// before settling for a smaller size
+				Entry* leastRecent = nullptr;
+				for (Entry& other : mEntries)
+				{
+					if (other.numTiles == 0 || other.lastVisibleFrame == mFrame) { continue; }
+					if (leastRecent == nullptr || other.lastVisibleFrame < leastRecent->lastVisibleFrame) { leastRecent = &other; }
+				}
+				if (leastRecent == nullptr) { break; }
+				freeTiles(*leastRecent);
+				leastRecent->valid = false;
+				leastRecent->dirty = true;
+				mNumEvicted++;
+			}
+		}
+		return false;
+	}
+
+	bool ShadowAtlas::canGrow(const Entry& entry) const
+	{
+		// Other tiles were freed since it was given less than it asked for
+		return entry.numTiles > 0 && entry.tiles[0].size < entry.requestedSize && mTexelsUsed < entry.texelsUsedAtGrant;
+	}
+}
@@ -0,0 +1,179 @@
+#pragma once
+#include <GL/glew.h>
+#include "Shader.h"
+#include "Mesh.h"
+#include "Camera.h"
+#include "StorageBuffer.h"
+#include "ShadowCasterDraws.h"
+#include <vector>
+
+namespace ew {
+	/// <summary>
+	/// Shadows for point and spot lights, packed as square tiles into one depth texture.
+	/// Each visible light gets a tile sized by how large it is on screen, six for a point
+	/// light's cube faces, allocated by splitting the atlas into quarters. Sizes are halved
+	/// together when the visible lights wouldn't fit. Tiles are kept
+	/// across frames and only rendered again when the light or a caster near it moves. At most
+	/// a budget of tiles is rendered each frame, the most important first, so the cost stays
+	/// flat however many lights there are; the rest keep their old tile until their turn.
+	/// When the atlas is full, lights that weren't visible for longest lose their tiles.
+	/// The tiles are uploaded to the ShadowTiles storage block, see getShadowIndex.
+	/// </summary>
+	class ShadowAtlas {
+	public:
+		static const int POINT_LIGHT_FACES = 6;
+
+		struct Light {
+			glm::vec3 position;
+			// Spot lights only
+			glm::vec3 direction;
+			float outerAngle;
+			float range;
+			bool isSpot;
+		};
+
+		/// <summary>
+		/// Casters are drawn with depthFragmentShaderPath. tileBinding is the binding of the
+		/// ShadowTiles block, size the width of the atlas
+		/// </summary>
+		ShadowAtlas(std::string cullShaderPath, std::string vertexShaderPath, std::string depthFragmentShaderPath, GLuint tileBinding, int size, int maxCastersPerView);
+		~ShadowAtlas();
+		bool isReady() { return mCasters.isReady(); }
+
+		/// <summary>
+		/// Sizes the tiles of the visible lights for this camera, picks the ones to render this
+		/// frame and uploads the ShadowTiles block. Lights are identified by their index
+		/// </summary>
+		void update(const std::vector<Light>& lights, Camera& camera, int viewportHeight);
+		/// <summary>
+		/// Any tile to render this frame
+		/// </summary>
+		bool needsRender() const { return !mScheduled.empty(); }
+		/// <summary>
+		/// Appends the instances inside each tile to be rendered. instanceBuffer holds a
+		/// tightly packed vec3 offset per instance, moved by model. instanceRadius bounds the
+		/// mesh around each offset, in world units
+		/// </summary>
+		void cull(Mesh& mesh, GLuint instanceBuffer, int numInstances, const glm::mat4& model, float instanceRadius);
+		/// <summary>
+		/// Clears and renders the tiles picked by update, with the lists from cull
+		/// </summary>
+		void render(Mesh& mesh, GLuint instanceBuffer, const glm::mat4& model);
+
+		/// <summary>
+		/// Casters changed, every light is rendered again
+		/// </summary>
+		void invalidate();
+		/// <summary>
+		/// A caster in this sphere changed, lights reaching it are rendered again
+		/// </summary>
+		void invalidate(glm::vec3 center, float radius);
+		/// <summary>
+		/// Tiles rendered per frame at most, up to ShadowCasterDraws::MAX_VIEWS
+		/// </summary>
+		void setBudget(int tiles) { mBudget = glm::clamp(tiles, POINT_LIGHT_FACES, ShadowCasterDraws::MAX_VIEWS); }
+		int getBudget() const { return mBudget; }
+
+		/// <summary>
+		/// First of the light's tiles in the ShadowTiles block, one per cube face for a point
+		/// light (+X, -X, +Y, -Y, +Z, -Z). -1 while it has nothing rendered
+		/// </summary>
+		int getShadowIndex(int light) const { return light < (int)mEntries.size() ? mEntries[light].shadowIndex : -1; }
+		bool isMultiDraw() const { return mCasters.isMultiDraw(); }
+		Shader& getCullShader() { return mCasters.getCullShader(); }
+		Shader& getDrawShader() { return mCasters.getDrawShader(); }
+		GLuint getTexture() const { return mTexture; }
+		GLuint getDrawBuffer() const { return mCasters.getDrawBuffer(); }
+		GLuint getCasterBuffer() const { return mCasters.getCasterBuffer(); }
+		int getSize() const { return mSize; }
+		int getNumTiles() const { return mNumTiles; }
+		/// <summary>
+		/// Share of the atlas held by tiles
+		/// </summary>
+		float getOccupancy() const { return mTexelsUsed / ((float)mSize * mSize); }
+		/// <summary>
+		/// Tiles rendered by the last render call
+		/// </summary>
+		int getNumRendered() const { return mNumRendered; }
+		/// <summary>
+		/// Visible lights left waiting by the budget in the last update
+		/// </summary>
+		int getNumPending() const { return mNumPending; }
+		/// <summary>
+		/// Lights that lost their tiles to make room, since creation
+		/// </summary>
+		int getNumEvicted() const { return mNumEvicted; }
+		/// <summary>
+		/// Times every tile size was halved for the visible lights to fit
+		/// </summary>
+		int getSizeShift() const { return mSizeShift; }
+	private:
+		ShadowAtlas(const ShadowAtlas& r) = delete;
+		static const int MAX_TILE_SIZE = 1024;
+		static const int MIN_TILE_SIZE = 128;
+		// Near plane of the tiles' projections, as a share of the light's range
+		static constexpr float NEAR_FRACTION = 0.01f;
+
+		struct Tile {
+			glm::ivec2 position;
+			int size;
+		};
+
+		struct Entry {
+			Light light = {};
+			Tile tiles[POINT_LIGHT_FACES];
+			int numTiles = 0;
+			// Size the tiles were allocated for, they may have been granted smaller
+			int requestedSize = 0;
+			// Atlas texels used once they were, a smaller grant is only retried after that drops
+			int texelsUsedAtGrant = 0;
+			// What the tiles were last rendered with
+			glm::mat4 viewProjections[POINT_LIGHT_FACES];
+			float tanHalfFov = 1.0f;
+			// Tiles hold a finished render
+			bool valid = false;
+			bool dirty = true;
+			int lastVisibleFrame = -1;
+			int shadowIndex = -1;
+		};
+
+		// std430 mirror of ShadowTile in defaultLit.frag
+		struct TileData {
+			glm::mat4 viewProjection;
+			// Offset and size in the atlas, in uv, and the tangent of half the field of view
+			glm::vec4 rect;
+		};
+
+		static bool sameLight(const Light& a, const Light& b);
+		int getLevel(int tileSize) const;
+		bool allocateTile(int level, glm::ivec2& position);
+		void freeTile(int level, glm::ivec2 position);
+		void freeTiles(Entry& entry);
+		bool allocateTiles(Entry& entry, int tileSize);
+		bool canGrow(const Entry& entry) const;
+
+		ShadowCasterDraws mCasters;
+		StorageBuffer mTiles;
+		int mSize;
+		GLuint mTexture;
+		GLuint mFramebuffer;
+
+		// Free squares by level, the whole atlas being level 0 and each level a quarter of the one before
+		std::vector<std::vector<glm::ivec2>> mFreeTiles;
+		std::vector<Entry> mEntries;
+		// Lights picked by update, and the tile each view renders
+		std::vector<int> mScheduled;
+		std::vector<ShadowCasterDraws::View> mViews;
+		std::vector<Tile> mViewTiles;
+		bool mRendered = false;
+		int mFrame = 0;
+		int mBudget = 12;
+
+		int mNumTiles = 0;
+		int mTexelsUsed = 0;
+		int mNumRendered = 0;
+		int mNumPending = 0;
+		int mNumEvicted = 0;
+		int mSizeShift = 0;
+	};
+}
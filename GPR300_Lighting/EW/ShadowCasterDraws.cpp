@@ -0,0 +1,151 @@
+#include "ShadowCasterDraws.h"
+#include <cstddef>
+
+namespace ew {
+	const GLuint SHADOW_INSTANCE_BINDING = 0;
+	const GLuint SHADOW_CASTER_BINDING = 1;
+	const GLuint SHADOW_DRAW_BINDING = 2;
+	// A uniform block, read for every vertex, past the ones main.cpp binds
+	const GLuint SHADOW_VIEW_BINDING = 5;
+
+	static bool supportsMultiDraw()
+	{
+		return GLEW_ARB_shader_viewport_layer_array && GLEW_ARB_shader_draw_parameters;
+	}
+
+	ShadowCasterDraws::ShadowCasterDraws(std::string cullShaderPath, std::string vertexShaderPath, std::string fragmentShaderPath, ViewTarget target, int maxViews, int maxCastersPerView)
+		: mMultiDraw(supportsMultiDraw()),
+		mCullShader(cullShaderPath),
+		mDrawShader(vertexShaderPath, fragmentShaderPath, { { "MULTI_DRAW", mMultiDraw ? 1 : 0 }, { "VIEW_TARGET", target == ViewTarget::Layer ? 0 : 1 } }),
+		mMaxViews(glm::clamp(maxViews, 1, MAX_VIEWS)),
+		mMaxCastersPerView(maxCastersPerView)
+	{
+		// Only positions are read, straight from the mesh's vertex buffer
+		glCreateVertexArrays(1, &mVAO);
+		glVertexArrayAttribFormat(mVAO, 0, 3, GL_FLOAT, GL_FALSE, offsetof(Vertex, position));
+		glVertexArrayAttribBinding(mVAO, 0, 0);
+		glEnableVertexArrayAttrib(mVAO, 0);
+
+		// Each view's casters start at view * maxCastersPerView
+		glCreateBuffers(1, &mViewBuffer);
+		glNamedBufferStorage(mViewBuffer, sizeof(ViewData) * MAX_VIEWS, nullptr, GL_DYNAMIC_STORAGE_BIT);
+		glCreateBuffers(1, &mDrawBuffer);
+		glNamedBufferStorage(mDrawBuffer, sizeof(DrawCommand) * MAX_VIEWS, nullptr, GL_DYNAMIC_STORAGE_BIT);
+		glCreateBuffers(1, &mCasterBuffer);
+		// Only room for the views this is used with. The view and draw blocks keep the shaders' MAX_VIEWS length
+		glNamedBufferStorage(mCasterBuffer, sizeof(GLuint) * mMaxViews * maxCastersPerView, nullptr, 0);
+		glCreateBuffers(1, &mReadbackBuffer);
+		glNamedBufferStorage(mReadbackBuffer, sizeof(DrawCommand) * MAX_VIEWS, nullptr, GL_CLIENT_STORAGE_BIT);
+	}
+
+	ShadowCasterDraws::~ShadowCasterDraws()
+	{
+		if (mReadbackFence != nullptr) { glDeleteSync(mReadbackFence); }
+		glDeleteBuffers(1, &mReadbackBuffer);
+		glDeleteBuffers(1, &mCasterBuffer);
+		glDeleteBuffers(1, &mDrawBuffer);
+		glDeleteBuffers(1, &mViewBuffer);
+		glDeleteVertexArrays(1, &mVAO);
+	}
+
+	void ShadowCasterDraws::cull(Mesh& mesh, GLuint instanceBuffer, int numInstances, const glm::mat4& model, float instanceRadius, const std::vector<View>& views)
+	{
+		readCasterCounts();
+		mViews.assign(views.begin(), views.begin() + glm::min((int)views.size(), mMaxViews));
+
+		ViewData viewData[MAX_VIEWS] = {};
+		DrawCommand draws[MAX_VIEWS];
+		for (int v = 0; v < (int)mViews.size(); v++)
+		{
+			getFrustumPlanes(mViews[v].viewProjection, viewData[v].planes);
+			viewData[v].viewProjection = mViews[v].viewProjection;
+			viewData[v].target = mViews[v].target;
+			draws[v] = { (GLuint)mesh.getNumIndicies(), 0, 0, 0, (GLuint)(v * mMaxCastersPerView) };
+		}
+		if (mViews.empty()) { return; }
+		glNamedBufferSubData(mViewBuffer, 0, sizeof(ViewData) * mViews.size(), viewData);
+		glNamedBufferSubData(mDrawBuffer, 0, sizeof(DrawCommand) * mViews.size(), draws);
+
+		mCullShader.setUint("_NumInstances", (GLuint)numInstances);
+		mCullShader.setInt("_NumViews", (int)mViews.size());
+		mCullShader.setUint("_MaxCastersPerView", (GLuint)mMaxCastersPerView);
+		mCullShader.setMat4("_Model", model);
+		mCullShader.setFloat("_InstanceRadius", instanceRadius);
+		mCullShader.use();
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, SHADOW_INSTANCE_BINDING, instanceBuffer);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, SHADOW_CASTER_BINDING, mCasterBuffer);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, SHADOW_DRAW_BINDING, mDrawBuffer);
+		glBindBufferBase(GL_UNIFORM_BUFFER, SHADOW_VIEW_BINDING, mViewBuffer);
+		glDispatchCompute((numInstances + CULL_GROUP_SIZE - 1) / CULL_GROUP_SIZE, 1, 1);
+	}
+
+	void ShadowCasterDraws::draw(Mesh& mesh, GLuint instanceBuffer, const glm::mat4& model, const std::function<void(int view)>& bindView)
+	{
+		if (mViews.empty()) { return; }
+
+		mDrawShader.setMat4("_Model", model);
+		if (!mMultiDraw) { mDrawShader.setUint("_MaxCastersPerView", (GLuint)mMaxCastersPerView); }
+		mDrawShader.use();
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, SHADOW_INSTANCE_BINDING, instanceBuffer);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, SHADOW_CASTER_BINDING, mCasterBuffer);
+		glBindBufferBase(GL_UNIFORM_BUFFER, SHADOW_VIEW_BINDING, mViewBuffer);
+		glVertexArrayVertexBuffer(mVAO, 0, mesh.getVBO(), 0, sizeof(Vertex));
+		glVertexArrayElementBuffer(mVAO, mesh.getEBO());
+		glBindVertexArray(mVAO);
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, mDrawBuffer);
+		glEnable(GL_DEPTH_TEST);
+
+		if (mMultiDraw)
+		{
+			glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, nullptr, (GLsizei)mViews.size(), 0);
+		}
+		else
+		{
+			for (int v = 0; v < (int)mViews.size(); v++)
+			{
+				bindView(v);
+				mDrawShader.setInt("_View", v);
+				glDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, (const void*)(sizeof(DrawCommand) * v));
+			}
+		}
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+		glBindVertexArray(0);
+
+		if (mReadbackFence == nullptr)
+		{
+			// The culling shader wrote the counts through the SSBO
+			glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+			glCopyNamedBufferSubData(mDrawBuffer, mReadbackBuffer, 0, 0, sizeof(DrawCommand) * mViews.size());
+			mReadbackFence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+			mReadbackTargets.clear();
+			for (const View& view : mViews) { mReadbackTargets.push_back(view.target); }
+		}
+	}
+
+	void ShadowCasterDraws::getFrustumPlanes(const glm::mat4& viewProjection, glm::vec4 planes[6])
+	{
+		// Gribb-Hartmann: each plane is the last row plus or minus another
+		glm::mat4 rows = glm::transpose(viewProjection);
+		for (int i = 0; i < 6; i++)
+		{
+			glm::vec4 plane = rows[3] + (i & 1 ? -rows[i / 2] : rows[i / 2]);
+			planes[i] = plane / glm::length(glm::vec3(plane));
+		}
+	}
+
+	void ShadowCasterDraws::readCasterCounts()
+	{
+		if (mReadbackFence == nullptr) { return; }
+		GLenum status = glClientWaitSync(mReadbackFence, 0, 0);
+		if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) { return; }
+
+		DrawCommand draws[MAX_VIEWS];
+		glGetNamedBufferSubData(mReadbackBuffer, 0, sizeof(DrawCommand) * mReadbackTargets.size(), draws);
+		for (size_t v = 0; v < mReadbackTargets.size(); v++)
+		{
+			if (mReadbackTargets[v] >= 0 && mReadbackTargets[v] < MAX_VIEWS) { mNumCasters[mReadbackTargets[v]] = draws[v].instanceCount; }
+		}
+		glDeleteSync(mReadbackFence);
+		mReadbackFence = nullptr;
+	}
+}
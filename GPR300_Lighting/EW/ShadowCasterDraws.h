@@ -0,0 +1,117 @@
+#pragma once
+#include <GL/glew.h>
+#include "Shader.h"
+#include "Mesh.h"
+#include <functional>
+#include <vector>
+
+namespace ew {
+	/// <summary>
+	/// Draws the casters of an instanced mesh into several shadow views at once.
+	/// A compute pass (shaders/shadowCull.comp) tests every instance's bounding sphere against
+	/// each view's frustum and appends the ones inside to that view's list, counted into its
+	/// indirect draw. One multi draw (shaders/shadowCasters.vert) then renders every view,
+	/// sending each to its target: a layer of the bound framebuffer (gl_Layer) or one of the
+	/// indexed viewports (gl_ViewportIndex).
+	/// Without ARB_shader_viewport_layer_array and ARB_shader_draw_parameters each view is
+	/// drawn on its own instead, after a callback binds its target.
+	/// </summary>
+	class ShadowCasterDraws {
+	public:
+		// Indexed viewports are only guaranteed up to 16
+		static const int MAX_VIEWS = 16;
+
+		enum class ViewTarget {
+			Layer,
+			Viewport
+		};
+
+		struct View {
+			glm::mat4 viewProjection;
+			// Layer or viewport index
+			int target;
+		};
+
+		/// <summary>
+		/// Culls into at most maxViews views (up to MAX_VIEWS) per call, each holding up to
+		/// maxCastersPerView instances, any more are dropped
+		/// </summary>
+		ShadowCasterDraws(std::string cullShaderPath, std::string vertexShaderPath, std::string fragmentShaderPath, ViewTarget target, int maxViews, int maxCastersPerView);
+		~ShadowCasterDraws();
+		bool isReady() { return mCullShader.isReady() && mDrawShader.isReady(); }
+		/// <summary>
+		/// Every view in one draw, each sent to its target by the vertex shader
+		/// </summary>
+		bool isMultiDraw() const { return mMultiDraw; }
+
+		/// <summary>
+		/// Appends the instances inside each view (at most maxViews). instanceBuffer holds a
+		/// tightly packed vec3 offset per instance, moved by model. instanceRadius bounds the
+		/// mesh around each offset, in world units
+		/// </summary>
+		void cull(Mesh& mesh, GLuint instanceBuffer, int numInstances, const glm::mat4& model, float instanceRadius, const std::vector<View>& views);
+		/// <summary>
+		/// Draws the views of the last cull into the bound framebuffer. Without a multi draw,
+		/// bindView is called with each view's index before its draw to bind its target
+		/// </summary>
+		void draw(Mesh& mesh, GLuint instanceBuffer, const glm::mat4& model, const std::function<void(int view)>& bindView);
+
+		int getNumViews() const { return (int)mViews.size(); }
+		int getMaxViews() const { return mMaxViews; }
+		const View& getView(int view) const { return mViews[view]; }
+		GLuint getDrawBuffer() const { return mDrawBuffer; }
+		GLuint getCasterBuffer() const { return mCasterBuffer; }
+		/// <summary>
+		/// Instances drawn into the target the last time a view went there, read back a few frames late
+		/// </summary>
+		GLuint getNumCasters(int target) const { return mNumCasters[target]; }
+		Shader& getCullShader() { return mCullShader; }
+		Shader& getDrawShader() { return mDrawShader; }
+
+		/// <summary>
+		/// Planes bounding the clip volume, normalized and pointing inwards, so a sphere is
+		/// inside when dot(plane, vec4(center, 1)) >= -radius for all six
+		/// </summary>
+		static void getFrustumPlanes(const glm::mat4& viewProjection, glm::vec4 planes[6]);
+	private:
+		ShadowCasterDraws(const ShadowCasterDraws& r) = delete;
+		static const GLuint CULL_GROUP_SIZE = 64;
+
+		// Mirrors DrawElementsIndirectCommand
+		struct DrawCommand {
+			GLuint count;
+			GLuint instanceCount;
+			GLuint firstIndex;
+			GLint baseVertex;
+			GLuint baseInstance;
+		};
+
+		// std140 mirror of ShadowView in the shaders
+		struct ViewData {
+			glm::mat4 viewProjection;
+			glm::vec4 planes[6];
+			GLint target;
+			GLint padding[3];
+		};
+
+		void readCasterCounts();
+
+		// Ahead of the shaders, it picks the draw shader's variant
+		bool mMultiDraw;
+		Shader mCullShader;
+		Shader mDrawShader;
+		int mMaxViews;
+		int mMaxCastersPerView;
+		GLuint mVAO;
+		GLuint mViewBuffer;
+		GLuint mDrawBuffer;
+		GLuint mCasterBuffer;
+		std::vector<View> mViews;
+
+		// Copy of the draws, read once the fence has passed so it never stalls
+		GLuint mReadbackBuffer;
+		GLsync mReadbackFence = nullptr;
+		std::vector<int> mReadbackTargets;
+		GLuint mNumCasters[MAX_VIEWS] = {};
+	};
+}
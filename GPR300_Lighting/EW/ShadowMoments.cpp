@@ -0,0 +1,86 @@
+#include "ShadowMoments.h"
+#include <glm/glm.hpp>
+
+namespace ew {
+	// Each pass's source is read here, clear of the lit shader's fixed units
+	const GLuint MOMENTS_SOURCE_UNIT = 4;
+
+	ShadowMoments::ShadowMoments(std::string computeShaderPath, int depthResolution, int numLayers)
+		: mMomentsShader(computeShaderPath, { { "PASS", 0 } }),
+		mBlurShader(computeShaderPath, { { "PASS", 1 } }),
+		mResolution(depthResolution / 2),
+		mNumLayers(numLayers),
+		mStaleMask((1 << numLayers) - 1)
+	{
+		int numLevels = 1;
+		while ((mResolution >> numLevels) > 0) { numLevels++; }
+
+		// Four 32 bit moments, the positive warp's square needs the range
+		glCreateTextures(GL_TEXTURE_2D_ARRAY, 1, &mTexture);
+		glTextureStorage3D(mTexture, numLevels, GL_RGBA32F, mResolution, mResolution, numLayers);
+		glTextureParameteri(mTexture, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+		glTextureParameteri(mTexture, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		// Views need a name that hasn't been bound yet
+		mLayerViews.resize(numLayers);
+		glGenTextures(numLayers, mLayerViews.data());
+		for (int layer = 0; layer < numLayers; layer++)
+		{
+			glTextureView(mLayerViews[layer], GL_TEXTURE_2D_ARRAY, mTexture, GL_RGBA32F, 0, numLevels, layer, 1);
+		}
+
+		glCreateTextures(GL_TEXTURE_2D, 1, &mScratchTexture);
+		glTextureStorage2D(mScratchTexture, 1, GL_RGBA32F, mResolution, mResolution);
+		glTextureParameteri(mScratchTexture, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		glTextureParameteri(mScratchTexture, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	}
+
+	ShadowMoments::~ShadowMoments()
+	{
+		glDeleteTextures(1, &mScratchTexture);
+		glDeleteTextures((GLsizei)mLayerViews.size(), mLayerViews.data());
+		glDeleteTextures(1, &mTexture);
+	}
+
+	void ShadowMoments::setBlurRadius(int radius)
+	{
+		radius = glm::clamp(radius, 0, MAX_BLUR_RADIUS);
+		if (radius != mBlurRadius) { mStaleMask = (1 << mNumLayers) - 1; }
+		mBlurRadius = radius;
+	}
+
+	void ShadowMoments::filter(GLuint depthTexture, GLuint layerMask)
+	{
+		layerMask |= mStaleMask;
+		mNumFiltered = 0;
+		if (layerMask == 0) { return; }
+
+		// Each group covers GROUP_SIZE texels of a row (or column), one group per row
+		int numGroups = (mResolution + GROUP_SIZE - 1) / GROUP_SIZE;
+		mMomentsShader.setInt("_Radius", mBlurRadius);
+		mBlurShader.setInt("_Radius", mBlurRadius);
+		for (int layer = 0; layer < mNumLayers; layer++)
+		{
+			if (!(layerMask & (1 << layer))) { continue; }
+
+			mMomentsShader.setInt("_Layer", layer);
+			mMomentsShader.use();
+			glBindTextureUnit(MOMENTS_SOURCE_UNIT, depthTexture);
+			glBindImageTexture(0, mScratchTexture, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA32F);
+			glDispatchCompute(numGroups, mResolution, 1);
+			glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+
+			mBlurShader.use();
+			glBindTextureUnit(MOMENTS_SOURCE_UNIT, mScratchTexture);
+			glBindImageTexture(0, mTexture, 0, GL_FALSE, layer, GL_WRITE_ONLY, GL_RGBA32F);
+			glDispatchCompute(numGroups, mResolution, 1);
+			// The next layer's first pass writes over the scratch texture this one just read,
+			// and the mipmaps are built from what this one wrote
+			glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT | GL_TEXTURE_FETCH_BARRIER_BIT | GL_TEXTURE_UPDATE_BARRIER_BIT);
+
+			// Distant and grazing surfaces read the coarser levels
+			glGenerateTextureMipmap(mLayerViews[layer]);
+			mNumFiltered++;
+		}
+		mStaleMask &= ~layerMask;
+	}
+}
@@ -0,0 +1,68 @@
+#pragma once
+#include <GL/glew.h>
+#include "Shader.h"
+#include <vector>
+
+namespace ew {
+	/// <summary>
+	/// Prefiltered shadow maps (exponential variance shadow maps) built from a depth texture
+	/// array (shaders/shadowMoments.comp). Each layer's depth is stored as exponentially warped
+	/// moments at half resolution, blurred by a separable gaussian and mipmapped, so the lit
+	/// shader gets soft shadows from one trilinear lookup instead of a PCF loop.
+	/// Only the layers passed to filter are rebuilt, the rest keep their moments like the
+	/// cached depth they come from.
+	/// </summary>
+	class ShadowMoments {
+	public:
+		static const int MAX_BLUR_RADIUS = 8;
+
+		/// <summary>
+		/// depthResolution and numLayers are the size of the depth array filtered
+		/// </summary>
+		ShadowMoments(std::string computeShaderPath, int depthResolution, int numLayers);
+		~ShadowMoments();
+		bool isReady() { return mMomentsShader.isReady() && mBlurShader.isReady(); }
+
+		/// <summary>
+		/// Rebuilds the layers in layerMask, and any left stale, from depthTexture, then their mipmaps
+		/// </summary>
+		void filter(GLuint depthTexture, GLuint layerMask);
+		/// <summary>
+		/// The depth of these layers changed without being filtered, the next filter rebuilds them
+		/// </summary>
+		void invalidate(GLuint layerMask) { mStaleMask |= layerMask; }
+		GLuint getStaleMask() const { return mStaleMask; }
+		/// <summary>
+		/// Blur radius in moment texels, 0 to MAX_BLUR_RADIUS. Every layer is rebuilt when it changes
+		/// </summary>
+		void setBlurRadius(int radius);
+		int getBlurRadius() const { return mBlurRadius; }
+
+		Shader& getMomentsShader() { return mMomentsShader; }
+		Shader& getBlurShader() { return mBlurShader; }
+		GLuint getTexture() const { return mTexture; }
+		int getResolution() const { return mResolution; }
+		/// <summary>
+		/// Layers rebuilt by the last filter call
+		/// </summary>
+		int getNumFiltered() const { return mNumFiltered; }
+	private:
+		ShadowMoments(const ShadowMoments& r) = delete;
+		// Must match shadowMoments.comp
+		static const int GROUP_SIZE = 64;
+
+		// Converts and blurs along x, then blurs along y
+		Shader mMomentsShader;
+		Shader mBlurShader;
+		int mResolution;
+		int mNumLayers;
+		GLuint mTexture;
+		// A view of each layer, so only the rebuilt ones get their mipmaps generated
+		std::vector<GLuint> mLayerViews;
+		// One layer blurred along x
+		GLuint mScratchTexture;
+		GLuint mStaleMask;
+		int mBlurRadius = 2;
+		int mNumFiltered = 0;
+	};
+}
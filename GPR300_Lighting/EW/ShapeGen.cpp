@@ -2,34 +2,17 @@
 
 #include "ShapeGen.h"
 #include <glm/gtc/type_ptr.hpp>
+#include <algorithm>
 
 namespace ew {
-	void createPlane(float width, float height, MeshData& meshData) {
-		meshData.vertices.clear();
-		meshData.indices.clear();
-		float halfWidth = width / 2.0f;
-		float halfHeight = height / 2.0f;
-		Vertex vertices[4] = {
-			//Front face
-			{glm::vec3(-halfWidth, 0, -halfHeight), glm::vec3(0,1,0), glm::vec2(0, 0), glm::vec3(0, 0, 0)}, //BL
-			{glm::vec3(+halfWidth, 0, -halfHeight), glm::vec3(0,1,0), glm::vec2(1, 0), glm::vec3(0, 0, 0)}, //BR
-			{glm::vec3(+halfWidth, 0, +halfHeight), glm::vec3(0,1,0), glm::vec2(1, 1), glm::vec3(0, 0, 0)}, //TR
-			{glm::vec3(-halfWidth, 0, +halfHeight), glm::vec3(0,1,0), glm::vec2(0, 1), glm::vec3(0, 0, 0)} //TL
-		};
-		meshData.vertices.assign(&vertices[0], &vertices[4]);
-		unsigned int indices[6] = {
-			// front face
-			0, 2, 1,
-			0, 3, 2
-		};
-		meshData.indices.assign(&indices[0], &indices[6]);
-
-		// Calculate tangents
-		for (int i = 0; i < meshData.indices.size(); i += 3)
+	// Assigns every vertex the tangent of the last triangle that references it
+	static void calculateTangents(Vertex* vertices, const unsigned int* indices, unsigned int numIndices, glm::vec3 tangentSign = glm::vec3(1))
+	{
+		for (unsigned int i = 0; i < numIndices; i += 3)
 		{
-			Vertex& vertex1 = meshData.vertices[meshData.indices[i]];
-			Vertex& vertex2 = meshData.vertices[meshData.indices[i + 1]];
-			Vertex& vertex3 = meshData.vertices[meshData.indices[i + 2]];
+			Vertex& vertex1 = vertices[indices[i]];
+			Vertex& vertex2 = vertices[indices[i + 1]];
+			Vertex& vertex3 = vertices[indices[i + 2]];
 
 			glm::vec3 edge1 = vertex2.position - vertex1.position;
 			glm::vec3 edge2 = vertex3.position - vertex1.position;
@@ -44,148 +27,157 @@ namespace ew {
 			tangent.y = f * (deltaUV2.y * edge1.y - deltaUV1.y * edge2.y);
 			tangent.z = f * (deltaUV2.y * edge1.z - deltaUV1.y * edge2.z);
 
+			tangent *= tangentSign;
+
 			vertex1.tangent = tangent;
 			vertex2.tangent = tangent;
 			vertex3.tangent = tangent;
 		}
-	};
+	}
 
-	void createQuad(float width, float height, MeshData& meshData) {
-		meshData.vertices.clear();
-		meshData.indices.clear();
-		float halfWidth = width / 2.0f;
-		float halfHeight = height / 2.0f;
-		Vertex vertices[4] = {
-			//Front face
-			{glm::vec3(-halfWidth, -halfHeight, 0), glm::vec3(0,0,1), glm::vec2(0, 0), glm::vec3(0, 0, 0)}, //BL
-			{glm::vec3(+halfWidth, -halfHeight, 0), glm::vec3(0,0,1), glm::vec2(1, 0), glm::vec3(0, 0, 0)}, //BR
-			{glm::vec3(+halfWidth, +halfHeight, 0), glm::vec3(0,0,1), glm::vec2(1, 1), glm::vec3(0, 0, 0)}, //TR
-			{glm::vec3(-halfWidth, +halfHeight, 0), glm::vec3(0,0,1), glm::vec2(0, 1), glm::vec3(0, 0, 0)} //TL
-		};
-		meshData.vertices.assign(&vertices[0], &vertices[4]);
-		unsigned int indices[6] = {
-			// front face
-			0, 1, 2,
-			0, 2, 3
-		};
-		meshData.indices.assign(&indices[0], &indices[6]);
-	};
+	// Resizing (instead of clearing and pushing) keeps the vectors' capacity,
+	// so regenerating a mesh of the same or smaller size never reallocates
+	static void resizeMeshData(MeshSize size, MeshData& meshData)
+	{
+		meshData.vertices.resize(size.numVertices);
+		meshData.indices.resize(size.numIndices);
+	}
 
-	void createCube(float width, float height, float depth, MeshData& meshData)
+	// The pointer overloads build into this and copy the finished mesh out, so their destination
+	// is only written, never read back (a mapped buffer needn't be readable). Keeps its capacity
+	static MeshData& getScratchMeshData()
 	{
-		meshData.vertices.clear();
-		meshData.indices.clear();
+		thread_local MeshData scratch;
+		return scratch;
+	}
 
-		float halfWidth = width / 2.0f;
-		float halfHeight = height / 2.0f;
-		float halfDepth = depth / 2.0f;
+	static void copyMeshData(const MeshData& meshData, Vertex* vertices, unsigned int* indices)
+	{
+		std::copy(meshData.vertices.begin(), meshData.vertices.end(), vertices);
+		std::copy(meshData.indices.begin(), meshData.indices.end(), indices);
+	}
 
-		//VERTICES
-		//-------------
-		Vertex vertices[24] = {
-			//Front face
-			{glm::vec3(-halfWidth, -halfHeight, +halfDepth), glm::vec3(0,0,1), glm::vec2(0, 0), glm::vec3(0, 0, 0)}, //BL
-			{glm::vec3(+halfWidth, -halfHeight, +halfDepth), glm::vec3(0,0,1), glm::vec2(1, 0), glm::vec3(0, 0, 0)}, //BR
-			{glm::vec3(+halfWidth, +halfHeight, +halfDepth), glm::vec3(0,0,1), glm::vec2(1, 1), glm::vec3(0, 0, 0)}, //TR
-			{glm::vec3(-halfWidth, +halfHeight, +halfDepth), glm::vec3(0,0,1), glm::vec2(0, 1), glm::vec3(0, 0, 0)}, //TL
-
-			//Back face
-			{glm::vec3(+halfWidth, -halfHeight, -halfDepth), glm::vec3(0,0,-1), glm::vec2(0, 0), glm::vec3(0, 0, 0)}, //BL
-			{glm::vec3(-halfWidth, -halfHeight, -halfDepth), glm::vec3(0,0,-1), glm::vec2(1, 0), glm::vec3(0, 0, 0)}, //BR
-			{glm::vec3(-halfWidth, +halfHeight, -halfDepth), glm::vec3(0,0,-1), glm::vec2(1, 1), glm::vec3(0, 0, 0)}, //TR
-			{glm::vec3(+halfWidth, +halfHeight, -halfDepth), glm::vec3(0,0,-1), glm::vec2(0, 1), glm::vec3(0, 0, 0)}, //TL
-
-			//Right face
-			{glm::vec3(+halfWidth, -halfHeight, +halfDepth), glm::vec3(1,0,0), glm::vec2(0, 0), glm::vec3(0, 0, 0)}, //BL
-			{glm::vec3(+halfWidth, -halfHeight, -halfDepth), glm::vec3(1,0,0), glm::vec2(1, 0), glm::vec3(0, 0, 0)}, //BR
-			{glm::vec3(+halfWidth, +halfHeight, -halfDepth), glm::vec3(1,0,0), glm::vec2(1, 1), glm::vec3(0, 0, 0)}, //TR
-			{glm::vec3(+halfWidth, +halfHeight, +halfDepth), glm::vec3(1,0,0), glm::vec2(0, 1), glm::vec3(0, 0, 0)}, //TL
-
-			//Left face
-			{glm::vec3(-halfWidth, -halfHeight, -halfDepth), glm::vec3(-1,0,0), glm::vec2(0, 0), glm::vec3(0, 0, 0)}, //BL
-			{glm::vec3(-halfWidth, -halfHeight, +halfDepth), glm::vec3(-1,0,0), glm::vec2(1, 0), glm::vec3(0, 0, 0)}, //BR
-			{glm::vec3(-halfWidth, +halfHeight, +halfDepth), glm::vec3(-1,0,0), glm::vec2(1, 1), glm::vec3(0, 0, 0)}, //TR
-			{glm::vec3(-halfWidth, +halfHeight, -halfDepth), glm::vec3(-1,0,0), glm::vec2(0, 1), glm::vec3(0, 0, 0)}, //TL
-
-			//Top face
-			{glm::vec3(-halfWidth, +halfHeight, +halfDepth), glm::vec3(0,1,0), glm::vec2(0, 0), glm::vec3(0, 0, 0)}, //BL
-			{glm::vec3(+halfWidth, +halfHeight, +halfDepth), glm::vec3(0,1,0), glm::vec2(1, 0), glm::vec3(0, 0, 0)}, //BR
-			{glm::vec3(+halfWidth, +halfHeight, -halfDepth), glm::vec3(0,1,0), glm::vec2(1, 1), glm::vec3(0, 0, 0)}, //TR
-			{glm::vec3(-halfWidth, +halfHeight, -halfDepth), glm::vec3(0,1,0), glm::vec2(0, 1), glm::vec3(0, 0, 0)}, //TL
-
-			//Bottom face
-			{glm::vec3(-halfWidth, -halfHeight, -halfDepth), glm::vec3(0,-1,0), glm::vec2(0, 0), glm::vec3(0, 0, 0)}, //BL
-			{glm::vec3(+halfWidth, -halfHeight, -halfDepth), glm::vec3(0,-1,0), glm::vec2(1, 0), glm::vec3(0, 0, 0)}, //BR
-			{glm::vec3(+halfWidth, -halfHeight, +halfDepth), glm::vec3(0,-1,0), glm::vec2(1, 1), glm::vec3(0, 0, 0)}, //TR
-			{glm::vec3(-halfWidth, -halfHeight, +halfDepth), glm::vec3(0,-1,0), glm::vec2(0, 1), glm::vec3(0, 0, 0)}, //TL
-		};
-		meshData.vertices.assign(&vertices[0], &vertices[24]);
+	// Fewer segments can't close the shape. Sizing and generation both go through these
+	int clampSphereSegments(int numSegments) { return glm::max(numSegments, 2); }
+	int clampCylinderSegments(int numSegments) { return glm::max(numSegments, 1); }
 
-		//INDICES
-		//-------------
+	static void generatePlane(float width, float height, Vertex* vertices, unsigned int* indices);
+	static void generateSphere(float radius, int numSegments, Vertex* vertices, unsigned int* indices);
+	static void generateCylinder(float height, float radius, int numSegments, Vertex* vertices, unsigned int* indices);
 
-		unsigned int indices[36] = {
-			// front face
-			0, 1, 2,
-			0, 2, 3,
+	MeshSize getPlaneSize() { return { 4, 6 }; }
+	MeshSize getQuadSize() { return { 4, 6 }; }
+	MeshSize getCubeSize() { return { 24, 36 }; }
 
-			// back face
-			4, 5, 6,
-			6, 7, 4,
+	MeshSize getSphereSize(int numSegments)
+	{
+		unsigned int segments = (unsigned int)clampSphereSegments(numSegments);
+		unsigned int ringVertexCount = segments + 1;
+
+		MeshSize size;
+		//Poles + rings
+		size.numVertices = 2 + (segments - 1) * ringVertexCount;
+		//Top cap + rings + bottom cap
+		size.numIndices = 3 * segments + 6 * segments * (segments - 2) + 3 * ringVertexCount;
+		return size;
+	}
 
-			// right face
-			8,  9, 10,
-			10, 11, 8,
+	MeshSize getCylinderSize(int numSegments)
+	{
+		unsigned int segments = (unsigned int)clampCylinderSegments(numSegments);
+		unsigned int ringVertexCount = segments + 1;
+
+		MeshSize size;
+		//Cap centers + cap rings + side rings
+		size.numVertices = 2 + 4 * ringVertexCount;
+		//Top cap + bottom cap + side quads
+		size.numIndices = 12 * segments;
+		return size;
+	}
 
-			//left face 
-			12, 13, 14,
-			14, 15, 12,
+	void createPlane(float width, float height, MeshData& meshData) {
+		resizeMeshData(getPlaneSize(), meshData);
+		generatePlane(width, height, meshData.vertices.data(), meshData.indices.data());
+	}
 
-			//top face
-			16,17,18,
-			18,19,16,
+	void createPlane(float width, float height, Vertex* vertices, unsigned int* indices) {
+		MeshData& scratch = getScratchMeshData();
+		createPlane(width, height, scratch);
+		copyMeshData(scratch, vertices, indices);
+	}
 
-			//bottom face
-			20, 21, 22,
-			22, 23, 20
-		};
-		meshData.indices.assign(&indices[0], &indices[36]);
+	// Writes and then reads vertices and indices, for the tangents
+	static void generatePlane(float width, float height, Vertex* vertices, unsigned int* indices) {
+		float halfWidth = width / 2.0f;
+		float halfHeight = height / 2.0f;
+		//Front face
+		vertices[0] = { glm::vec3(-halfWidth, 0, -halfHeight), glm::vec3(0,1,0), glm::vec2(0, 0), glm::vec3(0, 0, 0) }; //BL
+		vertices[1] = { glm::vec3(+halfWidth, 0, -halfHeight), glm::vec3(0,1,0), glm::vec2(1, 0), glm::vec3(0, 0, 0) }; //BR
+		vertices[2] = { glm::vec3(+halfWidth, 0, +halfHeight), glm::vec3(0,1,0), glm::vec2(1, 1), glm::vec3(0, 0, 0) }; //TR
+		vertices[3] = { glm::vec3(-halfWidth, 0, +halfHeight), glm::vec3(0,1,0), glm::vec2(0, 1), glm::vec3(0, 0, 0) }; //TL
 
-		// Calculate tangents
-		for (int i = 0; i < meshData.indices.size(); i += 3)
-		{
-			Vertex& vertex1 = meshData.vertices[meshData.indices[i]];
-			Vertex& vertex2 = meshData.vertices[meshData.indices[i + 1]];
-			Vertex& vertex3 = meshData.vertices[meshData.indices[i + 2]];
+		const unsigned int planeIndices[6] = {
+			// front face
+			0, 2, 1,
+			0, 3, 2
+		};
+		for (int i = 0; i < 6; i++) {
+			indices[i] = planeIndices[i];
+		}
 
-			glm::vec3 edge1 = vertex2.position - vertex1.position;
-			glm::vec3 edge2 = vertex3.position - vertex1.position;
+		calculateTangents(vertices, indices, 6);
+	};
 
-			glm::vec2 deltaUV1 = vertex2.uv - vertex1.uv;
-			glm::vec2 deltaUV2 = vertex3.uv - vertex1.uv;
+	void createQuad(float width, float height, MeshData& meshData) {
+		resizeMeshData(getQuadSize(), meshData);
+		createQuad(width, height, meshData.vertices.data(), meshData.indices.data());
+	}
 
-			float f = 1.0f / (deltaUV1.x * deltaUV2.y - deltaUV2.x * deltaUV1.y);
+	void createQuad(float width, float height, Vertex* vertices, unsigned int* indices) {
+		StaticMeshData<4, 6> quad = createQuadStatic(width, height);
+		std::copy(quad.vertices.begin(), quad.vertices.end(), vertices);
+		std::copy(quad.indices.begin(), quad.indices.end(), indices);
+	};
 
-			glm::vec3 tangent;
-			tangent.x = f * (deltaUV2.y * edge1.x - deltaUV1.y * edge2.x);
-			tangent.y = f * (deltaUV2.y * edge1.y - deltaUV1.y * edge2.y);
-			tangent.z = f * (deltaUV2.y * edge1.z - deltaUV1.y * edge2.z);
+	void createCube(float width, float height, float depth, MeshData& meshData)
+	{
+		resizeMeshData(getCubeSize(), meshData);
+		createCube(width, height, depth, meshData.vertices.data(), meshData.indices.data());
+	}
 
-			vertex1.tangent = tangent;
-			vertex2.tangent = tangent;
-			vertex3.tangent = tangent;
-		}
+	void createCube(float width, float height, float depth, Vertex* vertices, unsigned int* indices)
+	{
+		StaticMeshData<24, 36> cube = createCubeStatic(width, height, depth);
+		std::copy(cube.vertices.begin(), cube.vertices.end(), vertices);
+		std::copy(cube.indices.begin(), cube.indices.end(), indices);
 	}
+
 	void createSphere(float radius, int numSegments, MeshData& meshData)
 	{
-		meshData.vertices.clear();
-		meshData.indices.clear();
+		numSegments = clampSphereSegments(numSegments);
+		resizeMeshData(getSphereSize(numSegments), meshData);
+		generateSphere(radius, numSegments, meshData.vertices.data(), meshData.indices.data());
+	}
+
+	void createSphere(float radius, int numSegments, Vertex* vertices, unsigned int* indices)
+	{
+		MeshData& scratch = getScratchMeshData();
+		createSphere(radius, numSegments, scratch);
+		copyMeshData(scratch, vertices, indices);
+	}
+
+	// numSegments already clamped. Reads back what it wrote, for the tangents
+	static void generateSphere(float radius, int numSegments, Vertex* vertices, unsigned int* indices)
+	{
+		MeshSize size = getSphereSize(numSegments);
+		unsigned int numVertices = 0;
+		unsigned int numIndices = 0;
 
 		float topY = radius;
 		float bottomY = -radius;
 
 		unsigned int topIndex = 0;
-		meshData.vertices.push_back({ glm::vec3(0,topY,0),glm::vec3(0,1,0), glm::vec2(0.5, 0.5), glm::vec3(0, 0, 0)});
+		vertices[numVertices++] = { glm::vec3(0,topY,0),glm::vec3(0,1,0), glm::vec2(0.5, 0.5), glm::vec3(0, 0, 0)};
 
 		//Angle between segments
 		float thetaStep = (2.0f * glm::pi<float>()) / (float)numSegments;
@@ -214,19 +206,19 @@ namespace ew {
 				glm::vec3 normal = glm::normalize(glm::vec3(x, y, z));
 				glm::vec2 uv = glm::vec2(s, t);
 
-				meshData.vertices.push_back({ position, normal, uv, glm::vec3(0, 0, 0)});
+				vertices[numVertices++] = { position, normal, uv, glm::vec3(0, 0, 0)};
 			}
 		}
 
-		meshData.vertices.push_back({ glm::vec3(0,bottomY,0), glm::vec3(0,-1,0), glm::vec2(0.5, 0.5), glm::vec3(0, 0, 0)});
-		unsigned int bottomIndex = (unsigned int)meshData.vertices.size() - 1;
+		vertices[numVertices++] = { glm::vec3(0,bottomY,0), glm::vec3(0,-1,0), glm::vec2(0.5, 0.5), glm::vec3(0, 0, 0)};
+		unsigned int bottomIndex = numVertices - 1;
 		unsigned int ringVertexCount = numSegments + 1;
 
 		//TOP CAP
 		for (int i = 0; i < numSegments; ++i) {
-			meshData.indices.push_back(topIndex); //top cap center 
-			meshData.indices.push_back(i + 1);
-			meshData.indices.push_back(i + 2);
+			indices[numIndices++] = topIndex; //top cap center
+			indices[numIndices++] = i + 1;
+			indices[numIndices++] = i + 2;
 		}
 
 		//RINGS
@@ -240,14 +232,14 @@ namespace ew {
 			for (int x = 0; x < numSegments; ++x)
 			{
 				//Triangle 1
-				meshData.indices.push_back(start + y * ringVertexCount + x);
-				meshData.indices.push_back(start + (y + 1) * ringVertexCount + x);
-				meshData.indices.push_back(start + y * ringVertexCount + x + 1);
+				indices[numIndices++] = start + y * ringVertexCount + x;
+				indices[numIndices++] = start + (y + 1) * ringVertexCount + x;
+				indices[numIndices++] = start + y * ringVertexCount + x + 1;
 
 				//Triangle 2
-				meshData.indices.push_back(start + y * ringVertexCount + x + 1);
-				meshData.indices.push_back(start + (y + 1) * ringVertexCount + x);
-				meshData.indices.push_back(start + (y + 1) * ringVertexCount + x + 1);
+				indices[numIndices++] = start + y * ringVertexCount + x + 1;
+				indices[numIndices++] = start + (y + 1) * ringVertexCount + x;
+				indices[numIndices++] = start + (y + 1) * ringVertexCount + x + 1;
 			}
 		}
 
@@ -255,53 +247,43 @@ namespace ew {
 
 		//BOTTOM CAP
 		for (unsigned int i = 0; i < ringVertexCount; ++i) {
-			meshData.indices.push_back(start + i + 1);
-			meshData.indices.push_back(start + i);
-			meshData.indices.push_back(bottomIndex); //bottom cap center 
+			indices[numIndices++] = start + i + 1;
+			indices[numIndices++] = start + i;
+			indices[numIndices++] = bottomIndex; //bottom cap center
 		}
 
 		// Calculate tangents
 		// Try working in reverse here?
-		for (int i = 0; i < meshData.indices.size(); i += 3)
-		{
-			Vertex& vertex1 = meshData.vertices[meshData.indices[i]];
-			Vertex& vertex2 = meshData.vertices[meshData.indices[i + 1]];
-			Vertex& vertex3 = meshData.vertices[meshData.indices[i + 2]];
-
-			glm::vec3 edge1 = vertex2.position - vertex1.position;
-			glm::vec3 edge2 = vertex3.position - vertex1.position;
-
-			glm::vec2 deltaUV1 = vertex2.uv - vertex1.uv;
-			glm::vec2 deltaUV2 = vertex3.uv - vertex1.uv;
-
-			float f = 1.0 / (deltaUV1.x * deltaUV2.y - deltaUV2.x * deltaUV1.y);
-
-			glm::vec3 tangent;
-			tangent.x = f * (deltaUV2.y * edge1.x - deltaUV1.y * edge2.x);
-			tangent.y = f * (deltaUV2.y * edge1.y - deltaUV1.y * edge2.y);
-			tangent.z = f * (deltaUV2.y * edge1.z - deltaUV1.y * edge2.z);
+		calculateTangents(vertices, indices, size.numIndices, glm::vec3(1, -1, -1));
+	}
 
-			tangent.x *= 1;
-			tangent.y *= -1;
-			tangent.z *= -1;
+	void createCylinder(float height, float radius, int numSegments, MeshData& meshData)
+	{
+		numSegments = clampCylinderSegments(numSegments);
+		resizeMeshData(getCylinderSize(numSegments), meshData);
+		generateCylinder(height, radius, numSegments, meshData.vertices.data(), meshData.indices.data());
+	}
 
-			vertex1.tangent = tangent;
-			vertex2.tangent = tangent;
-			vertex3.tangent = tangent;
-		}
+	void createCylinder(float height, float radius, int numSegments, Vertex* vertices, unsigned int* indices)
+	{
+		MeshData& scratch = getScratchMeshData();
+		createCylinder(height, radius, numSegments, scratch);
+		copyMeshData(scratch, vertices, indices);
 	}
 
-	void createCylinder(float height, float radius, int numSegments, MeshData& meshData)
+	// numSegments already clamped. Reads back what it wrote, for the side rings and the tangents
+	static void generateCylinder(float height, float radius, int numSegments, Vertex* vertices, unsigned int* indices)
 	{
-		meshData.vertices.clear();
-		meshData.indices.clear();
+		MeshSize size = getCylinderSize(numSegments);
+		unsigned int numVertices = 0;
+		unsigned int numIndices = 0;
 
 		float halfHeight = height * 0.5f;
 		float thetaStep = glm::pi<float>() * 2.0f / numSegments;
 
 		//VERTICES
 		//Top cap (facing up)
-		meshData.vertices.push_back(Vertex(glm::vec3(0, halfHeight, 0), glm::vec3(0, 1, 0), glm::vec2(0.5, 0.5), glm::vec3(0, 0, 0)));
+		vertices[numVertices++] = Vertex(glm::vec3(0, halfHeight, 0), glm::vec3(0, 1, 0), glm::vec2(0.5, 0.5), glm::vec3(0, 0, 0));
 		for (int i = 0; i <= numSegments; i++)
 		{
 			glm::vec3 pos = glm::vec3(
@@ -313,12 +295,12 @@ namespace ew {
 			float s = (pos.x / radius + 1) * 0.5f;
 			float t = (pos.z / radius + 1) * 0.5f;
 
-			meshData.vertices.push_back(Vertex(pos, glm::vec3(0, 1, 0), glm::vec2(s, t), glm::vec3(0, 0, 0)));
+			vertices[numVertices++] = Vertex(pos, glm::vec3(0, 1, 0), glm::vec2(s, t), glm::vec3(0, 0, 0));
 		}
 
 		//Bottom cap (facing down)
-		meshData.vertices.push_back(Vertex(glm::vec3(0, -halfHeight, 0), glm::vec3(0, -1, 0), glm::vec2(0.5, 0.5), glm::vec3(0, 0, 0)));
-		unsigned int bottomCenterIndex = (unsigned int)meshData.vertices.size() - 1;
+		vertices[numVertices++] = Vertex(glm::vec3(0, -halfHeight, 0), glm::vec3(0, -1, 0), glm::vec2(0.5, 0.5), glm::vec3(0, 0, 0));
+		unsigned int bottomCenterIndex = numVertices - 1;
 		for (int i = 0; i <= numSegments; i++)
 		{
 			glm::vec3 pos = glm::vec3(
@@ -330,88 +312,66 @@ namespace ew {
 			float s = (pos.x / radius + 1) * 0.5f;
 			float t = (pos.z / radius + 1) * 0.5f;
 
-			meshData.vertices.push_back(Vertex(pos, glm::vec3(0, -1, 0), glm::vec2(s, t), glm::vec3(0, 0, 0)));
+			vertices[numVertices++] = Vertex(pos, glm::vec3(0, -1, 0), glm::vec2(s, t), glm::vec3(0, 0, 0));
 		}
 
 		//Sides (facing out)
-		unsigned int sideStartIndex = (unsigned int)meshData.vertices.size();
+		unsigned int sideStartIndex = numVertices;
 		//Side top ring
 		for (int i = 0; i <= numSegments; i++)
 		{
-			glm::vec3 pos = meshData.vertices[i + 1].position;
-			glm::vec3 normal = glm::normalize((pos - meshData.vertices[0].position));
+			glm::vec3 pos = vertices[i + 1].position;
+			glm::vec3 normal = glm::normalize((pos - vertices[0].position));
 
 			float s = glm::mix((float)i, (float)i + 1, (float)(1 / numSegments));
 			s = s / (float)numSegments;
 
 			float t = pos.y;
 
-			meshData.vertices.push_back(Vertex(pos, normal, glm::vec2(s, t), glm::vec3(0, 0, 0)));
+			vertices[numVertices++] = Vertex(pos, normal, glm::vec2(s, t), glm::vec3(0, 0, 0));
 		}
 		//Side bottom ring
 		for (int i = 0; i <= numSegments; i++)
 		{
-			glm::vec3 pos = meshData.vertices[bottomCenterIndex + i + 1].position;
-			glm::vec3 normal = glm::normalize((pos - meshData.vertices[bottomCenterIndex].position));
+			glm::vec3 pos = vertices[bottomCenterIndex + i + 1].position;
+			glm::vec3 normal = glm::normalize((pos - vertices[bottomCenterIndex].position));
 
 			float s = glm::mix((float)i, (float)i + 1, (float)(1 / numSegments));
 			s = s / (float)numSegments;
 
 			float t = pos.y;
 
-			meshData.vertices.push_back(Vertex(pos, normal, glm::vec2(s, t), glm::vec3(0, 0, 0)));
+			vertices[numVertices++] = Vertex(pos, normal, glm::vec2(s, t), glm::vec3(0, 0, 0));
 		}
 
 		//INDICES
 		//Top cap
 		for (int i = 0; i < numSegments; i++)
 		{
-			meshData.indices.push_back(i + 1);
-			meshData.indices.push_back(0);
-			meshData.indices.push_back(i + 2);
+			indices[numIndices++] = i + 1;
+			indices[numIndices++] = 0;
+			indices[numIndices++] = i + 2;
 		}
 		//Bottom cap
 		for (int i = 0; i < numSegments; i++)
 		{
-			meshData.indices.push_back(bottomCenterIndex);
-			meshData.indices.push_back(bottomCenterIndex + i + 1);
-			meshData.indices.push_back(bottomCenterIndex + i + 2);
+			indices[numIndices++] = bottomCenterIndex;
+			indices[numIndices++] = bottomCenterIndex + i + 1;
+			indices[numIndices++] = bottomCenterIndex + i + 2;
 		}
 		//Side quads
 		for (int i = 0; i < numSegments; i++)
 		{
 			unsigned int start = sideStartIndex + i;
-			meshData.indices.push_back(start);
-			meshData.indices.push_back(start + 1);
-			meshData.indices.push_back(start + numSegments + 1);
-			meshData.indices.push_back(start + numSegments + 1);
-			meshData.indices.push_back(start + 1);
-			meshData.indices.push_back(start + numSegments + 2);
+			indices[numIndices++] = start;
+			indices[numIndices++] = start + 1;
+			indices[numIndices++] = start + numSegments + 1;
+			indices[numIndices++] = start + numSegments + 1;
+			indices[numIndices++] = start + 1;
+			indices[numIndices++] = start + numSegments + 2;
 		}
 
 		// Calculate tangents
-		for (int i = 0; i < meshData.indices.size(); i += 3)
-		{
-			Vertex& vertex1 = meshData.vertices[meshData.indices[i]];
-			Vertex& vertex2 = meshData.vertices[meshData.indices[i + 1]];
-			Vertex& vertex3 = meshData.vertices[meshData.indices[i + 2]];
-
-			glm::vec3 edge1 = vertex2.position - vertex1.position;
-			glm::vec3 edge2 = vertex3.position - vertex1.position;
-
-			glm::vec2 deltaUV1 = vertex2.uv - vertex1.uv;
-			glm::vec2 deltaUV2 = vertex3.uv - vertex1.uv;
-
-			float f = 1.0 / (deltaUV1.x * deltaUV2.y - deltaUV2.x * deltaUV1.y);
-
-			glm::vec3 tangent;
-			tangent.x = f * (deltaUV2.y * edge1.x - deltaUV1.y * edge2.x);
-			tangent.y = f * (deltaUV2.y * edge1.y - deltaUV1.y * edge2.y);
-			tangent.z = f * (deltaUV2.y * edge1.z - deltaUV1.y * edge2.z);
-
-			vertex1.tangent = tangent;
-			vertex2.tangent = tangent;
-			vertex3.tangent = tangent;
-		}
+		calculateTangents(vertices, indices, size.numIndices);
 	}
 }
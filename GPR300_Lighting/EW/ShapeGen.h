@@ -4,9 +4,165 @@
 #include "Mesh.h"
 
 namespace ew {
+	/// <summary>
+	/// Exact amount of vertices and indices a generator will write
+	/// </summary>
+	struct MeshSize {
+		unsigned int numVertices;
+		unsigned int numIndices;
+	};
+
+	/// <summary>
+	/// Fewest segments that close the shape. Every generator and get*Size clamps to these,
+	/// so anything sizing buffers for another generator (ie. ShapeGenGPU) must as well
+	/// </summary>
+	int clampSphereSegments(int numSegments);
+	int clampCylinderSegments(int numSegments);
+
+	MeshSize getPlaneSize();
+	MeshSize getQuadSize();
+	MeshSize getCubeSize();
+	MeshSize getSphereSize(int numSegments);
+	MeshSize getCylinderSize(int numSegments);
+
 	void createPlane(float width, float height, MeshData& meshData);
 	void createQuad(float width, float height, MeshData& meshData);
 	void createCube(float width, float height, float depth, MeshData& meshData);
 	void createSphere(float radius, int numSegments, MeshData& meshData);
 	void createCylinder(float height, float radius, int numSegments, MeshData& meshData);
+
+	/// <summary>
+	/// Allocation free versions. vertices and indices must have room for
+	/// at least the amount returned by the matching get*Size function.
+	/// They can point anywhere, including a mapped GPU buffer (see Mesh::mapVertices)
+	/// </summary>
+	void createPlane(float width, float height, Vertex* vertices, unsigned int* indices);
+	void createQuad(float width, float height, Vertex* vertices, unsigned int* indices);
+	void createCube(float width, float height, float depth, Vertex* vertices, unsigned int* indices);
+	void createSphere(float radius, int numSegments, Vertex* vertices, unsigned int* indices);
+	void createCylinder(float height, float radius, int numSegments, Vertex* vertices, unsigned int* indices);
+
+	/// <summary>
+	/// Same tangents as the runtime generators, usable in constant expressions
+	/// </summary>
+	template<std::size_t NumVertices, std::size_t NumIndices>
+	constexpr void calculateTangentsStatic(StaticMeshData<NumVertices, NumIndices>& meshData) {
+		for (std::size_t i = 0; i < NumIndices; i += 3)
+		{
+			Vertex& vertex1 = meshData.vertices[meshData.indices[i]];
+			Vertex& vertex2 = meshData.vertices[meshData.indices[i + 1]];
+			Vertex& vertex3 = meshData.vertices[meshData.indices[i + 2]];
+
+			glm::vec3 edge1 = vertex2.position - vertex1.position;
+			glm::vec3 edge2 = vertex3.position - vertex1.position;
+
+			glm::vec2 deltaUV1 = vertex2.uv - vertex1.uv;
+			glm::vec2 deltaUV2 = vertex3.uv - vertex1.uv;
+
+			float f = 1.0f / (deltaUV1.x * deltaUV2.y - deltaUV2.x * deltaUV1.y);
+
+			glm::vec3 tangent = glm::vec3(
+				f * (deltaUV2.y * edge1.x - deltaUV1.y * edge2.x),
+				f * (deltaUV2.y * edge1.y - deltaUV1.y * edge2.y),
+				f * (deltaUV2.y * edge1.z - deltaUV1.y * edge2.z)
+			);
+
+			vertex1.tangent = tangent;
+			vertex2.tangent = tangent;
+			vertex3.tangent = tangent;
+		}
+	}
+
+	/// <summary>
+	/// Compile time versions of createQuad / createCube. Assigning the result to a
+	/// constexpr variable puts the whole table in read only data:
+	///     constexpr auto cubeData = ew::createCubeStatic(1.0f, 1.0f, 1.0f);
+	///     ew::Mesh cube(cubeData);
+	/// </summary>
+	constexpr StaticMeshData<4, 6> createQuadStatic(float width, float height) {
+		float halfWidth = width / 2.0f;
+		float halfHeight = height / 2.0f;
+		return StaticMeshData<4, 6>{ {{
+			//Front face
+			{glm::vec3(-halfWidth, -halfHeight, 0), glm::vec3(0,0,1), glm::vec2(0, 0), glm::vec3(0, 0, 0)}, //BL
+			{glm::vec3(+halfWidth, -halfHeight, 0), glm::vec3(0,0,1), glm::vec2(1, 0), glm::vec3(0, 0, 0)}, //BR
+			{glm::vec3(+halfWidth, +halfHeight, 0), glm::vec3(0,0,1), glm::vec2(1, 1), glm::vec3(0, 0, 0)}, //TR
+			{glm::vec3(-halfWidth, +halfHeight, 0), glm::vec3(0,0,1), glm::vec2(0, 1), glm::vec3(0, 0, 0)} //TL
+		}}, {{
+			// front face
+			0, 1, 2,
+			0, 2, 3
+		}} };
+	}
+
+	constexpr StaticMeshData<24, 36> createCubeStatic(float width, float height, float depth) {
+		float halfWidth = width / 2.0f;
+		float halfHeight = height / 2.0f;
+		float halfDepth = depth / 2.0f;
+
+		StaticMeshData<24, 36> meshData = { {{
+			//Front face
+			{glm::vec3(-halfWidth, -halfHeight, +halfDepth), glm::vec3(0,0,1), glm::vec2(0, 0), glm::vec3(0, 0, 0)}, //BL
+			{glm::vec3(+halfWidth, -halfHeight, +halfDepth), glm::vec3(0,0,1), glm::vec2(1, 0), glm::vec3(0, 0, 0)}, //BR
+			{glm::vec3(+halfWidth, +halfHeight, +halfDepth), glm::vec3(0,0,1), glm::vec2(1, 1), glm::vec3(0, 0, 0)}, //TR
+			{glm::vec3(-halfWidth, +halfHeight, +halfDepth), glm::vec3(0,0,1), glm::vec2(0, 1), glm::vec3(0, 0, 0)}, //TL
+
+			//Back face
+			{glm::vec3(+halfWidth, -halfHeight, -halfDepth), glm::vec3(0,0,-1), glm::vec2(0, 0), glm::vec3(0, 0, 0)}, //BL
+			{glm::vec3(-halfWidth, -halfHeight, -halfDepth), glm::vec3(0,0,-1), glm::vec2(1, 0), glm::vec3(0, 0, 0)}, //BR
+			{glm::vec3(-halfWidth, +halfHeight, -halfDepth), glm::vec3(0,0,-1), glm::vec2(1, 1), glm::vec3(0, 0, 0)}, //TR
+			{glm::vec3(+halfWidth, +halfHeight, -halfDepth), glm::vec3(0,0,-1), glm::vec2(0, 1), glm::vec3(0, 0, 0)}, //TL
+
+			//Right face
+			{glm::vec3(+halfWidth, -halfHeight, +halfDepth), glm::vec3(1,0,0), glm::vec2(0, 0), glm::vec3(0, 0, 0)}, //BL
+			{glm::vec3(+halfWidth, -halfHeight, -halfDepth), glm::vec3(1,0,0), glm::vec2(1, 0), glm::vec3(0, 0, 0)}, //BR
+			{glm::vec3(+halfWidth, +halfHeight, -halfDepth), glm::vec3(1,0,0), glm::vec2(1, 1), glm::vec3(0, 0, 0)}, //TR
+			{glm::vec3(+halfWidth, +halfHeight, +halfDepth), glm::vec3(1,0,0), glm::vec2(0, 1), glm::vec3(0, 0, 0)}, //TL
+
+			//Left face
+			{glm::vec3(-halfWidth, -halfHeight, -halfDepth), glm::vec3(-1,0,0), glm::vec2(0, 0), glm::vec3(0, 0, 0)}, //BL
+			{glm::vec3(-halfWidth, -halfHeight, +halfDepth), glm::vec3(-1,0,0), glm::vec2(1, 0), glm::vec3(0, 0, 0)}, //BR
+			{glm::vec3(-halfWidth, +halfHeight, +halfDepth), glm::vec3(-1,0,0), glm::vec2(1, 1), glm::vec3(0, 0, 0)}, //TR
+			{glm::vec3(-halfWidth, +halfHeight, -halfDepth), glm::vec3(-1,0,0), glm::vec2(0, 1), glm::vec3(0, 0, 0)}, //TL
+
+			//Top face
+			{glm::vec3(-halfWidth, +halfHeight, +halfDepth), glm::vec3(0,1,0), glm::vec2(0, 0), glm::vec3(0, 0, 0)}, //BL
+			{glm::vec3(+halfWidth, +halfHeight, +halfDepth), glm::vec3(0,1,0), glm::vec2(1, 0), glm::vec3(0, 0, 0)}, //BR
+			{glm::vec3(+halfWidth, +halfHeight, -halfDepth), glm::vec3(0,1,0), glm::vec2(1, 1), glm::vec3(0, 0, 0)}, //TR
+			{glm::vec3(-halfWidth, +halfHeight, -halfDepth), glm::vec3(0,1,0), glm::vec2(0, 1), glm::vec3(0, 0, 0)}, //TL
+
+			//Bottom face
+			{glm::vec3(-halfWidth, -halfHeight, -halfDepth), glm::vec3(0,-1,0), glm::vec2(0, 0), glm::vec3(0, 0, 0)}, //BL
+			{glm::vec3(+halfWidth, -halfHeight, -halfDepth), glm::vec3(0,-1,0), glm::vec2(1, 0), glm::vec3(0, 0, 0)}, //BR
+			{glm::vec3(+halfWidth, -halfHeight, +halfDepth), glm::vec3(0,-1,0), glm::vec2(1, 1), glm::vec3(0, 0, 0)}, //TR
+			{glm::vec3(-halfWidth, -halfHeight, +halfDepth), glm::vec3(0,-1,0), glm::vec2(0, 1), glm::vec3(0, 0, 0)}, //TL
+		}}, {{
+			// front face
+			0, 1, 2,
+			0, 2, 3,
+
+			// back face
+			4, 5, 6,
+			6, 7, 4,
+
+			// right face
+			8,  9, 10,
+			10, 11, 8,
+
+			//left face
+			12, 13, 14,
+			14, 15, 12,
+
+			//top face
+			16,17,18,
+			18,19,16,
+
+			//bottom face
+			20, 21, 22,
+			22, 23, 20
+		}} };
+
+		calculateTangentsStatic(meshData);
+		return meshData;
+	}
 }
@@ -0,0 +1,112 @@
+#include "ShapeGenGPU.h"
+#include <stdio.h>
+
+namespace ew {
+	// Must match the SHAPE_ defines in shapeGen.comp
+	enum GPUShape {
+		SHAPE_PLANE = 0,
+		SHAPE_QUAD = 1,
+		SHAPE_CUBE = 2,
+		SHAPE_SPHERE = 3,
+		SHAPE_CYLINDER = 4
+	};
+
+	const GLuint SHAPE_GEN_GROUP_SIZE = 64;
+
+	ShapeGenGPU::ShapeGenGPU() : mShader("shaders/shapeGen.comp")
+	{
+		mTangentOwnersSize = 0;
+		glCreateBuffers(1, &mTangentOwners);
+	}
+
+	ShapeGenGPU::~ShapeGenGPU()
+	{
+		glDeleteBuffers(1, &mTangentOwners);
+	}
+
+	void ShapeGenGPU::createPlane(float width, float height, Mesh& mesh)
+	{
+		generate(SHAPE_PLANE, glm::vec3(width, height, 0), 0, getPlaneSize(), mesh, true, glm::vec3(1));
+	}
+
+	void ShapeGenGPU::createQuad(float width, float height, Mesh& mesh)
+	{
+		// The CPU quad never had its tangents calculated
+		generate(SHAPE_QUAD, glm::vec3(width, height, 0), 0, getQuadSize(), mesh, false, glm::vec3(1));
+	}
+
+	void ShapeGenGPU::createCube(float width, float height, float depth, Mesh& mesh)
+	{
+		generate(SHAPE_CUBE, glm::vec3(width, height, depth), 0, getCubeSize(), mesh, true, glm::vec3(1));
+	}
+
+	void ShapeGenGPU::createSphere(float radius, int numSegments, Mesh& mesh)
+	{
+		// The shader writes as many segments as it's given, so they're clamped before sizing like on the CPU
+		numSegments = clampSphereSegments(numSegments);
+		generate(SHAPE_SPHERE, glm::vec3(radius, 0, 0), numSegments, getSphereSize(numSegments), mesh, true, glm::vec3(1, -1, -1));
+	}
+
+	void ShapeGenGPU::createCylinder(float height, float radius, int numSegments, Mesh& mesh)
+	{
+		numSegments = clampCylinderSegments(numSegments);
+		generate(SHAPE_CYLINDER, glm::vec3(radius, height, 0), numSegments, getCylinderSize(numSegments), mesh, true, glm::vec3(1));
+	}
+
+	void ShapeGenGPU::generate(int shape, glm::vec3 size, int numSegments, MeshSize meshSize, Mesh& mesh, bool calculateTangents, glm::vec3 tangentSign)
+	{
+		if ((GLsizei)meshSize.numVertices > mesh.getMaxVertices() || (GLsizei)meshSize.numIndices > mesh.getMaxIndices())
+		{
+			printf("ShapeGenGPU: mesh is too small for %u vertices / %u indices\n", meshSize.numVertices, meshSize.numIndices);
+			return;
+		}
+
+		// The first call may arrive before an async compile has finished
+		if (!mShader.waitUntilReady())
+		{
+			return;
+		}
+
+		GLuint numTriangles = meshSize.numIndices / 3;
+		GLuint numThreads = glm::max(meshSize.numVertices, numTriangles);
+
+		mShader.use();
+		mShader.setInt("_Shape", shape);
+		mShader.setVec3("_Size", size);
+		mShader.setInt("_Segments", numSegments);
+		mShader.setUint("_NumVertices", meshSize.numVertices);
+		mShader.setUint("_NumTriangles", numTriangles);
+		mShader.setVec3("_TangentSign", tangentSign);
+
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, mesh.getVBO());
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, mesh.getEBO());
+
+		mShader.setInt("_Pass", 0);
+		glDispatchCompute((numThreads + SHAPE_GEN_GROUP_SIZE - 1) / SHAPE_GEN_GROUP_SIZE, 1, 1);
+
+		if (calculateTangents)
+		{
+			if (mTangentOwnersSize < (GLsizei)meshSize.numVertices)
+			{
+				mTangentOwnersSize = meshSize.numVertices;
+				glNamedBufferData(mTangentOwners, mTangentOwnersSize * sizeof(GLuint), nullptr, GL_DYNAMIC_COPY);
+			}
+			GLuint zero = 0;
+			glClearNamedBufferSubData(mTangentOwners, GL_R32UI, 0, meshSize.numVertices * sizeof(GLuint), GL_RED_INTEGER, GL_UNSIGNED_INT, &zero);
+			glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, mTangentOwners);
+
+			glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+			mShader.setInt("_Pass", 1);
+			glDispatchCompute((numTriangles + SHAPE_GEN_GROUP_SIZE - 1) / SHAPE_GEN_GROUP_SIZE, 1, 1);
+
+			glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+			mShader.setInt("_Pass", 2);
+			glDispatchCompute((meshSize.numVertices + SHAPE_GEN_GROUP_SIZE - 1) / SHAPE_GEN_GROUP_SIZE, 1, 1);
+		}
+
+		// Make the writes visible to the draw that sources these buffers
+		glMemoryBarrier(GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT | GL_ELEMENT_ARRAY_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT);
+
+		mesh.setCounts(meshSize.numVertices, meshSize.numIndices);
+	}
+}
@@ -0,0 +1,29 @@
+#pragma once
+#include "Mesh.h"
+#include "Shader.h"
+#include "ShapeGen.h"
+
+namespace ew {
+	/// <summary>
+	/// Compute shader versions of the ShapeGen primitives (shaders/shapeGen.comp).
+	/// Vertices and indices are written straight into a Mesh's buffers, so a mesh
+	/// can be re-tessellated every frame without a CPU round trip.
+	/// The mesh must have room for the matching get*Size (see Mesh(maxVertices, maxIndices)).
+	/// </summary>
+	class ShapeGenGPU {
+	public:
+		ShapeGenGPU();
+		~ShapeGenGPU();
+		void createPlane(float width, float height, Mesh& mesh);
+		void createQuad(float width, float height, Mesh& mesh);
+		void createCube(float width, float height, float depth, Mesh& mesh);
+		void createSphere(float radius, int numSegments, Mesh& mesh);
+		void createCylinder(float height, float radius, int numSegments, Mesh& mesh);
+	private:
+		void generate(int shape, glm::vec3 size, int numSegments, MeshSize meshSize, Mesh& mesh, bool calculateTangents, glm::vec3 tangentSign);
+		Shader mShader;
+		// One uint per vertex, used to pick the same tangent the CPU generator would
+		GLuint mTangentOwners;
+		GLsizei mTangentOwnersSize;
+	};
+}
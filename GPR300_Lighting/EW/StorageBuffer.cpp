@@ -0,0 +1,36 @@
+#include "StorageBuffer.h"
+
+namespace ew {
+	// Never empty, so the shaders can always read the binding
+	const GLsizeiptr MIN_STORAGE_CAPACITY = 256;
+
+	StorageBuffer::StorageBuffer(GLuint binding)
+	{
+		mBinding = binding;
+		mCapacity = MIN_STORAGE_CAPACITY;
+
+		glCreateBuffers(1, &mSSBO);
+		glNamedBufferData(mSSBO, mCapacity, nullptr, GL_DYNAMIC_DRAW);
+		bind();
+	}
+
+	StorageBuffer::~StorageBuffer()
+	{
+		glDeleteBuffers(1, &mSSBO);
+	}
+
+	void StorageBuffer::update(const void* data, GLsizeiptr size, GLintptr offset)
+	{
+		if (offset + size > mCapacity)
+		{
+			while (mCapacity < offset + size) { mCapacity *= 2; }
+			glNamedBufferData(mSSBO, mCapacity, nullptr, GL_DYNAMIC_DRAW);
+		}
+		if (size > 0) { glNamedBufferSubData(mSSBO, offset, size, data); }
+	}
+
+	void StorageBuffer::bind()
+	{
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, mBinding, mSSBO);
+	}
+}
@@ -0,0 +1,32 @@
+#pragma once
+#include <GL/glew.h>
+#include <vector>
+
+namespace ew {
+	/// <summary>
+	/// Shader storage buffer attached to a fixed binding point, matching layout(std430, binding = N)
+	/// in the shaders. It grows to fit whatever is uploaded, keeping its name so the
+	/// binding stays valid.
+	/// </summary>
+	class StorageBuffer {
+	public:
+		StorageBuffer(GLuint binding);
+		~StorageBuffer();
+		/// <summary>
+		/// Writes size bytes at offset. Growing drops what the buffer held, so anything
+		/// uploaded earlier has to be uploaded again after a write past the capacity
+		/// </summary>
+		void update(const void* data, GLsizeiptr size, GLintptr offset = 0);
+		template<typename T>
+		void update(const std::vector<T>& elements) { update(elements.data(), sizeof(T) * elements.size()); }
+		void bind();
+		GLuint getId() const { return mSSBO; }
+		GLuint getBinding() const { return mBinding; }
+		GLsizeiptr getCapacity() const { return mCapacity; }
+	private:
+		StorageBuffer(const StorageBuffer& r) = delete;
+		GLuint mSSBO;
+		GLuint mBinding;
+		GLsizeiptr mCapacity;
+	};
+}
@@ -0,0 +1,78 @@
+#include "TemporalUpscaler.h"
+#include "Camera.h"
+
+namespace ew {
+	const GLuint TEMPORAL_SOURCE_UNIT = 4;
+	const GLuint TEMPORAL_MOTION_UNIT = 5;
+	const GLuint TEMPORAL_DEPTH_UNIT = 6;
+	const GLuint TEMPORAL_HISTORY_UNIT = 7;
+
+	TemporalUpscaler::TemporalUpscaler(std::string vertexShaderPath, std::string fragmentShaderPath)
+		: mShader(vertexShaderPath, fragmentShaderPath)
+	{
+		glCreateVertexArrays(1, &mEmptyVAO);
+	}
+
+	TemporalUpscaler::~TemporalUpscaler()
+	{
+		glDeleteVertexArrays(1, &mEmptyVAO);
+	}
+
+	glm::vec2 TemporalUpscaler::getJitter() const
+	{
+		return Camera::getHaltonJitter(mFrame, JITTER_PHASES);
+	}
+
+	GLuint TemporalUpscaler::beginFrame(RenderTargetPool& pool, int outputWidth, int outputHeight)
+	{
+		if (outputWidth != mWidth || outputHeight != mHeight)
+		{
+			reset(pool);
+			mWidth = outputWidth;
+			mHeight = outputHeight;
+		}
+		mOutput = pool.acquire(outputWidth, outputHeight, GL_RGBA16F);
+		return mOutput;
+	}
+
+	void TemporalUpscaler::resolve(GLuint colorTexture, GLuint motionTexture, GLuint depthTexture, int renderWidth, int renderHeight)
+	{
+		mShader.setVec2("_SourceSize", glm::vec2(renderWidth, renderHeight));
+		mShader.setVec2("_OutputSize", glm::vec2(mWidth, mHeight));
+		mShader.setVec2("_Jitter", getJitter());
+		mShader.setFloat("_BlendFactor", BLEND_FACTOR);
+		mShader.setFloat("_HistoryValid", mHistory != 0 ? 1.0f : 0.0f);
+		mShader.use();
+
+		glBindTextureUnit(TEMPORAL_SOURCE_UNIT, colorTexture);
+		glBindTextureUnit(TEMPORAL_MOTION_UNIT, motionTexture);
+		glBindTextureUnit(TEMPORAL_DEPTH_UNIT, depthTexture);
+		// Unit 7 still needs something bound on the first frame, it's ignored there
+		glBindTextureUnit(TEMPORAL_HISTORY_UNIT, mHistory != 0 ? mHistory : colorTexture);
+		glViewport(0, 0, mWidth, mHeight);
+		glBindVertexArray(mEmptyVAO);
+
+		// In wireframe only the triangle's edges would be drawn
+		GLint polygonMode[2];
+		glGetIntegerv(GL_POLYGON_MODE, polygonMode);
+		glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+		glDrawArrays(GL_TRIANGLES, 0, 3);
+		glPolygonMode(GL_FRONT_AND_BACK, polygonMode[0]);
+	}
+
+	void TemporalUpscaler::endFrame(RenderTargetPool& pool)
+	{
+		pool.release(mHistory);
+		mHistory = mOutput;
+		mOutput = 0;
+		mFrame++;
+	}
+
+	void TemporalUpscaler::reset(RenderTargetPool& pool)
+	{
+		pool.release(mHistory);
+		pool.release(mOutput);
+		mHistory = 0;
+		mOutput = 0;
+	}
+}
@@ -0,0 +1,62 @@
+#pragma once
+#include <GL/glew.h>
+#include "Shader.h"
+#include "RenderTargetPool.h"
+
+namespace ew {
+	/// <summary>
+	/// Temporal upsampling (shaders/temporalResolve.frag). The camera is jittered along a
+	/// Halton sequence, so over a few frames the low resolution samples land on different
+	/// points inside each output pixel. The resolve filters this frame's samples around
+	/// each output pixel, reprojects last frame's result with the scene's motion vectors,
+	/// clamps it to the colors of the current neighborhood so moved or uncovered surfaces
+	/// don't ghost, and blends the two, trusting this frame more where one of its samples
+	/// landed close to the pixel.
+	/// The history is a texture from a RenderTargetPool, held acquired from one frame to the next.
+	/// </summary>
+	class TemporalUpscaler {
+	public:
+		TemporalUpscaler(std::string vertexShaderPath, std::string fragmentShaderPath);
+		~TemporalUpscaler();
+		bool isReady() { return mShader.isReady(); }
+		/// <summary>
+		/// This frame's jitter in render pixels, for Camera::setJitter
+		/// </summary>
+		glm::vec2 getJitter() const;
+		/// <summary>
+		/// Acquires this frame's output from pool and returns it. A history of another
+		/// size is dropped
+		/// </summary>
+		GLuint beginFrame(RenderTargetPool& pool, int outputWidth, int outputHeight);
+		/// <summary>
+		/// Last frame's output, 0 if there is none
+		/// </summary>
+		GLuint getHistory() const { return mHistory; }
+		/// <summary>
+		/// Draws into the bound framebuffer, which holds the output
+		/// </summary>
+		void resolve(GLuint colorTexture, GLuint motionTexture, GLuint depthTexture, int renderWidth, int renderHeight);
+		/// <summary>
+		/// The output becomes next frame's history, the old history goes back to pool
+		/// </summary>
+		void endFrame(RenderTargetPool& pool);
+		/// <summary>
+		/// Gives the history back, for when frames stop being resolved
+		/// </summary>
+		void reset(RenderTargetPool& pool);
+		Shader& getShader() { return mShader; }
+	private:
+		TemporalUpscaler(const TemporalUpscaler& r) = delete;
+		static const int JITTER_PHASES = 8;
+		static constexpr float BLEND_FACTOR = 0.1f;
+
+		Shader mShader;
+		// Core profile draws need one bound, even with no attributes
+		GLuint mEmptyVAO;
+		GLuint mHistory = 0;
+		GLuint mOutput = 0;
+		int mWidth = 0;
+		int mHeight = 0;
+		int mFrame = 0;
+	};
+}
@@ -0,0 +1,38 @@
+#include "UniformBuffer.h"
+
+namespace ew {
+	UniformBuffer::UniformBuffer(GLuint binding, GLsizeiptr blockSize, int numSlots)
+	{
+		GLint alignment = 256;
+		glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+
+		mBinding = binding;
+		mBlockSize = blockSize;
+		mSlotStride = (blockSize + alignment - 1) / alignment * alignment;
+		mNumSlots = numSlots;
+
+		glCreateBuffers(1, &mUBO);
+		glNamedBufferData(mUBO, mSlotStride * numSlots, nullptr, GL_DYNAMIC_DRAW);
+		bind();
+	}
+
+	UniformBuffer::~UniformBuffer()
+	{
+		glDeleteBuffers(1, &mUBO);
+	}
+
+	void UniformBuffer::update(const void* data, GLsizeiptr size, GLintptr offset)
+	{
+		glNamedBufferSubData(mUBO, offset, size, data);
+	}
+
+	void UniformBuffer::bind()
+	{
+		glBindBufferBase(GL_UNIFORM_BUFFER, mBinding, mUBO);
+	}
+
+	void UniformBuffer::bindSlot(int slot)
+	{
+		glBindBufferRange(GL_UNIFORM_BUFFER, mBinding, mUBO, mSlotStride * slot, mBlockSize);
+	}
+}
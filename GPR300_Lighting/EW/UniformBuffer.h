@@ -0,0 +1,35 @@
+#pragma once
+#include <GL/glew.h>
+
+namespace ew {
+	/// <summary>
+	/// Uniform buffer attached to a fixed binding point, matching layout(std140, binding = N)
+	/// in the shaders. It can hold several slots of the same block, each aligned to
+	/// GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, so per-draw data can be uploaded in one call
+	/// and selected with bindSlot.
+	/// </summary>
+	class UniformBuffer {
+	public:
+		UniformBuffer(GLuint binding, GLsizeiptr blockSize, int numSlots = 1);
+		~UniformBuffer();
+		void update(const void* data, GLsizeiptr size, GLintptr offset = 0);
+		template<typename T>
+		void update(const T& block) { update(&block, sizeof(T)); }
+		/// <summary>
+		/// Attaches the whole buffer (slot 0 onwards) to the binding point
+		/// </summary>
+		void bind();
+		void bindSlot(int slot);
+		GLuint getId() const { return mUBO; }
+		GLuint getBinding() const { return mBinding; }
+		GLsizeiptr getSlotStride() const { return mSlotStride; }
+		int getNumSlots() const { return mNumSlots; }
+	private:
+		UniformBuffer(const UniformBuffer& r) = delete;
+		GLuint mUBO;
+		GLuint mBinding;
+		GLsizeiptr mBlockSize;
+		GLsizeiptr mSlotStride;
+		int mNumSlots;
+	};
+}
@@ -0,0 +1,57 @@
+#include "Upscaler.h"
+
+namespace ew {
+	const GLuint UPSCALE_SOURCE_UNIT = 4;
+
+	// Must match the PASS_ defines in upscale.frag
+	const int UPSCALE_PASS_UPSCALE = 0;
+	const int UPSCALE_PASS_SHARPEN = 1;
+
+	Upscaler::Upscaler(std::string vertexShaderPath, std::string fragmentShaderPath)
+		: mVariants(vertexShaderPath, fragmentShaderPath)
+	{
+		mVariants.prewarm({ { { "UPSCALE_PASS", UPSCALE_PASS_UPSCALE } }, { { "UPSCALE_PASS", UPSCALE_PASS_SHARPEN } } });
+		glCreateVertexArrays(1, &mEmptyVAO);
+	}
+
+	Upscaler::~Upscaler()
+	{
+		glDeleteVertexArrays(1, &mEmptyVAO);
+	}
+
+	bool Upscaler::isReady()
+	{
+		return mVariants.get({ { "UPSCALE_PASS", UPSCALE_PASS_UPSCALE } }).isReady()
+			&& mVariants.get({ { "UPSCALE_PASS", UPSCALE_PASS_SHARPEN } }).isReady();
+	}
+
+	void Upscaler::upscale(GLuint sourceTexture, int sourceWidth, int sourceHeight, int outputWidth, int outputHeight)
+	{
+		Shader& shader = mVariants.get({ { "UPSCALE_PASS", UPSCALE_PASS_UPSCALE } });
+		draw(shader, sourceTexture, sourceWidth, sourceHeight, outputWidth, outputHeight);
+	}
+
+	void Upscaler::sharpen(GLuint sourceTexture, int width, int height, float sharpness)
+	{
+		Shader& shader = mVariants.get({ { "UPSCALE_PASS", UPSCALE_PASS_SHARPEN } });
+		shader.setFloat("_Sharpness", sharpness);
+		draw(shader, sourceTexture, width, height, width, height);
+	}
+
+	void Upscaler::draw(Shader& shader, GLuint sourceTexture, int sourceWidth, int sourceHeight, int outputWidth, int outputHeight)
+	{
+		shader.setVec2("_SourceSize", glm::vec2(sourceWidth, sourceHeight));
+		shader.setVec2("_OutputSize", glm::vec2(outputWidth, outputHeight));
+		shader.use();
+		glBindTextureUnit(UPSCALE_SOURCE_UNIT, sourceTexture);
+		glViewport(0, 0, outputWidth, outputHeight);
+		glBindVertexArray(mEmptyVAO);
+
+		// In wireframe only the triangle's edges would be drawn
+		GLint polygonMode[2];
+		glGetIntegerv(GL_POLYGON_MODE, polygonMode);
+		glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+		glDrawArrays(GL_TRIANGLES, 0, 3);
+		glPolygonMode(GL_FRONT_AND_BACK, polygonMode[0]);
+	}
+}
@@ -0,0 +1,38 @@
+#pragma once
+#include <GL/glew.h>
+#include "ShaderVariants.h"
+
+namespace ew {
+	/// <summary>
+	/// Spatial upscaler for scenes rendered below the window size (shaders/upscale.frag).
+	/// upscale filters a 4x4 footprint with a Lanczos-like kernel that is narrowed across
+	/// and stretched along the local luma edge, then clamped to the closest texels so it
+	/// doesn't ring. sharpen is a 5 tap contrast adaptive sharpen at output size, weakened
+	/// wherever it would clip. Both draw a fullscreen triangle into the bound framebuffer.
+	/// </summary>
+	class Upscaler {
+	public:
+		Upscaler(std::string vertexShaderPath, std::string fragmentShaderPath);
+		~Upscaler();
+		/// <summary>
+		/// Both passes have compiled
+		/// </summary>
+		bool isReady();
+		/// <summary>
+		/// Draws source (sourceWidth x sourceHeight) scaled to outputWidth x outputHeight
+		/// </summary>
+		void upscale(GLuint sourceTexture, int sourceWidth, int sourceHeight, int outputWidth, int outputHeight);
+		/// <summary>
+		/// Draws source sharpened, at its size. sharpness from 0 (none) to 1
+		/// </summary>
+		void sharpen(GLuint sourceTexture, int width, int height, float sharpness);
+		ShaderVariants& getVariants() { return mVariants; }
+	private:
+		Upscaler(const Upscaler& r) = delete;
+		void draw(Shader& shader, GLuint sourceTexture, int sourceWidth, int sourceHeight, int outputWidth, int outputHeight);
+
+		ShaderVariants mVariants;
+		// Core profile draws need one bound, even with no attributes
+		GLuint mEmptyVAO;
+	};
+}
@@ -5,10 +5,17 @@
 #include <glm/matrix.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
+#include <glm/gtc/constants.hpp>
 
 #include <stdio.h>
 
 #include <iostream>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+#include <array>
+#include <random>
 
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
@@ -23,6 +30,25 @@
 #include "EW/Mesh.h"
 #include "EW/Transform.h"
 #include "EW/ShapeGen.h"
+#include "EW/MeshCache.h"
+#include "EW/UniformBuffer.h"
+#include "EW/ShaderCompileWorker.h"
+#include "EW/FileWatcher.h"
+#include "EW/ShaderVariants.h"
+#include "EW/GpuTimer.h"
+#include "EW/PostChain.h"
+#include "EW/RenderTargetPool.h"
+#include "EW/FrameGraph.h"
+#include "EW/DynamicResolution.h"
+#include "EW/Upscaler.h"
+#include "EW/TemporalUpscaler.h"
+#include "EW/GpuQuery.h"
+#include "EW/CascadedShadows.h"
+#include "EW/StorageBuffer.h"
+#include "EW/ShadowAtlas.h"
+#include "EW/ShadowMoments.h"
+#include "EW/LightClusters.h"
+#include "EW/AmbientOcclusion.h"
 
 void processInput(GLFWwindow* window);
 void resizeFrameBufferCallback(GLFWwindow* window, int width, int height);
@@ -58,6 +84,38 @@ glm::vec3 lightPosition = glm::vec3(0.0f, 3.0f, 0.0f);
 
 bool wireFrame = false;
 
+/* How the scene reaches the default framebuffer
+* An identity post chain (every effect None) skips the compute chain,
+* either drawing straight to the backbuffer or blitting the offscreen target
+* */
+enum class PostPath
+{
+	ComputeChain,
+	Blit,
+	Direct
+};
+const char* postPathNames[3] = { "Compute chain", "Blit", "Direct to backbuffer" };
+
+// Slots in the post processing UI, applied in order
+const int MAX_POST_EFFECTS = 4;
+
+/* Resolution the scene renders at, as a fraction of the window.
+* Dynamic picks it from the last frames' GPU time (see ew::DynamicResolution)
+* */
+const int NUM_FIXED_RENDER_SCALES = 4;
+const float fixedRenderScales[NUM_FIXED_RENDER_SCALES] = { 1.0f, 0.77f, 0.67f, 0.5f };
+const int RENDER_SCALE_DYNAMIC = NUM_FIXED_RENDER_SCALES;
+const char* renderScaleNames[NUM_FIXED_RENDER_SCALES + 1] = { "Native", "77%", "67%", "50%", "Dynamic" };
+
+// How a scene rendered below the window size is brought up to it
+enum class UpscaleFilter
+{
+	Bilinear,
+	EdgeAdaptive,
+	Temporal
+};
+const char* upscaleFilterNames[3] = { "Bilinear blit", "Edge adaptive + sharpen", "Temporal + sharpen" };
+
 struct Light
 {
 	glm::vec3 position;
@@ -77,6 +135,7 @@ struct PointLight
 	Light light;
 
 	float constK, linearK, quadraticK;
+	float range;
 };
 
 struct SpotLight
@@ -98,10 +157,132 @@ struct Material
 	float shininess = 1; // (1-512 range)
 };
 
+/*
+* std140 mirrors of the uniform blocks in the shaders.
+* A vec3 is 16 byte aligned, so each one is followed by
+* a float (or explicit padding) to fill its last 4 bytes.
+*/
+const GLuint FRAME_UNIFORM_BINDING = 0;
+const GLuint LIGHT_UNIFORM_BINDING = 1;
+const GLuint MATERIAL_UNIFORM_BINDING = 2;
+const GLuint DRAW_UNIFORM_BINDING = 3;
+const GLuint SHADOW_UNIFORM_BINDING = 4;
+// 5 is ShadowCasterDraws' own
+const GLuint CLUSTER_UNIFORM_BINDING = 6;
+// Storage blocks of the lit shader
+const GLuint LOCAL_LIGHT_BINDING = 5;
+const GLuint SHADOW_TILE_BINDING = 6;
+const GLuint CLUSTER_LIGHT_BINDING = 7;
+
+// Room for lights listed in the light clusters, over all of them
+const int MAX_CLUSTER_LIGHT_REFERENCES = 1 << 21;
+
+// Slots for the draws of a pass to start with, doubled whenever a pass needs more
+const int INITIAL_DRAW_UNIFORM_SLOTS = 64;
+
+// Directional light shadow cascades, each this size, sampled by defaultLit.frag at this unit
+const int SHADOW_MAP_SIZE = 2048;
+const GLuint SHADOW_MAP_UNIT = 3;
+// The cascades' prefiltered moments, at half their size, for the EVSM filter
+const GLuint SHADOW_MOMENTS_UNIT = 9;
+
+// Point and spot light shadows share this atlas, sampled at this unit
+const int SHADOW_ATLAS_SIZE = 4096;
+const GLuint SHADOW_ATLAS_UNIT = 8;
+
+// The G-buffer, as the deferred lighting pass of defaultLit.frag samples it
+const GLuint GBUFFER_ALBEDO_UNIT = 10;
+const GLuint GBUFFER_NORMAL_UNIT = 11;
+const GLuint GBUFFER_SURFACE_UNIT = 12;
+const GLuint GBUFFER_VIEW_DEPTH_UNIT = 13;
+// Screen space ambient occlusion, at G-buffer size
+const GLuint AMBIENT_OCCLUSION_UNIT = 14;
+
+// Room in the instance buffer, and in each shadow cascade's caster list
+const int MAX_INSTANCES = 1000000;
+// Local lights only reach a few instances, each atlas tile's caster list is much shorter
+const int MAX_ATLAS_CASTERS = 65536;
+// Half the diagonal of the unit cube drawn at each instance offset
+const float INSTANCE_RADIUS = 0.87f;
+
+struct FrameUniforms
+{
+	glm::mat4 view;
+	glm::mat4 projection;
+	glm::mat4 viewProjection;
+	glm::vec3 cameraPosition;
+	float time;
+	float minBias;
+	float maxBias;
+	float lightBleedReduction;
+	float momentBias;
+	// Without jitter, this frame's and last frame's, for motion vectors
+	glm::mat4 unjitteredViewProjection;
+	glm::mat4 previousViewProjection;
+};
+
+struct LightUniforms
+{
+	glm::vec3 direction;
+	float padding;
+	glm::vec3 color;
+	float intensity;
+	int numLocalLights;
+	int padding2[3];
+};
+
+struct MaterialUniforms
+{
+	glm::vec3 color;
+	float ambientK, diffuseK, specularK;
+	float shininess;
+	float normalIntensity;
+};
+
+struct DrawUniforms
+{
+	glm::mat4 model;
+	glm::mat4 modelViewProjection;
+	// mat3 columns are padded to vec4 in std140, so a mat4 is used on both sides
+	glm::mat4 normalMatrix;
+};
+
+static_assert(sizeof(FrameUniforms) == 352, "FrameUniforms doesn't match the std140 FrameData block");
+static_assert(sizeof(LightUniforms) == 48, "LightUniforms doesn't match the std140 LightData block");
+static_assert(sizeof(MaterialUniforms) == 32, "MaterialUniforms doesn't match the std140 MaterialData block");
+static_assert(sizeof(DrawUniforms) == 192, "DrawUniforms doesn't match the std140 DrawData block");
+
+// std430 mirror of LocalLight in defaultLit.frag, a point light or a spot light
+struct LocalLightData
+{
+	glm::vec3 position;
+	float range;
+	glm::vec3 color;
+	float intensity;
+	glm::vec3 direction;
+	float innerAngle;
+	float outerAngle;
+	float angleFalloff;
+	float constK;
+	float linearK;
+	float quadraticK;
+	int isSpot;
+	int shadowIndex;
+	float padding;
+};
+
+static_assert(sizeof(LocalLightData) == 80, "LocalLightData doesn't match the std430 LocalLight struct");
+
 int numPointLights = 0;
 glm::vec3 pointLightOrbitCenter;
 float pointLightOrbitRange;
 float pointLightOrbitSpeed;
+int numSpotLights = 0;
+
+// Unshadowed lights scattered through the scene, after the point and spot lights
+const int NUM_SCATTERED_LIGHT_COUNTS = 4;
+const int scatteredLightCounts[NUM_SCATTERED_LIGHT_COUNTS] = { 0, 1000, 10000, 100000 };
+const char* scatteredLightCountNames[NUM_SCATTERED_LIGHT_COUNTS] = { "None", "1K", "10K", "100K" };
 
 DirectionalLight _DirectionalLight;
 PointLight _PointLight;
@@ -253,7 +434,8 @@ public:
 
 	~ShadowBuffer()
 	{
-		
+		glDeleteTextures(1, &depthTexture);
+		glDeleteFramebuffers(1, &fbo);
 	}
 
 	unsigned int getFBO() { return fbo; }
@@ -295,12 +477,13 @@ public:
 	* of the given mesh's vertex array. glVertexAttribDivisor
 	* specifies that the fourth attribute should be updated
 	* for every instance that is drawn.
+	* 
+	* Takes ownership of the given mesh.
 	*/
-	InstancedMesh(ew::Transform transform, ew::MeshData data, int totalCount)
+	InstancedMesh(ew::Transform transform, ew::Mesh* instancedMesh, int totalCount)
 	{
 		meshTransform = transform;
-		meshData = data;
-		mesh = new ew::Mesh(&meshData);
+		mesh = instancedMesh;
 		glBindVertexArray(mesh->getVAO());
 
 		instanceCount = 0;
@@ -357,10 +540,18 @@ public:
 	}
 
 	glm::mat4 getModelMatrix() { return meshTransform.getModelMatrix(); }
+	ew::Mesh* getMesh() { return mesh; }
+	unsigned int getInstanceBuffer() { return instancedVBO; }
+	int getInstanceCount() { return instanceCount; }
+
+	/*
+	* Radius around each instance offset holding the
+	* whole mesh, in world units
+	*/
+	float getInstanceRadius() { return INSTANCE_RADIUS * glm::length(glm::vec3(getModelMatrix()[0])); }
 
 private:
 	ew::Transform meshTransform;
-	ew::MeshData meshData;
 	ew::Mesh* mesh;
 	
 	int instanceCount;
@@ -375,62 +566,289 @@ ew::Transform rectangleTransform;
 ew::Transform sphereTransform;
 ew::Transform planeTransform;
 ew::Transform cylinderTransform;
-ew::Transform quadTransform;
 ew::Transform depthQuadTransform;
 ew::Transform lightTransform;
 
-ew::MeshData cubeMeshData;
-ew::MeshData sphereMeshData;
-ew::MeshData rectangleMeshData;
-ew::MeshData planeMeshData;
-ew::MeshData cylinderMeshData;
-ew::MeshData quadMeshData;
-ew::MeshData depthQuadMeshData;
+// Fixed primitives are built at compile time
+constexpr ew::StaticMeshData<24, 36> cubeMeshData = ew::createCubeStatic(1.0f, 1.0f, 1.0f);
+constexpr ew::StaticMeshData<24, 36> rectangleMeshData = ew::createCubeStatic(1.0f, 2.0f, 1.0f);
+constexpr ew::StaticMeshData<4, 6> depthQuadMeshData = ew::createQuadStatic(0.5f, 0.5f);
+
+// Procedural meshes are read from a binary cache
+// Set to false to time startup without it
+const bool USE_MESH_CACHE = true;
+const std::string MESH_CACHE_DIRECTORY = "meshcache/";
+
+// Linked shader programs are cached the same way
+const bool USE_SHADER_CACHE = true;
+const std::string SHADER_CACHE_DIRECTORY = "shadercache/";
 
 ew::Mesh* cubeMesh;
 ew::Mesh* sphereMesh;
 ew::Mesh* rectangleMesh;
 ew::Mesh* planeMesh;
 ew::Mesh* cylinderMesh;
-ew::Mesh* quadMesh;
 ew::Mesh* depthQuadMesh;
 
 InstancedMesh* instanced;
 
-void drawScene(Shader& targetShader, glm::mat4 viewMatrix, glm::mat4 projectionMatrix)
+/*
+* Loads a generated mesh from the mesh cache, keyed by
+* the generator's name and parameters. generate is only
+* run when the cache is missing or out of date.
+*/
+ew::Mesh* loadProceduralMesh(const char* name, std::initializer_list<float> params, const std::function<void(std::vector<ew::MeshData>&)>& generate, int& cacheHits)
 {
-	targetShader.setMat4("_View", viewMatrix);
-	targetShader.setMat4("_Projection", projectionMatrix);
+	if (!USE_MESH_CACHE)
+	{
+		std::vector<ew::MeshData> lods;
+		generate(lods);
+		return new ew::Mesh(&lods[0]);
+	}
 
-	targetShader.setMat4("_Model", cubeTransform.getModelMatrix());
-	cubeMesh->draw();
+	bool cacheHit = false;
+	ew::Mesh* mesh = ew::loadOrBuildMesh(MESH_CACHE_DIRECTORY + name + ".ewmesh", ew::hashMeshParams(name, params), generate, &cacheHit);
+	cacheHits += cacheHit ? 1 : 0;
+	return mesh;
+}
 
-	targetShader.setMat4("_Model", rectangleTransform.getModelMatrix());
-	rectangleMesh->draw();
+/*
+* Per draw uniforms are written into consecutive slots of
+* drawUniformBuffer, uploaded once per pass, then selected
+* with bindSlot before each draw.
+*/
+ew::UniformBuffer* drawUniformBuffer;
+std::vector<unsigned char> drawUniformStaging;
+int numDrawUniforms = 0;
 
-	targetShader.setMat4("_Model", sphereTransform.getModelMatrix());
-	sphereMesh->draw();
+int addDrawUniforms(const glm::mat4& model, const glm::mat4& viewProjection)
+{
+	// Out of slots: a bigger buffer rather than sharing one, which would leave an earlier draw with a later one's data.
+	// Nothing has been uploaded for this pass yet, and draws already issued keep the old buffer alive until they finish
+	if (numDrawUniforms >= drawUniformBuffer->getNumSlots())
+	{
+		int numSlots = drawUniformBuffer->getNumSlots() * 2;
+		printf("Draw uniform slots grown to %d\n", numSlots);
+		delete drawUniformBuffer;
+		drawUniformBuffer = new ew::UniformBuffer(DRAW_UNIFORM_BINDING, sizeof(DrawUniforms), numSlots);
+	}
+
+	GLsizeiptr stride = drawUniformBuffer->getSlotStride();
+	drawUniformStaging.resize(stride * drawUniformBuffer->getNumSlots());
 
-	targetShader.setMat4("_Model", cylinderTransform.getModelMatrix());
-	cylinderMesh->draw();
+	DrawUniforms* draw = (DrawUniforms*)&drawUniformStaging[stride * numDrawUniforms];
+	draw->model = model;
+	draw->modelViewProjection = viewProjection * model;
+	draw->normalMatrix = glm::mat4(glm::transpose(glm::inverse(glm::mat3(model))));
+	return numDrawUniforms++;
+}
 
-	targetShader.setMat4("_Model", planeTransform.getModelMatrix());
-	planeMesh->draw();
+void uploadDrawUniforms()
+{
+	if (numDrawUniforms == 0) { return; }
+	drawUniformBuffer->update(drawUniformStaging.data(), drawUniformBuffer->getSlotStride() * numDrawUniforms);
+}
+
+/*
+* Picks a LOD from how much of the screen the mesh covers.
+* Each LOD halves the segments, so it steps once for
+* every halving of the projected size below LOD_SCREEN_SIZE.
+*/
+const float LOD_SCREEN_SIZE = 0.5f;
+
+uint32_t selectLod(ew::Transform& transform, const glm::mat4& viewMatrix, const glm::mat4& projectionMatrix)
+{
+	// The procedural meshes fit in a unit cube
+	float radius = glm::max(transform.scale.x, glm::max(transform.scale.y, transform.scale.z));
+	// Orthographic projections (the shadow views) don't shrink with distance
+	float depth = 1.0f;
+	if (projectionMatrix[3][3] == 0.0f)
+	{
+		depth = glm::max(-(viewMatrix * glm::vec4(transform.position, 1.0f)).z, 0.001f);
+	}
+	float screenSize = radius * projectionMatrix[1][1] / depth;
+	if (screenSize >= LOD_SCREEN_SIZE) { return 0; }
+	// drawLod clamps to the coarsest LOD the mesh has
+	return (uint32_t)glm::min(glm::log2(LOD_SCREEN_SIZE / glm::max(screenSize, 1e-6f)), 31.0f);
+}
+
+void drawScene(glm::mat4 viewMatrix, glm::mat4 projectionMatrix)
+{
+	glm::mat4 viewProjection = projectionMatrix * viewMatrix;
+
+	ew::Mesh* meshes[] = { cubeMesh, rectangleMesh, sphereMesh, cylinderMesh, planeMesh };
+	ew::Transform* transforms[] = { &cubeTransform, &rectangleTransform, &sphereTransform, &cylinderTransform, &planeTransform };
+
+	numDrawUniforms = 0;
+	int slots[5];
+	for (int i = 0; i < 5; i++) { slots[i] = addDrawUniforms(transforms[i]->getModelMatrix(), viewProjection); }
+	uploadDrawUniforms();
+
+	for (int i = 0; i < 5; i++)
+	{
+		drawUniformBuffer->bindSlot(slots[i]);
+		meshes[i]->drawLod(selectLod(*transforms[i], viewMatrix, projectionMatrix));
+	}
 }
 
 /*
 * Function that draws the scene using
 * the instanced object.
 */
-void drawSceneInstanced(Shader& targetShader, glm::mat4 viewMatrix, glm::mat4 projectionMatrix)
+void drawSceneInstanced(glm::mat4 viewMatrix, glm::mat4 projectionMatrix)
 {
-	targetShader.setMat4("_View", viewMatrix);
-	targetShader.setMat4("_Projection", projectionMatrix);
+	numDrawUniforms = 0;
+	int slot = addDrawUniforms(instanced->getModelMatrix(), projectionMatrix * viewMatrix);
+	uploadDrawUniforms();
 
-	targetShader.setMat4("_Model", instanced->getModelMatrix());
+	drawUniformBuffer->bindSlot(slot);
 	instanced->draw();
 }
 
+/*
+* Times the three ways of setting a uniform: the old
+* per call std::string + glGetUniformLocation, a hashed
+* UniformName and a resolved UniformHandle.
+* Results are in nanoseconds per call.
+*/
+struct UniformBenchmark {
+	double stringLookup = 0;
+	double hashedName = 0;
+	double handle = 0;
+};
+
+// Calls timed per setter
+const int UNIFORM_BENCHMARK_CALLS = 100000;
+
+UniformBenchmark benchmarkUniformSetters(Shader& shader, int iterations)
+{
+	UniformBenchmark result;
+	const GLuint program = shader.getId();
+
+	double start = glfwGetTime();
+	for (int i = 0; i < iterations; i++)
+	{
+		std::string name = "time";
+		glProgramUniform1f(program, glGetUniformLocation(program, name.c_str()), (float)i);
+	}
+	result.stringLookup = (glfwGetTime() - start) * 1e9 / iterations;
+
+	start = glfwGetTime();
+	for (int i = 0; i < iterations; i++)
+	{
+		shader.setFloat("time", (float)i);
+	}
+	result.hashedName = (glfwGetTime() - start) * 1e9 / iterations;
+
+	UniformHandle uniform = shader.getUniform("time");
+	start = glfwGetTime();
+	for (int i = 0; i < iterations; i++)
+	{
+		shader.setFloat(uniform, (float)i);
+	}
+	result.handle = (glfwGetTime() - start) * 1e9 / iterations;
+
+	return result;
+}
+
+/*
+* The passes drawing the lit scene, one when
+* forward shading and up to three when deferred.
+*/
+bool isScenePass(const std::string& name)
+{
+	return name == "Scene" || name == "G-Buffer" || name == "Ambient Occlusion" || name == "Deferred Lighting";
+}
+
+/*
+* Renders a number of frames at each fixed render scale and
+* averages the GPU time of the scene pass and of bringing it
+* to the window size (Temporal Resolve, Upscale, Sharpen or the
+* Present blit).
+* Fed the pass timings once per frame, which lag a few frames,
+* so the first frames after each switch are left out.
+*/
+struct UpscaleBenchmark {
+	static const int WARMUP_FRAMES = 10;
+	static const int MEASURED_FRAMES = 60;
+
+	bool running = false;
+	int scaleIndex = 0;
+	int frame = 0;
+	int numResults = 0;
+	double sceneMilliseconds[NUM_FIXED_RENDER_SCALES] = {};
+	double upscaleMilliseconds[NUM_FIXED_RENDER_SCALES] = {};
+
+	void start()
+	{
+		*this = UpscaleBenchmark();
+		running = true;
+	}
+
+	void addFrame(const std::vector<ew::FrameGraph::PassTiming>& passes)
+	{
+		if (++frame <= WARMUP_FRAMES) { return; }
+		for (const ew::FrameGraph::PassTiming& pass : passes)
+		{
+			if (pass.culled) { continue; }
+			if (isScenePass(pass.name)) { sceneMilliseconds[scaleIndex] += pass.gpuMilliseconds / MEASURED_FRAMES; }
+			if (pass.name == "Temporal Resolve" || pass.name == "Upscale" || pass.name == "Sharpen" || pass.name == "Present") { upscaleMilliseconds[scaleIndex] += pass.gpuMilliseconds / MEASURED_FRAMES; }
+		}
+		if (frame < WARMUP_FRAMES + MEASURED_FRAMES) { return; }
+
+		numResults = ++scaleIndex;
+		frame = 0;
+		running = scaleIndex < NUM_FIXED_RENDER_SCALES;
+	}
+};
+
+/*
+* Renders a number of frames with each count of scattered
+* lights and averages the GPU time of clustering them and of
+* the scene pass, keeping the cluster counts read back last.
+* Fed the pass timings once per frame like UpscaleBenchmark.
+*/
+struct LightBenchmark {
+	static const int WARMUP_FRAMES = 10;
+	static const int MEASURED_FRAMES = 60;
+
+	bool running = false;
+	// Past the first count, no scattered lights
+	int countIndex = 1;
+	int frame = 0;
+	int numResults = 0;
+	double clusterMilliseconds[NUM_SCATTERED_LIGHT_COUNTS] = {};
+	double sceneMilliseconds[NUM_SCATTERED_LIGHT_COUNTS] = {};
+	ew::LightClusters::Stats clusterStats[NUM_SCATTERED_LIGHT_COUNTS] = {};
+
+	void start()
+	{
+		*this = LightBenchmark();
+		running = true;
+	}
+
+	void addFrame(const std::vector<ew::FrameGraph::PassTiming>& passes, const ew::LightClusters::Stats& stats)
+	{
+		if (++frame <= WARMUP_FRAMES) { return; }
+		for (const ew::FrameGraph::PassTiming& pass : passes)
+		{
+			if (pass.culled) { continue; }
+			if (pass.name == "Light Clustering") { clusterMilliseconds[countIndex] += pass.gpuMilliseconds / MEASURED_FRAMES; }
+			if (isScenePass(pass.name)) { sceneMilliseconds[countIndex] += pass.gpuMilliseconds / MEASURED_FRAMES; }
+		}
+		if (frame < WARMUP_FRAMES + MEASURED_FRAMES) { return; }
+
+		clusterStats[countIndex] = stats;
+		numResults = countIndex++;
+		frame = 0;
+		running = countIndex < NUM_SCATTERED_LIGHT_COUNTS;
+	}
+};
+
+// Sphere around every instance, the depth range of the shadow cascades
+glm::vec3 sceneBoundsCenter;
+float sceneBoundsRadius;
+
 /*
 * Updates a given array to assign positions
 * that create a cube in shape.
@@ -439,6 +857,11 @@ void buildScene(glm::vec3 offsets[], int instances)
 {
 	int cubed = cbrt(instances);
 
+	// Offsets span 0 to (cubed - 1) * 10 on each axis, plus the cube's own size
+	float extent = (cubed - 1) * 10.0f;
+	sceneBoundsCenter = glm::vec3(instanced->getModelMatrix() * glm::vec4(glm::vec3(extent * 0.5f), 1.0f));
+	sceneBoundsRadius = glm::length(glm::vec3(extent * 0.5f + 1.0f)) * glm::length(glm::vec3(instanced->getModelMatrix()[0]));
+
 	for (int i = 0; i < cubed; i++)
 	{
 		for (int j = 0; j < cubed; j++)
@@ -452,6 +875,81 @@ void buildScene(glm::vec3 offsets[], int instances)
 	instanced->updateData(offsets, instances);
 }
 
+/*
+* Point lights circle the orbit center, evenly spread, and spot lights
+* stand in a row above it. Both take everything else from _PointLight
+* and _SpotLight. Point lights come first, the shadow atlas knows each
+* light by its index.
+* */
+void buildLocalLights(float time, std::vector<LocalLightData>& localLights)
+{
+	localLights.clear();
+	for (int i = 0; i < numPointLights; i++)
+	{
+		float angle = time * pointLightOrbitSpeed + glm::two_pi<float>() * i / numPointLights;
+		LocalLightData local = {};
+		local.position = pointLightOrbitCenter + pointLightOrbitRange * glm::vec3(glm::cos(angle), 0.0f, glm::sin(angle));
+		local.range = _PointLight.range;
+		local.color = _PointLight.light.color;
+		local.intensity = _PointLight.light.intensity;
+		local.constK = _PointLight.constK;
+		local.linearK = _PointLight.linearK;
+		local.quadraticK = _PointLight.quadraticK;
+		local.shadowIndex = -1;
+		localLights.push_back(local);
+	}
+	for (int i = 0; i < numSpotLights; i++)
+	{
+		LocalLightData local = {};
+		local.position = _SpotLight.position + glm::vec3(i * 20.0f, 0.0f, 0.0f);
+		local.range = _SpotLight.range;
+		local.color = _SpotLight.light.color;
+		local.intensity = _SpotLight.light.intensity;
+		local.direction = glm::normalize(_SpotLight.direction);
+		local.innerAngle = _SpotLight.innerAngle;
+		local.outerAngle = _SpotLight.outerAngle;
+		local.angleFalloff = _SpotLight.angleFalloff;
+		// No distance falloff beyond the range's fade
+		local.constK = 1.0f;
+		local.isSpot = 1;
+		local.shadowIndex = -1;
+		localLights.push_back(local);
+	}
+}
+
+/*
+* Lights at random points of the instanced cube, a quarter of them
+* spot lights pointing down, all with the same range. Seeded, so the
+* same count always gives the same lights.
+* */
+void buildScatteredLights(int count, float range, std::vector<LocalLightData>& scatteredLights)
+{
+	std::mt19937 random(1);
+	std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+	glm::vec3 halfExtent = glm::vec3(sceneBoundsRadius / glm::sqrt(3.0f));
+	scatteredLights.clear();
+	for (int i = 0; i < count; i++)
+	{
+		LocalLightData local = {};
+		local.position = sceneBoundsCenter + (glm::vec3(unit(random), unit(random), unit(random)) * 2.0f - 1.0f) * halfExtent;
+		local.range = range;
+		local.color = glm::vec3(unit(random), unit(random), unit(random)) * 0.8f + 0.2f;
+		local.intensity = 1.0f;
+		local.constK = 1.0f;
+		local.quadraticK = 4.0f / (range * range);
+		local.shadowIndex = -1;
+		if (i % 4 == 3)
+		{
+			local.direction = glm::vec3(0, 1, 0);
+			local.innerAngle = 20.0f;
+			local.outerAngle = 35.0f;
+			local.angleFalloff = 1.0f;
+			local.isSpot = 1;
+		}
+		scatteredLights.push_back(local);
+	}
+}
+
 int main() {
 	if (!glfwInit()) {
 		printf("glfw failed to init");
@@ -481,39 +979,207 @@ int main() {
 
 	ImGui::StyleColorsDark();
 
-	Shader litShader("shaders/defaultLit.vert", "shaders/defaultLit.frag");
+	/*
+	* Shaders compile in the background. Without
+	* GL_KHR_parallel_shader_compile a hidden window
+	* provides a shared context for a compile thread.
+	*/
+	GLFWwindow* compileWindow = nullptr;
+	ew::ShaderCompileWorker* compileWorker = nullptr;
+	if (!GLEW_KHR_parallel_shader_compile)
+	{
+		glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+		compileWindow = glfwCreateWindow(1, 1, "Shader Compiler", 0, window);
+		glfwWindowHint(GLFW_VISIBLE, GLFW_TRUE);
+
+		if (compileWindow != nullptr)
+		{
+			compileWorker = new ew::ShaderCompileWorker(
+				[compileWindow]() { glfwMakeContextCurrent(compileWindow); },
+				[]() { glfwMakeContextCurrent(nullptr); });
+		}
+	}
+
+	Shader::setBinaryCacheDirectory(USE_SHADER_CACHE ? SHADER_CACHE_DIRECTORY : "");
+	double shaderLoadStart = glfwGetTime();
+
+	// Built right away, it stands in for the lit shader until that's ready
 	Shader unlitShader("shaders/defaultLit.vert", "shaders/unlit.frag");
+
+	Shader::setAsyncCompile(true, compileWorker);
 	Shader depthOnly("shaders/depthOnly.vert", "shaders/depthOnly.frag");
-	Shader postProc("shaders/postProcessing.vert", "shaders/postProcessing.frag");
-
-	FrameBuffer screenBuffer = FrameBuffer(1, SCREEN_WIDTH, SCREEN_HEIGHT);
-
-	ew::createCube(1.0f, 1.0f, 1.0f, cubeMeshData);
-	ew::createCube(1.0f, 2.0f, 1.0f, rectangleMeshData);
-	ew::createSphere(0.5f, 64, sphereMeshData);
-	ew::createPlane(1.0f, 1.0f, planeMeshData);
-	ew::createCylinder(1.0f, 0.5f, 64, cylinderMeshData);
-	ew::createQuad(2.0f, 2.0f, quadMeshData);
-	ew::createQuad(0.5f, 0.5f, depthQuadMeshData);
-
-	cubeMesh = new ew::Mesh(&cubeMeshData);
-	rectangleMesh = new ew::Mesh(&rectangleMeshData);
-	sphereMesh = new ew::Mesh(&sphereMeshData);
-	planeMesh = new ew::Mesh(&planeMeshData);
-	cylinderMesh = new ew::Mesh(&cylinderMeshData);
-	quadMesh = new ew::Mesh(&quadMeshData);
-	depthQuadMesh = new ew::Mesh(&depthQuadMeshData);
+	ew::CascadedShadows cascadedShadows("shaders/shadowCull.comp", "shaders/shadowCasters.vert", "shaders/depthOnly.frag", SHADOW_UNIFORM_BINDING, SHADOW_MAP_SIZE, MAX_INSTANCES);
+	bool cacheShadowCascades = true;
+	ew::ShadowAtlas shadowAtlas("shaders/shadowCull.comp", "shaders/shadowCasters.vert", "shaders/depthOnly.frag", SHADOW_TILE_BINDING, SHADOW_ATLAS_SIZE, MAX_ATLAS_CASTERS);
+	ew::ShadowMoments shadowMoments("shaders/shadowMoments.comp", SHADOW_MAP_SIZE, ew::CascadedShadows::NUM_CASCADES);
+	ew::LightClusters lightClusters("shaders/lightClusters.comp", CLUSTER_UNIFORM_BINDING, CLUSTER_LIGHT_BINDING, MAX_CLUSTER_LIGHT_REFERENCES);
+
+	// Features are compiled in (see the #if blocks in the shaders), one program per combination
+	bool useNormalMap = true;
+	bool useShadows = false;
+	int pcfKernel = 3;
+	// 0 PCF, 1 EVSM. The moments trade the PCF taps for a blur of only the cascades that changed
+	int shadowFilter = 0;
+	float lightBleedReduction = 0.3f;
+	float momentBias = 0.05f;
+	// Local lights binned into view frustum cells, each fragment only shades its cell's. Off loops over every light
+	bool clusteredLighting = true;
+	// Surfaces are written to a G-buffer first, then lit once per pixel over the whole screen
+	bool deferredShading = false;
+	ShaderVariants litVariants("shaders/defaultLit.vert", "shaders/defaultLit.frag");
+	litVariants.prewarm({ { { "NORMAL_MAP", 1 }, { "SHADOWS", 0 }, { "PCF_KERNEL", 3 }, { "SHADOW_FILTER", 0 }, { "CLUSTERED_LIGHTS", 1 } } });
+	// The same lighting, reading the G-buffer
+	ShaderVariants deferredVariants("shaders/fullscreen.vert", "shaders/defaultLit.frag");
+	// Darkens the ambient term in creases and between instances. It reads the G-buffer, so it is
+	// deferred only and starts off like deferred shading does; the forward path never darkens
+	bool useAmbientOcclusion = deferredShading;
+	ew::AmbientOcclusion ambientOcclusion("shaders/ambientOcclusion.comp");
+
+	const char* effectNames[ew::NUM_POST_EFFECTS];
+	for (int i = 0; i < ew::NUM_POST_EFFECTS; i++) { effectNames[i] = ew::getPostEffectName(i); }
+	int postEffects[MAX_POST_EFFECTS] = {};
+	bool bypassWithBlit = false;
+
+	// The scene renders at a fraction of the window size, fixed or picked from the last frames' GPU time, then is upscaled
+	int renderScaleMode = 0;
+	float minRenderScale = 0.5f;
+	ew::DynamicResolution dynamicResolution(16.6f, minRenderScale, 1.0f);
+	double gpuFrameMilliseconds = 0.0;
+	int upscaleFilter = (int)UpscaleFilter::EdgeAdaptive;
+	float sharpness = 0.5f;
+	ew::Upscaler upscaler("shaders/fullscreen.vert", "shaders/upscale.frag");
+	ShaderVariants& upscaleVariants = upscaler.getVariants();
+	ew::TemporalUpscaler temporalUpscaler("shaders/fullscreen.vert", "shaders/temporalResolve.frag");
+	// Unjittered, for the scene's motion vectors
+	glm::mat4 previousViewProjection = glm::mat4(1);
+
+	// Depth only draw of the scene first, so the lit pass shades just the visible fragment of each pixel.
+	// Fragment shader invocations are counted per mode, each query only runs while its mode does
+	bool useDepthPrepass = false;
+	std::unique_ptr<ew::GpuQuery> litFragmentQueries[2];
+	std::unique_ptr<ew::GpuQuery> prepassFragmentQuery;
+	if (GLEW_ARB_pipeline_statistics_query)
+	{
+		for (std::unique_ptr<ew::GpuQuery>& query : litFragmentQueries) { query = std::make_unique<ew::GpuQuery>(GL_FRAGMENT_SHADER_INVOCATIONS_ARB); }
+		prepassFragmentQuery = std::make_unique<ew::GpuQuery>(GL_FRAGMENT_SHADER_INVOCATIONS_ARB);
+	}
+	UpscaleBenchmark upscaleBenchmark;
+	LightBenchmark lightBenchmark;
+	ew::PostChain postChain("shaders/postprocessing.comp");
+	ShaderVariants& postVariants = postChain.getVariants();
+	// Each effect on its own is the most likely next chain
+	std::vector<std::vector<int>> singleEffects;
+	for (int i = ew::POST_EFFECT_INVERT; i < ew::NUM_POST_EFFECTS; i++) { singleEffects.push_back({ i }); }
+	postChain.prewarm(singleEffects);
+
+	// Every program outside the variant sets, listed once so the startup count and the reload can't miss one
+	Shader* reloadableShaders[] = { &unlitShader, &depthOnly, &temporalUpscaler.getShader(), &cascadedShadows.getCullShader(), &cascadedShadows.getDrawShader(), &shadowAtlas.getCullShader(), &shadowAtlas.getDrawShader(), &shadowMoments.getMomentsShader(), &shadowMoments.getBlurShader(), &lightClusters.getShader(),
+		&ambientOcclusion.getOcclusionShader(), &ambientOcclusion.getBlurShader(), &ambientOcclusion.getUpsampleShader() };
+	ShaderVariants* reloadableVariants[] = { &litVariants, &deferredVariants, &postVariants, &upscaleVariants };
+
+	// Cold runs compile from source, warm runs load the cached binaries
+	int numShaders = (int)(sizeof(reloadableShaders) / sizeof(reloadableShaders[0]));
+	int shaderCacheHits = 0;
+	for (Shader* shader : reloadableShaders) { shaderCacheHits += shader->isLoadedFromBinaryCache() ? 1 : 0; }
+	for (ShaderVariants* variants : reloadableVariants)
+	{
+		numShaders += (int)variants->getNumVariants();
+		shaderCacheHits += variants->getNumLoadedFromBinaryCache();
+	}
+	printf("Shaders issued in %.3f ms (%d/%d from cache%s, %s)\n", (glfwGetTime() - shaderLoadStart) * 1000.0, shaderCacheHits, numShaders, USE_SHADER_CACHE ? "" : ", disabled",
+		GLEW_KHR_parallel_shader_compile ? "parallel compile" : compileWorker != nullptr ? "compile thread" : "blocking compile");
+	bool shadersReady = false;
+	bool firstFrame = true;
+
+	// Saving a shader source rebuilds every program using it without a restart
+	ew::FileWatcher shaderWatcher;
+	for (Shader* shader : reloadableShaders)
+	{
+		for (const std::string& sourcePath : shader->getSourcePaths()) { shaderWatcher.addFile(sourcePath); }
+	}
+	for (ShaderVariants* variants : reloadableVariants)
+	{
+		for (const std::string& sourcePath : variants->getSourcePaths()) { shaderWatcher.addFile(sourcePath); }
+	}
+
+	// The last variant that finished compiling keeps drawing while a newly selected one compiles.
+	// When deferred, litShader is the lighting pass and geometryShader fills the G-buffer for it
+	Shader* litShader = nullptr;
+	Shader* geometryShader = nullptr;
+
+	// Offscreen targets are taken from here each frame at the current window size
+	ew::RenderTargetPool renderTargets;
+	ew::FrameGraph frameGraph(renderTargets);
+
+	// Outside a shadow cascade reads as the far plane, unshadowed
+	GLuint shadowSampler;
+	glCreateSamplers(1, &shadowSampler);
+	glSamplerParameteri(shadowSampler, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glSamplerParameteri(shadowSampler, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glSamplerParameteri(shadowSampler, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
+	glSamplerParameteri(shadowSampler, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
+	const float shadowBorder[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+	glSamplerParameterfv(shadowSampler, GL_TEXTURE_BORDER_COLOR, shadowBorder);
+	glBindSampler(SHADOW_MAP_UNIT, shadowSampler);
+	glBindSampler(SHADOW_ATLAS_UNIT, shadowSampler);
+
+	// Moments are filtered like any texture. A cascade always covers the fragments reading it, so its edge just repeats
+	GLuint momentsSampler;
+	glCreateSamplers(1, &momentsSampler);
+	glSamplerParameteri(momentsSampler, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	glSamplerParameteri(momentsSampler, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glSamplerParameteri(momentsSampler, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glSamplerParameteri(momentsSampler, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glBindSampler(SHADOW_MOMENTS_UNIT, momentsSampler);
+
+	ew::UniformBuffer frameUniformBuffer(FRAME_UNIFORM_BINDING, sizeof(FrameUniforms));
+	ew::UniformBuffer lightUniformBuffer(LIGHT_UNIFORM_BINDING, sizeof(LightUniforms));
+	ew::UniformBuffer materialUniformBuffer(MATERIAL_UNIFORM_BINDING, sizeof(MaterialUniforms));
+	drawUniformBuffer = new ew::UniformBuffer(DRAW_UNIFORM_BINDING, sizeof(DrawUniforms), INITIAL_DRAW_UNIFORM_SLOTS);
+	ew::StorageBuffer localLightBuffer(LOCAL_LIGHT_BINDING);
+	std::vector<LocalLightData> localLights;
+	std::vector<ew::ShadowAtlas::Light> atlasLights;
+	// Uploaded after localLights, only again when they change or the lights before them do
+	int scatteredLightCountIndex = 0;
+	float scatteredLightRange = 15.0f;
+	bool scatteredLightsChanged = true;
+	int uploadedLocalLights = -1;
+	std::vector<LocalLightData> scatteredLights;
+
+	double meshLoadStart = glfwGetTime();
+	int meshCacheHits = 0;
+
+	// LODs halve the segment count each level
+	sphereMesh = loadProceduralMesh("sphere", { 0.5f, 64 }, [](std::vector<ew::MeshData>& lods) {
+		lods.resize(4);
+		for (int i = 0; i < 4; i++) { ew::createSphere(0.5f, 64 >> i, lods[i]); }
+	}, meshCacheHits);
+	planeMesh = loadProceduralMesh("plane", { 1.0f, 1.0f }, [](std::vector<ew::MeshData>& lods) {
+		lods.resize(1);
+		ew::createPlane(1.0f, 1.0f, lods[0]);
+	}, meshCacheHits);
+	cylinderMesh = loadProceduralMesh("cylinder", { 1.0f, 0.5f, 64 }, [](std::vector<ew::MeshData>& lods) {
+		lods.resize(4);
+		for (int i = 0; i < 4; i++) { ew::createCylinder(1.0f, 0.5f, 64 >> i, lods[i]); }
+	}, meshCacheHits);
+
+	printf("Procedural meshes ready in %.3f ms (%d/3 from cache%s)\n", (glfwGetTime() - meshLoadStart) * 1000.0, meshCacheHits, USE_MESH_CACHE ? "" : ", disabled");
+
+	cubeMesh = new ew::Mesh(cubeMeshData);
+	rectangleMesh = new ew::Mesh(rectangleMeshData);
+	depthQuadMesh = new ew::Mesh(depthQuadMeshData);
 
 	/*
 	* Initialization of instanced rendering
 	*/
 	int instances = 1000000;
-	const int MAX_INSTANCES = 1000000;
 	glm::vec3* instanceOffsets = new glm::vec3[MAX_INSTANCES];
-	instanced = new InstancedMesh(cubeTransform, cubeMeshData, MAX_INSTANCES);
+	instanced = new InstancedMesh(cubeTransform, new ew::Mesh(cubeMeshData), MAX_INSTANCES);
 
 	// Stores a target instance to be updated by the GUI
 	int targetInstance = 0;
+	// Edited here and only written to instanceOffsets on update, which still holds where it was
+	glm::vec3 targetOffset = glm::vec3(0);
 
 	glEnable(GL_CULL_FACE);
 	glCullFace(GL_BACK);
@@ -524,7 +1190,6 @@ int main() {
 	glEnable(GL_DEPTH_TEST);
 	glDepthFunc(GL_LESS);
 
-	quadTransform.position = glm::vec3(0.0f, 0.0f, 0.0f);
 	depthQuadTransform.position = glm::vec3(0.5f, 0.5f, 0.0f);
 
 	cubeTransform.position = glm::vec3(-2.0f, 0.0f, 0.0f);
@@ -549,30 +1214,55 @@ int main() {
 	_DirectionalLight.light.intensity = 0.5f;
 	_DirectionalLight.light.color = glm::vec3(1, 1, 1);
 
+	numPointLights = 4;
+	pointLightOrbitCenter = glm::vec3(25, 25, 25);
+	pointLightOrbitRange = 12.0f;
+	pointLightOrbitSpeed = 0.5f;
+	_PointLight.light.color = glm::vec3(1.0f, 0.8f, 0.6f);
+	_PointLight.light.intensity = 1.0f;
+	_PointLight.constK = 1.0f;
+	_PointLight.linearK = 0.0f;
+	_PointLight.quadraticK = 0.1f;
+	_PointLight.range = 25.0f;
+
+	numSpotLights = 2;
+	_SpotLight.position = glm::vec3(15, 38, 25);
+	_SpotLight.direction = glm::vec3(0, 1, 0.3f);
+	_SpotLight.light.color = glm::vec3(0.6f, 0.8f, 1.0f);
+	_SpotLight.light.intensity = 1.0f;
+	_SpotLight.range = 45.0f;
+	_SpotLight.innerAngle = 20.0f;
+	_SpotLight.outerAngle = 30.0f;
+	_SpotLight.angleFalloff = 1.0f;
+
 	float minBias = 0.000f;
 	float maxBias = 0.001f;
 	bool showShadowMap = false;
 
-	const char* effectNames[5] = { "None", "Invert", "Red Overlay", "Zooming Out", "Wave"};
-	int effectIndex = 0;
+	UniformBenchmark uniformBenchmark;
 
 	GLuint brickTexture = getTexture("Bricks.jpg");
 	GLuint tileTexture = getTexture("Tiles.jpg");
 	GLuint brickNormal = getTexture("BricksNormal.jpg");
 
+	// Units match the layout(binding) of the samplers in defaultLit.frag
 	glActiveTexture(GL_TEXTURE0);
 	glBindTexture(GL_TEXTURE_2D, brickTexture);
-	litShader.setInt("_Texture1", 0);
 
 	glActiveTexture(GL_TEXTURE1);
 	glBindTexture(GL_TEXTURE_2D, tileTexture);
-	litShader.setInt("_Texture2", 1);
 
 	glActiveTexture(GL_TEXTURE2);
 	glBindTexture(GL_TEXTURE_2D, brickNormal);
-	litShader.setInt("_Normal", 2);
 
 	buildScene(instanceOffsets, instances);
+	targetOffset = instanceOffsets[targetInstance];
+
+	// Variant keys, only rebuilt when one of the settings that selects them changes
+	ShaderDefines lightingDefines;
+	ShaderDefines geometryDefines;
+	std::array<int, 7> lightingSettings;
+	lightingSettings.fill(-1);
 
 	while (!glfwWindowShouldClose(window)) {
 
@@ -587,53 +1277,529 @@ int main() {
 		deltaTime = time - lastFrameTime;
 		lastFrameTime = time;
 
-		glViewport(0, 0, SCREEN_WIDTH, SCREEN_HEIGHT);
-		glBindFramebuffer(GL_FRAMEBUFFER, screenBuffer.getFBO());
-
-		glEnable(GL_DEPTH_TEST);
-
-		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
-		litShader.use();
-
-		litShader.setFloat("time", time);
+		// Rebuilt programs are swapped in here, at the frame boundary, by isReady
+		for (const std::string& changedFile : shaderWatcher.poll())
+		{
+			for (Shader* shader : reloadableShaders)
+			{
+				if (shader->usesFile(changedFile)) { shader->reload(); }
+			}
+			for (ShaderVariants* variants : reloadableVariants)
+			{
+				if (variants->usesFile(changedFile)) { variants->reload(); }
+			}
+		}
+		for (Shader* shader : reloadableShaders) { shader->isReady(); }
+		for (ShaderVariants* variants : reloadableVariants) { variants->update(); }
+
+		// Loops over every light until the clustering shader has compiled. The benchmark only measures the clusters
+		bool clusterLights = (clusteredLighting || lightBenchmark.running) && lightClusters.isReady();
+		bool occludeAmbient = useAmbientOcclusion && ambientOcclusion.isReady();
+		std::array<int, 7> settings = { useShadows, pcfKernel, shadowFilter, clusterLights, deferredShading, useNormalMap, occludeAmbient };
+		if (settings != lightingSettings)
+		{
+			lightingSettings = settings;
+			// Without shadows the filter defines compile to nothing, so they are pinned to one value
+			// rather than making identical variants. The moments only replace PCF on the cascades,
+			// the atlas still takes the kernel
+			lightingDefines = { { "SHADOWS", useShadows ? 1 : 0 }, { "PCF_KERNEL", useShadows ? pcfKernel : 3 },
+				{ "SHADOW_FILTER", useShadows ? shadowFilter : 0 }, { "CLUSTERED_LIGHTS", clusterLights ? 1 : 0 } };
+			if (deferredShading)
+			{
+				geometryDefines = { { "NORMAL_MAP", useNormalMap ? 1 : 0 }, { "DEFERRED_PASS", 1 } };
+				lightingDefines["DEFERRED_PASS"] = 2;
+				lightingDefines["AMBIENT_OCCLUSION"] = occludeAmbient ? 1 : 0;
+			}
+			else
+			{
+				lightingDefines["NORMAL_MAP"] = useNormalMap ? 1 : 0;
+			}
+		}
+		if (deferredShading)
+		{
+			// Switched to once both halves are ready
+			Shader& requestedGeometry = litVariants.get(geometryDefines);
+			Shader& requestedLighting = deferredVariants.get(lightingDefines);
+			if (requestedGeometry.isReady() && requestedLighting.isReady())
+			{
+				litShader = &requestedLighting;
+				geometryShader = &requestedGeometry;
+			}
+		}
+		else
+		{
+			Shader& requestedLit = litVariants.get(lightingDefines);
+			if (requestedLit.isReady())
+			{
+				litShader = &requestedLit;
+				geometryShader = nullptr;
+			}
+		}
+		postChain.setEffects(std::vector<int>(postEffects, postEffects + MAX_POST_EFFECTS));
+		postChain.update();
 
-		litShader.setVec3("_DirectionalLight.direction", _DirectionalLight.direction);
-		litShader.setFloat("_DirectionalLight.light.intensity", _DirectionalLight.light.intensity);
-		litShader.setVec3("_DirectionalLight.light.color", _DirectionalLight.light.color);
+		// Until the lit shader has compiled the scene is drawn unlit
+		if (!shadersReady && litShader != nullptr)
+		{
+			shadersReady = true;
+			printf("All shaders ready after %.3f ms\n", (glfwGetTime() - shaderLoadStart) * 1000.0);
+		}
 
-		litShader.setVec3("_Material.color", _Material.color);
-		litShader.setFloat("_Material.ambientK", _Material.ambientK);
-		litShader.setFloat("_Material.diffuseK", _Material.diffuseK);
-		litShader.setFloat("_Material.specularK", _Material.specularK);
-		litShader.setFloat("_Material.shininess", _Material.shininess);
+		// The benchmark steps through the fixed scales itself
+		int renderScaleIndex = upscaleBenchmark.running ? upscaleBenchmark.scaleIndex : renderScaleMode;
+		float renderScale = renderScaleIndex == RENDER_SCALE_DYNAMIC ? dynamicResolution.getScale() : fixedRenderScales[renderScaleIndex];
+		int renderWidth = ew::DynamicResolution::getScaledSize(SCREEN_WIDTH, renderScale);
+		int renderHeight = ew::DynamicResolution::getScaledSize(SCREEN_HEIGHT, renderScale);
+		bool upscaling = renderWidth != SCREEN_WIDTH || renderHeight != SCREEN_HEIGHT;
+		// Blits until the upscaler's shaders have compiled. Temporal also runs at native scale, as anti-aliasing
+		bool temporalUpscale = upscaleFilter == (int)UpscaleFilter::Temporal && temporalUpscaler.isReady();
+		bool edgeAdaptiveUpscale = upscaling && upscaleFilter == (int)UpscaleFilter::EdgeAdaptive && upscaler.isReady();
+		// After a temporal resolve everything is at window size, effects included so they don't get accumulated
+		int postWidth = temporalUpscale ? SCREEN_WIDTH : renderWidth;
+		int postHeight = temporalUpscale ? SCREEN_HEIGHT : renderHeight;
+
+		// Decided from the chain actually run, which lags the selection while it compiles.
+		// Below native resolution the scene can't go straight to the backbuffer, it has to be upscaled
+		PostPath postPath = PostPath::ComputeChain;
+		if (postChain.isIdentity())
+		{
+			postPath = bypassWithBlit || upscaling || temporalUpscale ? PostPath::Blit : PostPath::Direct;
+		}
 
-		litShader.setVec3("_CameraPosition", camera.getPosition());
-		
-		litShader.setFloat("_MinBias", minBias);
-		litShader.setFloat("_MaxBias", maxBias);
+		camera.setJitter(temporalUpscale ? temporalUpscaler.getJitter() : glm::vec2(0), glm::vec2(renderWidth, renderHeight));
+		FrameUniforms frameUniforms = {};
+		frameUniforms.view = camera.getViewMatrix();
+		frameUniforms.projection = camera.getProjectionMatrix();
+		frameUniforms.viewProjection = frameUniforms.projection * frameUniforms.view;
+		frameUniforms.unjitteredViewProjection = camera.getUnjitteredProjectionMatrix() * frameUniforms.view;
+		frameUniforms.previousViewProjection = firstFrame ? frameUniforms.unjitteredViewProjection : previousViewProjection;
+		previousViewProjection = frameUniforms.unjitteredViewProjection;
+		frameUniforms.cameraPosition = camera.getPosition();
+		frameUniforms.time = time;
+		frameUniforms.minBias = minBias;
+		frameUniforms.maxBias = maxBias;
+		frameUniforms.lightBleedReduction = lightBleedReduction;
+		frameUniforms.momentBias = momentBias;
+		frameUniformBuffer.update(frameUniforms);
+
+		// Cascades are only rendered again where they moved or had casters change
+		cascadedShadows.setCachingEnabled(cacheShadowCascades);
+		cascadedShadows.update(camera, _DirectionalLight.direction, sceneBoundsCenter, sceneBoundsRadius);
+
+		// The atlas keeps the tiles of lights that didn't move and renders a budget of the rest
+		buildLocalLights(time, localLights);
+		atlasLights.clear();
+		for (const LocalLightData& local : localLights)
+		{
+			// The shader's spot direction points back at the light
+			atlasLights.push_back({ local.position, -local.direction, local.outerAngle, local.range, local.isSpot != 0 });
+		}
+		shadowAtlas.update(atlasLights, camera, renderHeight);
+		for (int i = 0; i < (int)localLights.size(); i++) { localLights[i].shadowIndex = shadowAtlas.getShadowIndex(i); }
 
-		glCullFace(GL_BACK);
+		// The benchmark steps through the counts itself
+		int scatteredCount = scatteredLightCounts[lightBenchmark.running ? lightBenchmark.countIndex : scatteredLightCountIndex];
+		if (scatteredLightsChanged || (int)scatteredLights.size() != scatteredCount)
+		{
+			buildScatteredLights(scatteredCount, scatteredLightRange, scatteredLights);
+			scatteredLightsChanged = false;
+			uploadedLocalLights = -1;
+		}
+		// Growing the buffer drops its contents, the scattered lights go first so the animated ones always fit after
+		if (uploadedLocalLights != (int)localLights.size())
+		{
+			localLightBuffer.update(scatteredLights.data(), sizeof(LocalLightData) * scatteredLights.size(), sizeof(LocalLightData) * localLights.size());
+			uploadedLocalLights = (int)localLights.size();
+		}
+		localLightBuffer.update(localLights);
+		int numLocalLights = (int)(localLights.size() + scatteredLights.size());
+
+		LightUniforms lightUniforms = {};
+		lightUniforms.direction = _DirectionalLight.direction;
+		lightUniforms.color = _DirectionalLight.light.color;
+		lightUniforms.intensity = _DirectionalLight.light.intensity;
+		lightUniforms.numLocalLights = numLocalLights;
+		lightUniformBuffer.update(lightUniforms);
+
+		MaterialUniforms materialUniforms = {};
+		materialUniforms.color = _Material.color;
+		materialUniforms.ambientK = _Material.ambientK;
+		materialUniforms.diffuseK = _Material.diffuseK;
+		materialUniforms.specularK = _Material.specularK;
+		materialUniforms.shininess = _Material.shininess;
+		materialUniformBuffer.update(materialUniforms);
+
+		/* The frame is declared as passes here and run by frameGraph.execute() once the UI is built.
+		* Passes nothing depends on are skipped. The shadow cascades and atlas
+		* persist between frames, so their passes are only added when the lit
+		* variant in use samples them and something in them needs rendering.
+		* */
+		Shader& sceneShader = litShader != nullptr ? *litShader : unlitShader;
+		bool sceneUsesShadows = litShader != nullptr && litShader->getDefines().at("SHADOWS") != 0;
+		bool sceneUsesMoments = sceneUsesShadows && litShader->getDefines().at("SHADOW_FILTER") == 1;
+		bool sceneUsesClusters = litShader != nullptr && litShader->getDefines().at("CLUSTERED_LIGHTS") != 0;
+		bool deferred = geometryShader != nullptr;
+		bool sceneUsesOcclusion = deferred && litShader->getDefines().at("AMBIENT_OCCLUSION") != 0;
+		// The deferred lighting pass reads the depth, so it can't stay in the backbuffer
+		bool depthInBackbuffer = postPath == PostPath::Direct && !deferred;
+		ew::FrameGraphResource backbuffer = frameGraph.importBackbuffer();
+		ew::FrameGraphResource shadowMomentsMap = frameGraph.importTexture("Shadow Moments", shadowMoments.getTexture());
+		ew::FrameGraphResource shadowDraws, shadowCasters, atlasDraws, atlasCasters, sceneColor, sceneMotion, sceneDepth, resolvedColor, postColor, upscaledColor;
+		ew::FrameGraphResource gBufferAlbedo, gBufferNormal, gBufferSurface, gBufferViewDepth, occlusion;
+		ew::FrameGraphResource shadowMap = frameGraph.importTexture("Shadow Cascades", cascadedShadows.getTexture());
+		ew::FrameGraphResource shadowAtlasMap = frameGraph.importTexture("Shadow Atlas", shadowAtlas.getTexture());
+		ew::FrameGraphResource lightClusterLists = frameGraph.importBuffer("Light Clusters", lightClusters.getClusterBuffer());
+
+		// Cascades rendered this frame, their moments are rebuilt from the new depth
+		GLuint renderedCascades = 0;
+		if (sceneUsesShadows && cascadedShadows.isReady() && cascadedShadows.needsRender())
+		{
+			renderedCascades = cascadedShadows.getDirtyMask();
+			shadowDraws = frameGraph.importBuffer("Shadow Draws", cascadedShadows.getDrawBuffer());
+			shadowCasters = frameGraph.importBuffer("Shadow Casters", cascadedShadows.getCasterBuffer());
+			frameGraph.addPass("Shadow Culling",
+				[&](ew::FrameGraph::Builder& builder) {
+					builder.write(shadowDraws, ew::FrameGraphAccess::Storage);
+					builder.write(shadowCasters, ew::FrameGraphAccess::Storage);
+				},
+				[&](const ew::FrameGraph&) {
+					cascadedShadows.cull(*instanced->getMesh(), instanced->getInstanceBuffer(), instanced->getInstanceCount(), instanced->getModelMatrix(), instanced->getInstanceRadius());
+				});
+
+			frameGraph.addPass("Shadows",
+				[&](ew::FrameGraph::Builder& builder) {
+					builder.read(shadowDraws, ew::FrameGraphAccess::Indirect);
+					builder.read(shadowCasters, ew::FrameGraphAccess::Storage);
+					builder.write(shadowMap);
+				},
+				[&](const ew::FrameGraph&) {
+					glCullFace(GL_BACK);
+					cascadedShadows.render(*instanced->getMesh(), instanced->getInstanceBuffer(), instanced->getModelMatrix());
+				});
+		}
 
-		drawSceneInstanced(litShader, camera.getViewMatrix(), camera.getProjectionMatrix());
+		// Moments of cascades rendered while they aren't read are left stale, and rebuilt when they next are
+		if (sceneUsesMoments && shadowMoments.isReady() && (renderedCascades | shadowMoments.getStaleMask()) != 0)
+		{
+			frameGraph.addPass("Shadow Filter",
+				[&](ew::FrameGraph::Builder& builder) {
+					builder.read(shadowMap);
+					builder.write(shadowMomentsMap, ew::FrameGraphAccess::Storage);
+				},
+				[&](const ew::FrameGraph& graph) {
+					shadowMoments.filter(graph.getTexture(shadowMap), renderedCascades);
+				});
+		}
+		else { shadowMoments.invalidate(renderedCascades); }
 
-		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+		if (sceneUsesShadows && shadowAtlas.isReady() && shadowAtlas.needsRender())
+		{
+			atlasDraws = frameGraph.importBuffer("Shadow Atlas Draws", shadowAtlas.getDrawBuffer());
+			atlasCasters = frameGraph.importBuffer("Shadow Atlas Casters", shadowAtlas.getCasterBuffer());
+			frameGraph.addPass("Shadow Atlas Culling",
+				[&](ew::FrameGraph::Builder& builder) {
+					builder.write(atlasDraws, ew::FrameGraphAccess::Storage);
+					builder.write(atlasCasters, ew::FrameGraphAccess::Storage);
+				},
+				[&](const ew::FrameGraph&) {
+					shadowAtlas.cull(*instanced->getMesh(), instanced->getInstanceBuffer(), instanced->getInstanceCount(), instanced->getModelMatrix(), instanced->getInstanceRadius());
+				});
+
+			frameGraph.addPass("Shadow Atlas",
+				[&](ew::FrameGraph::Builder& builder) {
+					builder.read(atlasDraws, ew::FrameGraphAccess::Indirect);
+					builder.read(atlasCasters, ew::FrameGraphAccess::Storage);
+					builder.write(shadowAtlasMap);
+				},
+				[&](const ew::FrameGraph&) {
+					glCullFace(GL_BACK);
+					shadowAtlas.render(*instanced->getMesh(), instanced->getInstanceBuffer(), instanced->getModelMatrix());
+				});
+		}
 
-		glDisable(GL_DEPTH_TEST);
+		// Binned again every frame, for where the camera and the lights are now
+		if (sceneUsesClusters)
+		{
+			frameGraph.addPass("Light Clustering",
+				[&](ew::FrameGraph::Builder& builder) {
+					builder.write(lightClusterLists, ew::FrameGraphAccess::Storage);
+				},
+				[&](const ew::FrameGraph&) {
+					lightClusters.build(camera, renderWidth, renderHeight, localLightBuffer, numLocalLights);
+				});
+		}
 
-		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+		// The lit pass then only passes the depth test (GL_EQUAL) on the nearest surface, with depth writes off
+		bool depthPrepass = useDepthPrepass && depthOnly.isReady();
+		if (depthPrepass)
+		{
+			frameGraph.addPass("Depth Prepass",
+				[&](ew::FrameGraph::Builder& builder) {
+					if (depthInBackbuffer)
+					{
+						builder.write(backbuffer);
+						return;
+					}
+					sceneDepth = builder.createTexture("Scene Depth", renderWidth, renderHeight, GL_DEPTH_COMPONENT32F);
+				},
+				[&](const ew::FrameGraph& graph) {
+					glBindFramebuffer(GL_FRAMEBUFFER, depthInBackbuffer ? 0 : graph.getFramebuffer(ew::FrameGraphResource(), sceneDepth));
+					glViewport(0, 0, renderWidth, renderHeight);
+					glEnable(GL_DEPTH_TEST);
+					glClear(GL_DEPTH_BUFFER_BIT);
+					// The backbuffer has color too, which depthOnly.frag doesn't write
+					glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+
+					depthOnly.use();
+					glCullFace(GL_BACK);
+					if (prepassFragmentQuery) { prepassFragmentQuery->begin(); }
+					drawSceneInstanced(frameUniforms.view, frameUniforms.projection);
+					if (prepassFragmentQuery) { prepassFragmentQuery->end(); }
+					glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+				});
+		}
 
-		postProc.use();
+		if (!deferred)
+		{
+			frameGraph.addPass("Scene",
+				[&](ew::FrameGraph::Builder& builder) {
+					if (sceneUsesShadows)
+					{
+						builder.read(sceneUsesMoments ? shadowMomentsMap : shadowMap);
+						builder.read(shadowAtlasMap);
+					}
+					if (sceneUsesClusters) { builder.read(lightClusterLists, ew::FrameGraphAccess::Storage); }
+					if (postPath == PostPath::Direct)
+					{
+						builder.write(backbuffer);
+						return;
+					}
+					sceneColor = builder.createTexture("Scene Color", renderWidth, renderHeight, GL_RGBA8);
+					if (temporalUpscale) { sceneMotion = builder.createTexture("Scene Motion", renderWidth, renderHeight, GL_RG16F); }
+					if (depthPrepass) { builder.read(sceneDepth, ew::FrameGraphAccess::Attachment); }
+					else { sceneDepth = builder.createTexture("Scene Depth", renderWidth, renderHeight, GL_DEPTH_COMPONENT32F); }
+				},
+				[&](const ew::FrameGraph& graph) {
+					if (postPath == PostPath::Direct) { glBindFramebuffer(GL_FRAMEBUFFER, 0); }
+					else if (temporalUpscale) { glBindFramebuffer(GL_FRAMEBUFFER, graph.getFramebuffer({ sceneColor, sceneMotion }, sceneDepth)); }
+					else { glBindFramebuffer(GL_FRAMEBUFFER, graph.getFramebuffer(sceneColor, sceneDepth)); }
+					glViewport(0, 0, renderWidth, renderHeight);
+					glEnable(GL_DEPTH_TEST);
+					glClear(depthPrepass ? GL_COLOR_BUFFER_BIT : GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+					// The background doesn't move
+					const GLfloat noMotion[4] = {};
+					if (temporalUpscale) { glClearBufferfv(GL_COLOR, 1, noMotion); }
+					if (depthPrepass)
+					{
+						glDepthFunc(GL_EQUAL);
+						glDepthMask(GL_FALSE);
+					}
+
+					glBindTextureUnit(SHADOW_MAP_UNIT, graph.getTexture(shadowMap));
+					glBindTextureUnit(SHADOW_MOMENTS_UNIT, graph.getTexture(shadowMomentsMap));
+					glBindTextureUnit(SHADOW_ATLAS_UNIT, graph.getTexture(shadowAtlasMap));
+					localLightBuffer.bind();
+					lightClusters.bind();
+
+					sceneShader.use();
+					unlitShader.setVec3("_Color", glm::vec3(0.5f));
+					glCullFace(GL_BACK);
+					ew::GpuQuery* fragmentQuery = litFragmentQueries[depthPrepass ? 1 : 0].get();
+					if (fragmentQuery) { fragmentQuery->begin(); }
+					drawSceneInstanced(frameUniforms.view, frameUniforms.projection);
+					if (fragmentQuery) { fragmentQuery->end(); }
+
+					glDepthFunc(GL_LESS);
+					glDepthMask(GL_TRUE);
+				});
+		}
+		else
+		{
+			/* Deferred shading.
+			* The G-buffer pass only writes each surface's albedo, normal and
+			* material factors and its linear depth (24 bytes a pixel with the
+			* depth buffer), the lighting pass then runs the forward shader's
+			* lighting once per covered pixel, taking the local lights from
+			* the light clusters' cells.
+			* */
+			frameGraph.addPass("G-Buffer",
+				[&](ew::FrameGraph::Builder& builder) {
+					gBufferAlbedo = builder.createTexture("G-Buffer Albedo", renderWidth, renderHeight, GL_RGBA8);
+					// Octahedral shading and geometric normals
+					gBufferNormal = builder.createTexture("G-Buffer Normal", renderWidth, renderHeight, GL_RGBA16);
+					// Ambient, diffuse, specular and log2 shininess
+					gBufferSurface = builder.createTexture("G-Buffer Surface", renderWidth, renderHeight, GL_RGBA8);
+					// Not read back from the depth attachment: with the camera's 0.001 near plane nearly all of
+					// its precision is spent close to the eye, and positions rebuilt from it were visibly off
+					// across most of the scene. The linear copy costs 4 bytes a pixel
+					gBufferViewDepth = builder.createTexture("G-Buffer View Depth", renderWidth, renderHeight, GL_R32F);
+					if (temporalUpscale) { sceneMotion = builder.createTexture("Scene Motion", renderWidth, renderHeight, GL_RG16F); }
+					if (depthPrepass) { builder.read(sceneDepth, ew::FrameGraphAccess::Attachment); }
+					else { sceneDepth = builder.createTexture("Scene Depth", renderWidth, renderHeight, GL_DEPTH_COMPONENT32F); }
+				},
+				[&](const ew::FrameGraph& graph) {
+					std::vector<ew::FrameGraphResource> attachments = { gBufferAlbedo, gBufferNormal, gBufferSurface, gBufferViewDepth };
+					if (temporalUpscale) { attachments.push_back(sceneMotion); }
+					glBindFramebuffer(GL_FRAMEBUFFER, graph.getFramebuffer(attachments, sceneDepth));
+					glViewport(0, 0, renderWidth, renderHeight);
+					glEnable(GL_DEPTH_TEST);
+					if (!depthPrepass) { glClear(GL_DEPTH_BUFFER_BIT); }
+					// The lighting pass skips pixels left at zero depth, so the rest needn't be cleared
+					const GLfloat zero[4] = {};
+					glClearBufferfv(GL_COLOR, 3, zero);
+					if (temporalUpscale) { glClearBufferfv(GL_COLOR, 4, zero); }
+					if (depthPrepass)
+					{
+						glDepthFunc(GL_EQUAL);
+						glDepthMask(GL_FALSE);
+					}
+					// Albedo's alpha would blend the normals and factors too
+					glDisable(GL_BLEND);
+
+					geometryShader->use();
+					glCullFace(GL_BACK);
+					ew::GpuQuery* fragmentQuery = litFragmentQueries[depthPrepass ? 1 : 0].get();
+					if (fragmentQuery) { fragmentQuery->begin(); }
+					drawSceneInstanced(frameUniforms.view, frameUniforms.projection);
+					if (fragmentQuery) { fragmentQuery->end(); }
+
+					glEnable(GL_BLEND);
+					glDepthFunc(GL_LESS);
+					glDepthMask(GL_TRUE);
+				});
+
+			// Half resolution, blurred and upsampled to the G-buffer's size
+			if (sceneUsesOcclusion)
+			{
+				frameGraph.addPass("Ambient Occlusion",
+					[&](ew::FrameGraph::Builder& builder) {
+						builder.read(gBufferNormal);
+						builder.read(gBufferViewDepth);
+						occlusion = builder.createTexture("Ambient Occlusion", renderWidth, renderHeight, GL_R8);
+						builder.write(occlusion, ew::FrameGraphAccess::Storage);
+					},
+					[&](const ew::FrameGraph& graph) {
+						ambientOcclusion.compute(renderTargets, graph.getTexture(gBufferViewDepth), graph.getTexture(gBufferNormal), renderWidth, renderHeight,
+							frameUniforms.view, frameUniforms.projection, graph.getTexture(occlusion));
+					});
+			}
 
-		glActiveTexture(GL_TEXTURE4);
-		glBindTexture(GL_TEXTURE_2D, screenBuffer.getTexture(0));
-		postProc.setInt("_Texture1", 4);
+			frameGraph.addPass("Deferred Lighting",
+				[&](ew::FrameGraph::Builder& builder) {
+					builder.read(gBufferAlbedo);
+					builder.read(gBufferNormal);
+					builder.read(gBufferSurface);
+					builder.read(gBufferViewDepth);
+					if (sceneUsesOcclusion) { builder.read(occlusion); }
+					if (sceneUsesShadows)
+					{
+						builder.read(sceneUsesMoments ? shadowMomentsMap : shadowMap);
+						builder.read(shadowAtlasMap);
+					}
+					if (sceneUsesClusters) { builder.read(lightClusterLists, ew::FrameGraphAccess::Storage); }
+					if (postPath == PostPath::Direct) { builder.write(backbuffer); }
+					else { sceneColor = builder.createTexture("Scene Color", renderWidth, renderHeight, GL_RGBA8); }
+				},
+				[&](const ew::FrameGraph& graph) {
+					glBindFramebuffer(GL_FRAMEBUFFER, graph.getFramebuffer(sceneColor));
+					glViewport(0, 0, renderWidth, renderHeight);
+					glDisable(GL_DEPTH_TEST);
+					glClear(GL_COLOR_BUFFER_BIT);
+
+					glBindTextureUnit(GBUFFER_ALBEDO_UNIT, graph.getTexture(gBufferAlbedo));
+					glBindTextureUnit(GBUFFER_NORMAL_UNIT, graph.getTexture(gBufferNormal));
+					glBindTextureUnit(GBUFFER_SURFACE_UNIT, graph.getTexture(gBufferSurface));
+					glBindTextureUnit(GBUFFER_VIEW_DEPTH_UNIT, graph.getTexture(gBufferViewDepth));
+					glBindTextureUnit(AMBIENT_OCCLUSION_UNIT, graph.getTexture(occlusion));
+					glBindTextureUnit(SHADOW_MAP_UNIT, graph.getTexture(shadowMap));
+					glBindTextureUnit(SHADOW_MOMENTS_UNIT, graph.getTexture(shadowMomentsMap));
+					glBindTextureUnit(SHADOW_ATLAS_UNIT, graph.getTexture(shadowAtlasMap));
+					localLightBuffer.bind();
+					lightClusters.bind();
+
+					litShader->use();
+					glDrawArrays(GL_TRIANGLES, 0, 3);
+				});
+		}
 
-		postProc.setInt("effectIndex", effectIndex);
-		postProc.setFloat("time", time);
+		// Resolves into a texture held as next frame's history, so it's imported rather than transient
+		if (temporalUpscale)
+		{
+			resolvedColor = frameGraph.importTexture("Temporal Output", temporalUpscaler.beginFrame(renderTargets, SCREEN_WIDTH, SCREEN_HEIGHT));
+			frameGraph.addPass("Temporal Resolve",
+				[&](ew::FrameGraph::Builder& builder) {
+					builder.read(sceneColor);
+					builder.read(sceneMotion);
+					builder.read(sceneDepth);
+					builder.write(resolvedColor);
+				},
+				[&](const ew::FrameGraph& graph) {
+					glBindFramebuffer(GL_FRAMEBUFFER, graph.getFramebuffer(resolvedColor));
+					glDisable(GL_DEPTH_TEST);
+					temporalUpscaler.resolve(graph.getTexture(sceneColor), graph.getTexture(sceneMotion), graph.getTexture(sceneDepth), renderWidth, renderHeight);
+				});
+		}
 
-		postProc.setMat4("_Model", quadTransform.getModelMatrix());
-		quadMesh->draw();
+		ew::FrameGraphResource postSource = temporalUpscale ? resolvedColor : sceneColor;
+		frameGraph.addPass("Post",
+			[&](ew::FrameGraph::Builder& builder) {
+				if (postPath != PostPath::ComputeChain) { return; }
+				builder.read(postSource);
+				postColor = builder.createTexture("Post Color", postWidth, postHeight, GL_RGBA8);
+				builder.write(postColor, ew::FrameGraphAccess::Storage);
+			},
+			[&](const ew::FrameGraph& graph) {
+				postChain.apply(renderTargets, graph.getTexture(postSource), postWidth, postHeight, time, graph.getTexture(postColor));
+			});
+
+		/* Brings the result to the window size.
+		* Below it the edge adaptive upscale draws at window size, then it (or the
+		* temporal resolve) is sharpened into the backbuffer. Otherwise it's a blit,
+		* bilinear when upscaling.
+		* */
+		ew::FrameGraphResource presentSource = postPath == PostPath::ComputeChain ? postColor : postSource;
+		// Until the upscaler has compiled the temporal result is blitted unsharpened
+		bool sharpening = (edgeAdaptiveUpscale || temporalUpscale) && sharpness > 0.0f && upscaler.isReady();
+		if (edgeAdaptiveUpscale)
+		{
+			frameGraph.addPass("Upscale",
+				[&](ew::FrameGraph::Builder& builder) {
+					builder.read(presentSource);
+					if (sharpening) { upscaledColor = builder.createTexture("Upscaled Color", SCREEN_WIDTH, SCREEN_HEIGHT, GL_RGBA8); }
+					else { builder.write(backbuffer); }
+				},
+				[&](const ew::FrameGraph& graph) {
+					glBindFramebuffer(GL_FRAMEBUFFER, graph.getFramebuffer(upscaledColor));
+					glDisable(GL_DEPTH_TEST);
+					upscaler.upscale(graph.getTexture(presentSource), renderWidth, renderHeight, SCREEN_WIDTH, SCREEN_HEIGHT);
+				});
+		}
+		ew::FrameGraphResource sharpenSource = edgeAdaptiveUpscale ? upscaledColor : presentSource;
+		if (sharpening)
+		{
+			frameGraph.addPass("Sharpen",
+				[&](ew::FrameGraph::Builder& builder) {
+					builder.read(sharpenSource);
+					builder.write(backbuffer);
+				},
+				[&](const ew::FrameGraph& graph) {
+					glBindFramebuffer(GL_FRAMEBUFFER, 0);
+					glDisable(GL_DEPTH_TEST);
+					upscaler.sharpen(graph.getTexture(sharpenSource), SCREEN_WIDTH, SCREEN_HEIGHT, sharpness);
+				});
+		}
+		if (!edgeAdaptiveUpscale && !sharpening && postPath != PostPath::Direct)
+		{
+			frameGraph.addPass("Present",
+				[&](ew::FrameGraph::Builder& builder) {
+					builder.read(presentSource, ew::FrameGraphAccess::Blit);
+					builder.write(backbuffer, ew::FrameGraphAccess::Blit);
+				},
+				[&](const ew::FrameGraph& graph) {
+					GLenum filter = postWidth != SCREEN_WIDTH || postHeight != SCREEN_HEIGHT ? GL_LINEAR : GL_NEAREST;
+					glBlitNamedFramebuffer(graph.getFramebuffer(presentSource), 0, 0, 0, postWidth, postHeight, 0, 0, SCREEN_WIDTH, SCREEN_HEIGHT, GL_COLOR_BUFFER_BIT, filter);
+				});
+		}
 
 		ImGui::Begin("Directional Light");
 
@@ -642,21 +1808,221 @@ int main() {
 		ImGui::ColorEdit3("Color", &_DirectionalLight.light.color.r);
 		ImGui::End();
 
+		ImGui::Begin("Local Lights");
+
+		ImGui::SliderInt("Point Lights", &numPointLights, 0, 32);
+		ImGui::DragFloat3("Orbit Center", &pointLightOrbitCenter.x, 0.5f);
+		ImGui::DragFloat("Orbit Range", &pointLightOrbitRange, 0.1f, 0.0f, 100.0f);
+		ImGui::DragFloat("Orbit Speed", &pointLightOrbitSpeed, 0.01f, 0.0f, 5.0f);
+		ImGui::DragFloat("Point Range", &_PointLight.range, 0.1f, 1.0f, 200.0f);
+		ImGui::ColorEdit3("Point Color", &_PointLight.light.color.r);
+		ImGui::SliderInt("Spot Lights", &numSpotLights, 0, 32);
+		ImGui::DragFloat3("Spot Position", &_SpotLight.position.x, 0.5f);
+		ImGui::DragFloat3("Spot Direction", &_SpotLight.direction.x, 0.01f, -1.0f, 1.0f);
+		ImGui::DragFloat("Spot Range", &_SpotLight.range, 0.1f, 1.0f, 200.0f);
+		ImGui::DragFloat("Inner Angle", &_SpotLight.innerAngle, 0.1f, 0.0f, _SpotLight.outerAngle);
+		ImGui::DragFloat("Outer Angle", &_SpotLight.outerAngle, 0.1f, _SpotLight.innerAngle, 85.0f);
+		ImGui::ColorEdit3("Spot Color", &_SpotLight.light.color.r);
+		ImGui::Separator();
+
+		int atlasBudget = shadowAtlas.getBudget();
+		if (ImGui::SliderInt("Tiles Per Frame", &atlasBudget, ew::ShadowAtlas::POINT_LIGHT_FACES, ew::ShadowCasterDraws::MAX_VIEWS)) { shadowAtlas.setBudget(atlasBudget); }
+		ImGui::Text("Atlas %d x %d, %s", shadowAtlas.getSize(), shadowAtlas.getSize(), shadowAtlas.isMultiDraw() ? "tiles drawn in one pass" : "one pass per tile");
+		ImGui::Text("%d tiles, %.1f%% of the atlas", shadowAtlas.getNumTiles(), shadowAtlas.getOccupancy() * 100.0f);
+		ImGui::Text("%d rendered last update, %d lights waiting", shadowAtlas.getNumRendered(), shadowAtlas.getNumPending());
+		ImGui::Text("%d evicted", shadowAtlas.getNumEvicted());
+		ImGui::Separator();
+
+		if (ImGui::Combo("Scattered Lights", &scatteredLightCountIndex, scatteredLightCountNames, NUM_SCATTERED_LIGHT_COUNTS)) { scatteredLightsChanged = true; }
+		if (ImGui::DragFloat("Scattered Range", &scatteredLightRange, 0.1f, 1.0f, 100.0f)) { scatteredLightsChanged = true; }
+		ImGui::Checkbox("Clustered Lighting", &clusteredLighting);
+		float nearSliceEnd = lightClusters.getNearSliceEnd();
+		if (ImGui::DragFloat("First Slice Depth", &nearSliceEnd, 0.1f, 0.1f, 100.0f)) { lightClusters.setNearSliceEnd(nearSliceEnd); }
+		const ew::LightClusters::Stats& clusterStats = lightClusters.getStats();
+		ImGui::Text("%d local lights, %dx%dx%d clusters", numLocalLights, ew::LightClusters::GRID_X, ew::LightClusters::GRID_Y, ew::LightClusters::GRID_Z);
+		if (sceneUsesClusters)
+		{
+			ImGui::Text("%d clusters lit, %.1f lights each, %d at most", clusterStats.numOccupied, clusterStats.numOccupied > 0 ? (float)clusterStats.numReferences / clusterStats.numOccupied : 0.0f, clusterStats.maxLights);
+			ImGui::Text("%d of %d references dropped", clusterStats.numDropped, lightClusters.getMaxLightReferences());
+		}
+		if (ImGui::Button("Compare Light Counts") && !lightBenchmark.running) { lightBenchmark.start(); }
+		if (lightBenchmark.running) { ImGui::Text("Measuring %s lights...", scatteredLightCountNames[lightBenchmark.countIndex]); }
+		for (int i = 1; i <= lightBenchmark.numResults; i++)
+		{
+			ImGui::Text("%s: clustering %.3f ms + scene %.3f ms", scatteredLightCountNames[i], lightBenchmark.clusterMilliseconds[i], lightBenchmark.sceneMilliseconds[i]);
+		}
+		ImGui::End();
+
 		ImGui::Begin("Post Processing");
 
-		ImGui::Combo("Effects", &effectIndex, effectNames, IM_ARRAYSIZE(effectNames));
+		for (int i = 0; i < MAX_POST_EFFECTS; i++)
+		{
+			std::string label = "Effect " + std::to_string(i + 1);
+			ImGui::Combo(label.c_str(), &postEffects[i], effectNames, ew::NUM_POST_EFFECTS);
+		}
+		ImGui::Checkbox("Bypass with blit", &bypassWithBlit);
+		ImGui::End();
+
+		// Every dispatch and the final blit read and write an RGBA8 target once, the direct path does neither.
+		// The upscale and sharpen passes each read their source once (within cache) and write the window once
+		int postDispatches = postPath == PostPath::ComputeChain ? postChain.getNumStages() : 0;
+		double renderPixels = (double)renderWidth * renderHeight;
+		double screenPixels = (double)SCREEN_WIDTH * SCREEN_HEIGHT;
+		double blitPixels = postPath == PostPath::Direct ? 0.0 : renderPixels + screenPixels;
+		if (sharpening) { blitPixels += 2.0 * screenPixels; }
+		// The resolve reads color, motion and depth, and reads and writes a half float history
+		if (temporalUpscale) { blitPixels += 3.0 * renderPixels + 4.0 * screenPixels; }
+		double postMegabytes = (postDispatches * 2.0 * postWidth * postHeight + blitPixels) * 4 / (1024.0 * 1024.0);
+		ImGui::Begin("Frame Stats");
+
+		if (ImGui::Combo("Render Scale", &renderScaleMode, renderScaleNames, NUM_FIXED_RENDER_SCALES + 1)) { dynamicResolution.reset(); }
+		if (renderScaleMode == RENDER_SCALE_DYNAMIC)
+		{
+			float targetMilliseconds = dynamicResolution.getTargetMilliseconds();
+			if (ImGui::SliderFloat("Target GPU ms", &targetMilliseconds, 2.0f, 50.0f)) { dynamicResolution.setTargetMilliseconds(targetMilliseconds); }
+			if (ImGui::SliderFloat("Min Scale", &minRenderScale, 0.25f, 1.0f)) { dynamicResolution.setScaleRange(minRenderScale, 1.0f); }
+		}
+		ImGui::Combo("Upscaler", &upscaleFilter, upscaleFilterNames, 3);
+		ImGui::SliderFloat("Sharpness", &sharpness, 0.0f, 1.0f);
+		ImGui::Text("Render scale: %.2f (%dx%d of %dx%d)", (float)renderWidth / SCREEN_WIDTH, renderWidth, renderHeight, SCREEN_WIDTH, SCREEN_HEIGHT);
+		ImGui::Text("GPU frame: %.3f ms (smoothed %.3f)", gpuFrameMilliseconds, dynamicResolution.getSmoothedMilliseconds());
+		if (ImGui::Button("Compare Render Scales") && !upscaleBenchmark.running) { upscaleBenchmark.start(); }
+		if (upscaleBenchmark.running) { ImGui::Text("Measuring %s...", renderScaleNames[upscaleBenchmark.scaleIndex]); }
+		for (int i = 0; i < upscaleBenchmark.numResults; i++)
+		{
+			ImGui::Text("%s: scene %.3f ms + upscale %.3f ms", renderScaleNames[i], upscaleBenchmark.sceneMilliseconds[i], upscaleBenchmark.upscaleMilliseconds[i]);
+		}
+		ImGui::Separator();
+
+		ImGui::Text("Frame: %.2f ms", deltaTime * 1000.0f);
+		ImGui::Text("Post path: %s", postPathNames[(int)postPath]);
+		ImGui::Text("Post dispatches: %d", postDispatches);
+		ImGui::Text("Post traffic: %.2f MB/frame", postMegabytes);
+		ImGui::Text("Render targets: %d (%d in use at once), %.2f MB", renderTargets.getNumTextures(), renderTargets.getPeakAcquired(), renderTargets.getMemoryBytes() / (1024.0 * 1024.0));
+		if (GLEW_NVX_gpu_memory_info)
+		{
+			GLint totalKB = 0, availableKB = 0;
+			glGetIntegerv(GL_GPU_MEMORY_INFO_DEDICATED_VIDMEM_NVX, &totalKB);
+			glGetIntegerv(GL_GPU_MEMORY_INFO_CURRENT_AVAILABLE_VIDMEM_NVX, &availableKB);
+			ImGui::Text("GPU memory: %.0f / %.0f MB used", (totalKB - availableKB) / 1024.0, totalKB / 1024.0);
+		}
+		else if (GLEW_ATI_meminfo)
+		{
+			GLint textureFreeKB[4] = {};
+			glGetIntegerv(GL_TEXTURE_FREE_MEMORY_ATI, textureFreeKB);
+			ImGui::Text("GPU memory: %.0f MB free for textures", textureFreeKB[0] / 1024.0);
+		}
+		ImGui::Separator();
+		for (const ew::FrameGraph::PassTiming& pass : frameGraph.getPassTimings())
+		{
+			if (pass.culled) { ImGui::TextDisabled("%s: culled", pass.name.c_str()); }
+			else { ImGui::Text("%s: %.3f ms", pass.name.c_str(), pass.gpuMilliseconds); }
+		}
+		ImGui::Text("Memory barriers: %d", frameGraph.getNumBarriers());
+		ImGui::End();
+
+		ImGui::Begin("Shader Features");
+
+		ImGui::Checkbox("Normal Map", &useNormalMap);
+		ImGui::Checkbox("Shadows", &useShadows);
+		const char* shadowFilterNames[] = { "PCF", "EVSM" };
+		ImGui::Combo("Shadow Filter", &shadowFilter, shadowFilterNames, 2);
+		// The local lights' atlas is filtered with PCF either way
+		if (ImGui::SliderInt(shadowFilter == 0 ? "PCF Kernel" : "Atlas PCF Kernel", &pcfKernel, 1, 5)) { pcfKernel |= 1; }
+		if (shadowFilter == 1)
+		{
+			int blurRadius = shadowMoments.getBlurRadius();
+			if (ImGui::SliderInt("Moment Blur Radius", &blurRadius, 0, ew::ShadowMoments::MAX_BLUR_RADIUS)) { shadowMoments.setBlurRadius(blurRadius); }
+			ImGui::SliderFloat("Light Bleed Reduction", &lightBleedReduction, 0.0f, 0.9f);
+			ImGui::SliderFloat("Moment Bias", &momentBias, 0.0f, 1.0f);
+			ImGui::Text("Moments %dx%d, %d cascades rebuilt by the last filter", shadowMoments.getResolution(), shadowMoments.getResolution(), shadowMoments.getNumFiltered());
+		}
+		ImGui::Checkbox("Cache Shadow Cascades", &cacheShadowCascades);
+		float shadowDistance = cascadedShadows.getShadowDistance();
+		if (ImGui::SliderFloat("Shadow Distance", &shadowDistance, 20.0f, 1000.0f)) { cascadedShadows.setShadowDistance(shadowDistance); }
+		ImGui::Text("Cascades drawn %s, %d rendered last update", cascadedShadows.isLayered() ? "in one layered pass" : "one pass each", cascadedShadows.getNumRendered());
+		for (int i = 0; i < ew::CascadedShadows::NUM_CASCADES; i++)
+		{
+			ImGui::Text("Cascade %d: to %.1f, %u casters", i, cascadedShadows.getSplit(i), cascadedShadows.getNumCasters(i));
+		}
+		ImGui::Text("%d lit variants, %d deferred lighting, %d post variants", (int)litVariants.getNumVariants(), (int)deferredVariants.getNumVariants(), (int)postVariants.getNumVariants());
+		ImGui::Separator();
+
+		ImGui::Checkbox("Depth Pre-pass", &useDepthPrepass);
+		if (litFragmentQueries[0])
+		{
+			ImGui::Text("Lit fragments, no pre-pass: %llu", (unsigned long long)litFragmentQueries[0]->getResult());
+			ImGui::Text("Lit fragments, pre-pass: %llu (+%llu depth only)", (unsigned long long)litFragmentQueries[1]->getResult(), (unsigned long long)prepassFragmentQuery->getResult());
+		}
+		else { ImGui::TextDisabled("Fragment counts need ARB_pipeline_statistics_query"); }
+		ImGui::Separator();
+
+		ImGui::Checkbox("Deferred Shading", &deferredShading);
+		// Albedo, normal, surface, view depth and the depth buffer, and the motion when it's written here
+		int gBufferBytes = 24 + (temporalUpscale ? 4 : 0);
+		ImGui::Text("G-buffer %d bytes per pixel, %.1f MB at %dx%d", gBufferBytes, (double)gBufferBytes * renderWidth * renderHeight / (1024.0 * 1024.0), renderWidth, renderHeight);
+		if (deferredShading && geometryShader == nullptr) { ImGui::TextDisabled("Compiling the deferred variants..."); }
+		ImGui::Checkbox("Ambient Occlusion (Deferred Only)", &useAmbientOcclusion);
+		if (useAmbientOcclusion)
+		{
+			if (!deferredShading) { ImGui::TextDisabled("Off while shading forward, it reads the G-buffer"); }
+			bool autoTier = ambientOcclusion.isAutoTier();
+			if (ImGui::Checkbox("Auto Tier", &autoTier)) { ambientOcclusion.setAutoTier(autoTier); }
+			if (autoTier)
+			{
+				float budget = ambientOcclusion.getBudgetMilliseconds();
+				if (ImGui::SliderFloat("AO Budget ms", &budget, 0.25f, 5.0f)) { ambientOcclusion.setBudgetMilliseconds(budget); }
+			}
+			const char* tierNames[ew::AmbientOcclusion::NUM_TIERS];
+			for (int i = 0; i < ew::AmbientOcclusion::NUM_TIERS; i++) { tierNames[i] = ew::AmbientOcclusion::TIERS[i].name; }
+			int tier = ambientOcclusion.getTier();
+			// Picked by the budget while it's automatic
+			if (ImGui::Combo("AO Tier", &tier, tierNames, ew::AmbientOcclusion::NUM_TIERS) && !autoTier) { ambientOcclusion.setTier(tier); }
+			const ew::AmbientOcclusion::Tier& current = ew::AmbientOcclusion::TIERS[ambientOcclusion.getTier()];
+			ImGui::Text("%d samples at half resolution, blur radius %d, %.3f ms", current.numSamples, current.blurRadius, ambientOcclusion.getSmoothedMilliseconds());
+			float radius = ambientOcclusion.getRadius();
+			if (ImGui::SliderFloat("AO Radius", &radius, 0.1f, 4.0f)) { ambientOcclusion.setRadius(radius); }
+			float intensity = ambientOcclusion.getIntensity();
+			if (ImGui::SliderFloat("AO Intensity", &intensity, 0.5f, 4.0f)) { ambientOcclusion.setIntensity(intensity); }
+		}
+		ImGui::End();
+
+		ImGui::Begin("Shaders");
+
+		// The wave stage is a variant that keeps the "time" uniform
+		Shader& benchmarkShader = postVariants.get({ { "GATHER_EFFECT", ew::POST_EFFECT_WAVE }, { "NUM_POINTWISE", 0 } });
+		if (ImGui::Button("Benchmark Uniform Setters") && benchmarkShader.isReady())
+		{
+			uniformBenchmark = benchmarkUniformSetters(benchmarkShader, UNIFORM_BENCHMARK_CALLS);
+			printf("Uniform setters (ns/call): string lookup %.1f, hashed name %.1f, handle %.1f\n", uniformBenchmark.stringLookup, uniformBenchmark.hashedName, uniformBenchmark.handle);
+		}
+		ImGui::Text("String lookup: %.1f ns", uniformBenchmark.stringLookup);
+		ImGui::Text("Hashed name: %.1f ns", uniformBenchmark.hashedName);
+		ImGui::Text("Handle: %.1f ns", uniformBenchmark.handle);
 		ImGui::End();
 
 		// This needs to be improved. ie. Have it so that data that corresponds
 		// with instances that don't exist don't get updated.
 		ImGui::Begin("Instancing");
 
-		ImGui::InputInt("Target Instance", &targetInstance);
-		ImGui::DragFloat3("Instance Position", &instanceOffsets[targetInstance].x, 0.1);
+		if (ImGui::InputInt("Target Instance", &targetInstance))
+		{
+			targetInstance = glm::clamp(targetInstance, 0, glm::clamp(instances, 1, MAX_INSTANCES) - 1);
+			targetOffset = instanceOffsets[targetInstance];
+		}
+		ImGui::DragFloat3("Instance Position", &targetOffset.x, 0.1);
 		if (ImGui::Button("Update Position"))
 		{
-			if (targetInstance > instances - 1) { targetInstance = instances - 1; }
-
+			// Cached shadows holding where it was or where it goes are rendered again
+			glm::mat4 instanceModel = instanced->getModelMatrix();
+			glm::vec3 previousPosition = glm::vec3(instanceModel * glm::vec4(instanceOffsets[targetInstance], 1.0f));
+			glm::vec3 newPosition = glm::vec3(instanceModel * glm::vec4(targetOffset, 1.0f));
+			cascadedShadows.invalidate(previousPosition, instanced->getInstanceRadius());
+			cascadedShadows.invalidate(newPosition, instanced->getInstanceRadius());
+			shadowAtlas.invalidate(previousPosition, instanced->getInstanceRadius());
+			shadowAtlas.invalidate(newPosition, instanced->getInstanceRadius());
+
+			instanceOffsets[targetInstance] = targetOffset;
 			instanced->updateTargetData(&instanceOffsets[targetInstance], targetInstance);
 		}
 
@@ -665,22 +2031,91 @@ int main() {
 		{
 			if (instances > MAX_INSTANCES) { instances = MAX_INSTANCES; }
 			buildScene(instanceOffsets, instances);
+			targetInstance = glm::clamp(targetInstance, 0, glm::clamp(instances, 1, MAX_INSTANCES) - 1);
+			targetOffset = instanceOffsets[targetInstance];
+			cascadedShadows.invalidate();
+			shadowAtlas.invalidate();
 		}
 		ImGui::End();
 
-		ImGui::Render();
-		ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+		frameGraph.addPass("UI",
+			[&](ew::FrameGraph::Builder& builder) {
+				builder.write(backbuffer);
+			},
+			[&](const ew::FrameGraph&) {
+				glBindFramebuffer(GL_FRAMEBUFFER, 0);
+				glViewport(0, 0, SCREEN_WIDTH, SCREEN_HEIGHT);
+				ImGui::Render();
+				ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+			});
+
+		frameGraph.execute();
+		if (temporalUpscale) { temporalUpscaler.endFrame(renderTargets); }
+		else { temporalUpscaler.reset(renderTargets); }
+		renderTargets.endFrame();
+
+		// The timings are a few frames old, DynamicResolution waits for them to catch up after each change
+		gpuFrameMilliseconds = 0.0;
+		for (const ew::FrameGraph::PassTiming& pass : frameGraph.getPassTimings()) { gpuFrameMilliseconds += pass.gpuMilliseconds; }
+		if (renderScaleMode == RENDER_SCALE_DYNAMIC && !upscaleBenchmark.running) { dynamicResolution.update(gpuFrameMilliseconds); }
+		for (const ew::FrameGraph::PassTiming& pass : frameGraph.getPassTimings())
+		{
+			if (pass.name == "Ambient Occlusion" && !pass.culled) { ambientOcclusion.update(pass.gpuMilliseconds); }
+		}
+		if (lightBenchmark.running)
+		{
+			lightBenchmark.addFrame(frameGraph.getPassTimings(), lightClusters.getStats());
+			if (!lightBenchmark.running)
+			{
+				printf("Light count comparison (%d animated lights, range %.1f, GPU ms):\n", (int)localLights.size(), scatteredLightRange);
+				for (int i = 1; i < NUM_SCATTERED_LIGHT_COUNTS; i++)
+				{
+					const ew::LightClusters::Stats& stats = lightBenchmark.clusterStats[i];
+					printf("  %-5s clustering %.3f + scene %.3f = %.3f, %d clusters lit with %.1f lights each, %d at most, %d dropped\n", scatteredLightCountNames[i],
+						lightBenchmark.clusterMilliseconds[i], lightBenchmark.sceneMilliseconds[i], lightBenchmark.clusterMilliseconds[i] + lightBenchmark.sceneMilliseconds[i],
+						stats.numOccupied, stats.numOccupied > 0 ? (float)stats.numReferences / stats.numOccupied : 0.0f, stats.maxLights, stats.numDropped);
+				}
+			}
+		}
+		if (upscaleBenchmark.running)
+		{
+			upscaleBenchmark.addFrame(frameGraph.getPassTimings());
+			if (!upscaleBenchmark.running)
+			{
+				printf("Render scale comparison (%s, GPU ms):\n", upscaleFilterNames[upscaleFilter]);
+				for (int i = 0; i < NUM_FIXED_RENDER_SCALES; i++)
+				{
+					printf("  %-6s scene %.3f + upscale %.3f = %.3f\n", renderScaleNames[i], upscaleBenchmark.sceneMilliseconds[i], upscaleBenchmark.upscaleMilliseconds[i],
+						upscaleBenchmark.sceneMilliseconds[i] + upscaleBenchmark.upscaleMilliseconds[i]);
+				}
+			}
+		}
 		glfwPollEvents();
 
 		glfwSwapBuffers(window);
+
+		if (firstFrame)
+		{
+			firstFrame = false;
+			printf("First frame after %.3f ms\n", (glfwGetTime() - shaderLoadStart) * 1000.0);
+		}
 	}
 
+	glDeleteSamplers(1, &momentsSampler);
+	glDeleteSamplers(1, &shadowSampler);
+
+	// Finishes any compiles still queued
+	delete compileWorker;
+
 	glfwTerminate();
 	return 0;
 }
 //Author: Eric Winebrenner
 void resizeFrameBufferCallback(GLFWwindow* window, int width, int height)
 {
+	// Minimized, keep the last size so targets aren't requested at 0x0
+	if (width == 0 || height == 0) { return; }
+
 	SCREEN_WIDTH = width;
 	SCREEN_HEIGHT = height;
 	camera.setAspectRatio((float)SCREEN_WIDTH / SCREEN_HEIGHT);
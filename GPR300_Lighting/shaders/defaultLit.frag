@@ -1,6 +1,70 @@
 #version 450                          
+//Feature switches, injected as #defines by ShaderVariants
+#ifndef NORMAL_MAP
+#define NORMAL_MAP 0
+#endif
+#ifndef SHADOWS
+#define SHADOWS 0
+#endif
+//Taps across for the atlas's local light shadows, and the cascades' with SHADOW_FILTER 0
+#ifndef PCF_KERNEL
+#define PCF_KERNEL 3
+#endif
+//0 filters the cascades with PCF_KERNEL x PCF_KERNEL taps, 1 reads the prefiltered moments of ShadowMoments
+#ifndef SHADOW_FILTER
+#define SHADOW_FILTER 0
+#endif
+//1 shades only the local lights LightClusters binned into this fragment's cell, 0 all of them
+#ifndef CLUSTERED_LIGHTS
+#define CLUSTERED_LIGHTS 1
+#endif
+//0 shades in one pass. Deferred shading splits it: 1 writes the surface to the G-buffer,
+//2 lights every pixel from there, drawn over the screen with fullscreen.vert
+#ifndef DEFERRED_PASS
+#define DEFERRED_PASS 0
+#endif
+//Scales the ambient term by ew::AmbientOcclusion's result, in the deferred lighting pass
+#ifndef AMBIENT_OCCLUSION
+#define AMBIENT_OCCLUSION 0
+#endif
+#if DEFERRED_PASS == 1
+//The G-buffer, packed: RGBA8 albedo, RGBA16 octahedral normals, RGBA8 material factors.
+//The normals are the shading one (normal mapped) in rg and the geometric one in ba, which the
+//shadows offset along like the forward pass does.
+//Positions are rebuilt from the R32F view depth, the depth buffer is too coarse that far from the near plane
+layout (location = 0) out vec4 Albedo;
+layout (location = 1) out vec4 Normal;
+layout (location = 2) out vec4 Surface;
+layout (location = 3) out float ViewDepth;
+layout (location = 4) out vec2 Motion;
+#else
 layout (location = 0) out vec4 FragColor;
+#if DEFERRED_PASS == 0
+//Screen UV moved since the last frame, read by the temporal resolve
+layout (location = 1) out vec2 Motion;
+#endif
+#endif
+
+#if DEFERRED_PASS == 2
+struct Vertex
+{
+    vec3 worldNormal;
+    vec3 worldPosition;
+    vec2 uv;
+};
 
+//Rebuilt from the G-buffer at the start of main
+Vertex vertexOutput;
+in vec2 UV;
+
+layout (binding = 10) uniform sampler2D _GBufferAlbedo;
+layout (binding = 11) uniform sampler2D _GBufferNormal;
+layout (binding = 12) uniform sampler2D _GBufferSurface;
+layout (binding = 13) uniform sampler2D _GBufferViewDepth;
+#if AMBIENT_OCCLUSION
+layout (binding = 14) uniform sampler2D _AmbientOcclusion;
+#endif
+#else
 in struct Vertex
 {
     vec3 worldNormal;
@@ -9,7 +73,9 @@ in struct Vertex
 }vertexOutput;
 
 in mat3 TBN;
-in vec4 lightSpacePos;
+in vec4 currentClipPos;
+in vec4 previousClipPos;
+#endif
 
 struct Material
 {
@@ -51,18 +117,133 @@ struct SpotLight
     float angleFalloff;
 };
 
-uniform DirectionalLight _DirectionalLight;
-uniform Material _Material;
-uniform vec3 _CameraPosition;
+//A point light, or a spot light when isSpot is set. std430, mirrored by LocalLightData in main.cpp
+struct LocalLight
+{
+    vec3 position;
+    float range;
+    vec3 color;
+    float intensity;
+    vec3 direction;
+    float innerAngle;
+    float outerAngle;
+    float angleFalloff;
+    float constK;
+    float linearK;
+    float quadraticK;
+    int isSpot;
+    //First of its tiles in the shadow atlas, -1 when unshadowed
+    int shadowIndex;
+};
+
+layout (std140, binding = 0) uniform FrameData
+{
+    mat4 _View;
+    mat4 _Projection;
+    mat4 _ViewProjection;
+    vec3 _CameraPosition;
+    float time;
+    float _MinBias;
+    float _MaxBias;
+    //Prefiltered shadows: probabilities below this read as fully shadowed, and the variance floor
+    float _LightBleedReduction;
+    float _MomentBias;
+    //Without jitter, this frame's and last frame's, for motion vectors
+    mat4 _UnjitteredViewProjection;
+    mat4 _PreviousViewProjection;
+};
+
+layout (std140, binding = 1) uniform LightData
+{
+    DirectionalLight _DirectionalLight;
+    int _NumLocalLights;
+};
+
+layout (std430, binding = 5) readonly buffer LocalLights
+{
+    LocalLight _LocalLights[];
+};
+
+#if CLUSTERED_LIGHTS
+//Must match LightClusters::GRID_X, GRID_Y and GRID_Z
+#define CLUSTER_GRID_X 16
+#define CLUSTER_GRID_Y 9
+#define CLUSTER_GRID_Z 24
 
-uniform sampler2D _Texture1;
-uniform sampler2D _Texture2;
-uniform sampler2D _ShadowMap;
-uniform sampler2D _Normal;
+layout (std140, binding = 6) uniform ClusterData
+{
+    mat4 _ClusterView;
+    //Cells per pixel in xy, then the slice of a view depth is log(depth) * z + w past the first
+    vec4 _ClusterScale;
+    vec4 _ClusterFrustum;
+    float _ClusterNearSliceEnd;
+    uint _MaxLightReferences;
+};
+
+//Each cell's lights are _ClusterCounts[cell] indices from _ClusterOffsets[cell], cut short where the list runs out
+layout (std430, binding = 7) readonly buffer ClusterLights
+{
+    uint _ClusterCounts[CLUSTER_GRID_X * CLUSTER_GRID_Y * CLUSTER_GRID_Z];
+    uint _ClusterFill[CLUSTER_GRID_X * CLUSTER_GRID_Y * CLUSTER_GRID_Z];
+    uint _NumClusterReferences;
+    uint _ClusterOffsets[CLUSTER_GRID_X * CLUSTER_GRID_Y * CLUSTER_GRID_Z];
+    uint _ClusterLightIndices[];
+};
+
+uint getCluster(vec3 worldPosition)
+{
+    float depth = -(_ClusterView * vec4(worldPosition, 1.0)).z;
+    int slice = depth < _ClusterNearSliceEnd ? 0 : clamp(int(log(depth) * _ClusterScale.z + _ClusterScale.w) + 1, 1, CLUSTER_GRID_Z - 1);
+    ivec2 cell = clamp(ivec2(gl_FragCoord.xy * _ClusterScale.xy), ivec2(0), ivec2(CLUSTER_GRID_X - 1, CLUSTER_GRID_Y - 1));
+    return uint((slice * CLUSTER_GRID_Y + cell.y) * CLUSTER_GRID_X + cell.x);
+}
+#endif
+
+layout (std140, binding = 2) uniform MaterialData
+{
+    Material _Material;
+};
+
+//Texture units are fixed here rather than set from the application
+layout (binding = 0) uniform sampler2D _Texture1;
+layout (binding = 1) uniform sampler2D _Texture2;
+layout (binding = 2) uniform sampler2D _Normal;
+
+#if SHADOWS
+//Must match CascadedShadows::NUM_CASCADES
+#define NUM_CASCADES 4
+
+//Light projection of each cascade, the view distance it reaches and how much its texels are larger than the bias was tuned for
+layout (std140, binding = 4) uniform ShadowData
+{
+    mat4 _CascadeViewProj[NUM_CASCADES];
+    vec4 _CascadeSplits;
+    vec4 _CascadeBiasScale;
+};
+
+#if SHADOW_FILTER == 1
+//Must match EVSM_EXPONENTS in shadowMoments.comp
+const vec2 EVSM_EXPONENTS = vec2(40.0, 20.0);
+
+layout (binding = 9) uniform sampler2DArray _ShadowMoments;
+#else
+layout (binding = 3) uniform sampler2DArray _ShadowMap;
+#endif
+
+//A tile of the local light shadow atlas: its light projection, then its offset and size in uv and the tangent of half its field of view
+struct ShadowTile
+{
+    mat4 viewProjection;
+    vec4 rect;
+};
+
+layout (std430, binding = 6) readonly buffer ShadowTiles
+{
+    ShadowTile _ShadowTiles[];
+};
 
-uniform float time;
-uniform float _MinBias;
-uniform float _MaxBias;
+layout (binding = 8) uniform sampler2D _ShadowAtlas;
+#endif
 
 float calcAmbient(float ambientCoefficient)
 {
@@ -78,7 +259,7 @@ float calcDiffuse(float diffuseCoefficient, vec3 lightDirection, vec3 vertexNorm
     float diffuseRet;
 
     float cosAngle = dot(normalize(lightDirection), normalize(vertexNormal));
-    cosAngle = clamp(cosAngle, 0, cosAngle);
+    cosAngle = max(cosAngle, 0.0);
 
     diffuseRet = diffuseCoefficient * cosAngle;
 
@@ -92,7 +273,8 @@ float calcSpecular(float specularCoefficient, vec3 lightDirection, vec3 vertexPo
     vec3 reflectDir = reflect(-lightDirection, vertexNormal);
     vec3 cameraDir = cameraPosition - vertexPosition;
     float cosAngle = dot(normalize(reflectDir), normalize(cameraDir));
-    cosAngle = clamp(cosAngle, 0, cosAngle);
+    //pow of a negative is NaN, and one NaN light blacks out every fragment it reaches
+    cosAngle = max(cosAngle, 0.0);
 
     specularRet = specularCoefficient * pow(cosAngle, shininess);
 
@@ -134,57 +316,250 @@ float calcAngularAttenuation(SpotLight light, vec3 vertPos)
     float maxAngle = cos(radians(light.outerAngle));
     float minAngle = cos(radians(light.innerAngle));
 
+    //Clamped first, outside the cone it's negative and pow is undefined
     attenuation = (cosAngle - maxAngle) / (minAngle - maxAngle);
-    attenuation = pow(attenuation, light.angleFalloff);
     attenuation = clamp(attenuation, 0, 1);
+    attenuation = pow(attenuation, light.angleFalloff);
 
     return attenuation;
 }
 
-float calcShadow(sampler2D shadowMap, vec4 lightSpacePos, vec3 normal, vec3 lightDir)
+#if SHADOWS
+#if SHADOW_FILTER == 1
+//Upper bound on the share of the filter footprint lit, from the mean and variance of one warp
+float chebyshevUpperBound(vec2 moments, float depth, float minVariance)
 {
+    if (depth <= moments.x) { return 1.0; }
+    float variance = max(moments.y - moments.x * moments.x, minVariance);
+    float d = depth - moments.x;
+    float pMax = variance / (variance + d * d);
+    //Cuts off the tail where overlapping occluders leak light
+    return clamp((pMax - _LightBleedReduction) / (1.0 - _LightBleedReduction), 0.0, 1.0);
+}
+
+float calcShadow(sampler2DArray shadowMoments, vec3 worldPosition, vec3 normal, vec3 lightDir)
+{
+    //The first cascade reaching past this fragment, beyond the last one is unshadowed
+    float viewDistance = -(_View * vec4(worldPosition, 1)).z;
+    int cascade = int(dot(vec4(greaterThan(vec4(viewDistance), _CascadeSplits)), vec4(1)));
+    if (cascade >= NUM_CASCADES) { return 0.0; }
+
+    vec4 lightSpacePos = _CascadeViewProj[cascade] * vec4(worldPosition, 1);
     vec3 sampleCoord = lightSpacePos.xyz / lightSpacePos.w;
     sampleCoord = sampleCoord * 0.5 + 0.5;
 
-    float shadowMapDepth = texture(shadowMap, sampleCoord.xy).r;
+    //The projection is orthographic, so uv changes across the pixel by the world position's change projected.
+    //Implicit derivatives would jump where the cascade changes and pick the smallest mip along the seam
+    vec2 uvDx = (_CascadeViewProj[cascade] * vec4(dFdx(worldPosition), 0)).xy * 0.5;
+    vec2 uvDy = (_CascadeViewProj[cascade] * vec4(dFdy(worldPosition), 0)).xy * 0.5;
+    vec4 moments = textureGrad(shadowMoments, vec3(sampleCoord.xy, cascade), uvDx, uvDy);
+
+    float warped = clamp(sampleCoord.z, 0.0, 1.0) * 2.0 - 1.0;
+    vec2 depth = vec2(exp(EVSM_EXPONENTS.x * warped), -exp(-EVSM_EXPONENTS.y * warped));
+    //The variance floor follows the slope of each warp, which is steep where it's large
+    vec2 depthScale = _MomentBias * 0.01 * EVSM_EXPONENTS * depth;
+    vec2 minVariance = depthScale * depthScale;
+    float lit = min(chebyshevUpperBound(moments.xz, depth.x, minVariance.x), chebyshevUpperBound(moments.yw, depth.y, minVariance.y));
+
+    return 1.0 - lit;
+}
+#else
+float calcShadow(sampler2DArray shadowMap, vec3 worldPosition, vec3 normal, vec3 lightDir)
+{
+    //The first cascade reaching past this fragment, beyond the last one is unshadowed
+    float viewDistance = -(_View * vec4(worldPosition, 1)).z;
+    int cascade = int(dot(vec4(greaterThan(vec4(viewDistance), _CascadeSplits)), vec4(1)));
+    if (cascade >= NUM_CASCADES) { return 0.0; }
+
+    vec4 lightSpacePos = _CascadeViewProj[cascade] * vec4(worldPosition, 1);
+    vec3 sampleCoord = lightSpacePos.xyz / lightSpacePos.w;
+    sampleCoord = sampleCoord * 0.5 + 0.5;
 
     float minBias = _MinBias;//0.005f;
     float maxBias = _MaxBias;//0.015f;
 
-    float bias = max(maxBias * (1.0f - dot(normal, lightDir)), minBias);
+    float bias = max(maxBias * (1.0f - dot(normalize(normal), normalize(lightDir))), minBias) * _CascadeBiasScale[cascade];
     float depth = sampleCoord.z - bias;
 
     float shadow = 0.0f;
 
-    vec2 texelOffset = 1.0 / textureSize(shadowMap, 0);
+    vec2 texelOffset = 1.0 / textureSize(shadowMap, 0).xy;
 
-    for (int x = -1; x <= 1; x++)
+    //PCF_KERNEL x PCF_KERNEL taps, unrolled by the compiler since the bounds are constant
+    const int pcfRadius = PCF_KERNEL / 2;
+    for (int x = -pcfRadius; x <= pcfRadius; x++)
     {
-        for (int y = -1; y <= 1; y++)
+        for (int y = -pcfRadius; y <= pcfRadius; y++)
         {
             vec2 uv = sampleCoord.xy + vec2(x * texelOffset.x, y * texelOffset.y);
-            shadow += step(texture(shadowMap, uv).r, depth);
+            shadow += step(texture(shadowMap, vec3(uv, cascade)).r, depth);
         }
     }
-    shadow /= 10f;
+    shadow /= float(PCF_KERNEL * PCF_KERNEL);
 
     return shadow;
 }
+#endif
+
+float calcLocalShadow(sampler2D shadowAtlas, LocalLight light, vec3 worldPosition, vec3 normal)
+{
+    if (light.shadowIndex < 0) { return 0.0; }
+
+    //A point light has a tile per cube face, in the order +X, -X, +Y, -Y, +Z, -Z
+    vec3 fromLight = worldPosition - light.position;
+    int tileIndex = light.shadowIndex;
+    if (light.isSpot == 0)
+    {
+        vec3 axis = abs(fromLight);
+        int face = axis.x >= axis.y && axis.x >= axis.z ? 0 : (axis.y >= axis.z ? 2 : 4);
+        tileIndex += face + (fromLight[face / 2] < 0.0 ? 1 : 0);
+    }
+    ShadowTile tile = _ShadowTiles[tileIndex];
+
+    //Pushed out along the normal by a texel and a half, which grows with the distance under a perspective projection
+    vec2 texelOffset = 1.0 / textureSize(shadowAtlas, 0);
+    float texelSize = 2.0 * length(fromLight) * tile.rect.w * texelOffset.x / tile.rect.z;
+    vec4 lightSpacePos = tile.viewProjection * vec4(worldPosition + normalize(normal) * texelSize * 1.5, 1);
+    vec3 sampleCoord = lightSpacePos.xyz / lightSpacePos.w;
+    sampleCoord = sampleCoord * 0.5 + 0.5;
+    if (lightSpacePos.w <= 0.0 || sampleCoord.z >= 1.0) { return 0.0; }
+
+    //Taps stay inside the tile, its neighbors belong to other lights
+    const int pcfRadius = PCF_KERNEL / 2;
+    vec2 margin = texelOffset * (float(pcfRadius) + 0.5);
+    vec2 tileUV = tile.rect.xy + clamp(sampleCoord.xy * tile.rect.z, margin, vec2(tile.rect.z) - margin);
+
+    float shadow = 0.0f;
+    for (int x = -pcfRadius; x <= pcfRadius; x++)
+    {
+        for (int y = -pcfRadius; y <= pcfRadius; y++)
+        {
+            vec2 uv = tileUV + vec2(x * texelOffset.x, y * texelOffset.y);
+            shadow += step(texture(shadowAtlas, uv).r, sampleCoord.z);
+        }
+    }
+    shadow /= float(PCF_KERNEL * PCF_KERNEL);
+
+    return shadow;
+}
+#endif
+
+vec3 calcLocalLight(Vertex vertex, Material material, LocalLight local)
+{
+    vec3 toLight = local.position - vertex.worldPosition;
+    float dist = length(toLight);
+    if (dist >= local.range) { return vec3(0); }
+
+    PointLight point = PointLight(local.position, Light(local.color, local.intensity), local.constK, local.linearK, local.quadraticK);
+    //Faded out towards the range, so a light can be skipped past it
+    float window = clamp(1.0 - pow(dist / local.range, 4.0), 0.0, 1.0);
+    float attenuation = calcGLAttenuation(point, vertex.worldPosition) * window * window;
+    if (local.isSpot != 0)
+    {
+        SpotLight spot = SpotLight(local.position, local.direction, point.light, local.range, local.innerAngle, local.outerAngle, local.angleFalloff);
+        attenuation *= calcAngularAttenuation(spot, vertex.worldPosition);
+    }
+    if (attenuation <= 0.0) { return vec3(0); }
+
+#if SHADOWS
+    attenuation *= 1.0 - calcLocalShadow(_ShadowAtlas, local, vertexOutput.worldPosition, vertexOutput.worldNormal);
+#endif
+    return calcPhong(vertex, material, point.light, toLight, _CameraPosition) * attenuation;
+}
+
+//Octahedral mapping of a unit vector to [0, 1]^2, the lower half folded over the corners
+vec2 encodeNormal(vec3 n)
+{
+    n /= abs(n.x) + abs(n.y) + abs(n.z);
+    vec2 signs = vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+    vec2 folded = n.z >= 0.0 ? n.xy : (1.0 - abs(n.yx)) * signs;
+    return folded * 0.5 + 0.5;
+}
+
+vec3 decodeNormal(vec2 encoded)
+{
+    encoded = encoded * 2.0 - 1.0;
+    vec3 n = vec3(encoded, 1.0 - abs(encoded.x) - abs(encoded.y));
+    float fold = max(-n.z, 0.0);
+    n.x += n.x >= 0.0 ? -fold : fold;
+    n.y += n.y >= 0.0 ? -fold : fold;
+    return normalize(n);
+}
 
 void main(){ 
+#if DEFERRED_PASS == 2
+    ivec2 texel = ivec2(gl_FragCoord.xy);
+    float viewDepth = texelFetch(_GBufferViewDepth, texel, 0).r;
+    //Nothing was drawn here, the clear color stays
+    if (viewDepth <= 0.0) { discard; }
+    //Back through the projection at that depth, its jitter is in the third column
+    vec2 ndc = gl_FragCoord.xy / vec2(textureSize(_GBufferViewDepth, 0)) * 2.0 - 1.0;
+    vec3 viewPosition = vec3((ndc + vec2(_Projection[2][0], _Projection[2][1])) / vec2(_Projection[0][0], _Projection[1][1]), -1.0) * viewDepth;
+    vec4 normals = texelFetch(_GBufferNormal, texel, 0);
+    vec3 normal = decodeNormal(normals.rg);
+    vertexOutput = Vertex(decodeNormal(normals.ba), _CameraPosition + transpose(mat3(_View)) * viewPosition, UV);
+
+    vec4 surface = texelFetch(_GBufferSurface, texel, 0);
+    Material material = Material(vec3(1), surface.r, surface.g, surface.b, exp2(surface.a * 9.0), 0.0);
+#if AMBIENT_OCCLUSION
+    material.ambientK *= texelFetch(_AmbientOcclusion, texel, 0).r;
+#endif
+    vec4 albedo = texelFetch(_GBufferAlbedo, texel, 0);
+#else
+#if NORMAL_MAP
     vec3 normal = texture(_Normal, vertexOutput.uv).rgb;
     normal = (normal * 2.0f) - 1.0f;
     normal = normalize(normal * TBN);
-
+#else
+    vec3 normal = normalize(vertexOutput.worldNormal);
+#endif
+    Material material = _Material;
+    vec4 albedo = texture(_Texture1, vertexOutput.uv) * vec4(_Material.color, 1.0);
+#endif
+
+#if DEFERRED_PASS == 1
+    Albedo = albedo;
+    Normal = vec4(encodeNormal(normal), encodeNormal(normalize(vertexOutput.worldNormal)));
+    //Shininess runs from 1 to 512, stored as its exponent
+    Surface = vec4(material.ambientK, material.diffuseK, material.specularK, log2(max(material.shininess, 1.0)) / 9.0);
+    ViewDepth = -(_View * vec4(vertexOutput.worldPosition, 1.0)).z;
+    Motion = (currentClipPos.xy / currentClipPos.w - previousClipPos.xy / previousClipPos.w) * 0.5;
+#else
     Vertex newVertex = vertexOutput;
     newVertex.worldNormal = normal;
 
-    vec3 lightCol;
-    float shadow = calcShadow(_ShadowMap, lightSpacePos, vertexOutput.worldNormal, _DirectionalLight.direction);
-
-    lightCol += calcPhong(newVertex, _Material, _DirectionalLight.light, _DirectionalLight.direction, _CameraPosition) * (1.0 - shadow);
+    vec3 lightCol = vec3(0);
+#if SHADOWS
+#if SHADOW_FILTER == 1
+    float shadow = calcShadow(_ShadowMoments, vertexOutput.worldPosition, vertexOutput.worldNormal, _DirectionalLight.direction);
+#else
+    float shadow = calcShadow(_ShadowMap, vertexOutput.worldPosition, vertexOutput.worldNormal, _DirectionalLight.direction);
+#endif
+#else
+    float shadow = 0.0;
+#endif
+
+    lightCol += calcPhong(newVertex, material, _DirectionalLight.light, _DirectionalLight.direction, _CameraPosition) * (1.0 - shadow);
+#if CLUSTERED_LIGHTS
+    uint cluster = getCluster(vertexOutput.worldPosition);
+    uint first = _ClusterOffsets[cluster];
+    uint count = min(_ClusterCounts[cluster], _MaxLightReferences - min(first, _MaxLightReferences));
+    for (uint i = 0; i < count; i++)
+    {
+        lightCol += calcLocalLight(newVertex, material, _LocalLights[_ClusterLightIndices[first + i]]);
+    }
+#else
+    for (int i = 0; i < _NumLocalLights; i++)
+    {
+        lightCol += calcLocalLight(newVertex, material, _LocalLights[i]);
+    }
+#endif
 
     vec2 modifiedUV = vertexOutput.uv;
 
-    FragColor = texture(_Texture1, vertexOutput.uv) * vec4(lightCol * _Material.color, 1.0f);
+    FragColor = albedo * vec4(lightCol, 1.0f);
+#if DEFERRED_PASS == 0
+    Motion = (currentClipPos.xy / currentClipPos.w - previousClipPos.xy / previousClipPos.w) * 0.5;
+#endif
+#endif
 }
\ No newline at end of file
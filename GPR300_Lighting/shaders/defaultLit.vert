@@ -1,15 +1,37 @@
 #version 450                          
+//Feature switches, injected as #defines by ShaderVariants
+#ifndef NORMAL_MAP
+#define NORMAL_MAP 0
+#endif
 layout (location = 0) in vec3 vPos;  
 layout (location = 1) in vec3 vNormal;
 layout (location = 2) in vec2 vUV;
 layout (location = 3) in vec3 vTangent;
 layout (location = 4) in vec3 vOffsetTemp;
 
-uniform mat4 _Model;
-uniform mat4 _View;
-uniform mat4 _Projection;
+layout (std140, binding = 0) uniform FrameData
+{
+    mat4 _View;
+    mat4 _Projection;
+    mat4 _ViewProjection;
+    vec3 _CameraPosition;
+    float time;
+    float _MinBias;
+    float _MaxBias;
+    float _LightBleedReduction;
+    float _MomentBias;
+    //Without jitter, this frame's and last frame's, for motion vectors
+    mat4 _UnjitteredViewProjection;
+    mat4 _PreviousViewProjection;
+};
 
-uniform mat4 _LightViewProj;
+//Per draw, with the derived matrices already computed on the CPU
+layout (std140, binding = 3) uniform DrawData
+{
+    mat4 _Model;
+    mat4 _ModelViewProjection;
+    mat4 _NormalMatrix;
+};
 
 out struct Vertex
 {
@@ -19,19 +41,27 @@ out struct Vertex
 }vertexOutput;
 
 out mat3 TBN;
-out vec4 lightSpacePos;
+out vec4 currentClipPos;
+out vec4 previousClipPos;
+
+//Same expression in defaultLit.vert and depthOnly.vert, so the depth pre-pass matches exactly
+invariant gl_Position;
 
 void main(){    
 
     vertexOutput.worldPosition = vec3(_Model * vec4(vPos + vOffsetTemp, 1.0f));
-    vertexOutput.worldNormal = transpose(inverse(mat3(_Model))) * vNormal;
+    vertexOutput.worldNormal = mat3(_NormalMatrix) * vNormal;
     vertexOutput.uv = vUV;
 
-    vec3 t = normalize(transpose(inverse(mat3(_Model))) * vTangent);
-    vec3 n = normalize(transpose(inverse(mat3(_Model))) * vNormal);
+#if NORMAL_MAP
+    vec3 t = normalize(mat3(_NormalMatrix) * vTangent);
+    vec3 n = normalize(vertexOutput.worldNormal);
     vec3 b = normalize(cross(t, n));
     TBN = mat3(t, b, n);
+#endif
 
-    lightSpacePos = _LightViewProj * _Model * vec4(vPos, 1);
-    gl_Position = _Projection * _View * _Model * vec4(vPos + vOffsetTemp,1);
+    //Instances don't move between frames, only the camera does
+    currentClipPos = _UnjitteredViewProjection * vec4(vertexOutput.worldPosition, 1);
+    previousClipPos = _PreviousViewProjection * vec4(vertexOutput.worldPosition, 1);
+    gl_Position = _ModelViewProjection * vec4(vPos + vOffsetTemp,1);
 }
@@ -3,12 +3,20 @@ layout (location = 0) in vec3 vPos;
 layout (location = 1) in vec3 vNormal;
 layout (location = 2) in vec2 vUV;
 layout (location = 3) in vec3 vTangent;
+layout (location = 4) in vec3 vOffsetTemp;
 
-uniform mat4 _Model;
-uniform mat4 _View;
-uniform mat4 _Projection;
+//Per draw, with the derived matrices already computed on the CPU
+layout (std140, binding = 3) uniform DrawData
+{
+    mat4 _Model;
+    mat4 _ModelViewProjection;
+    mat4 _NormalMatrix;
+};
+
+//Same expression in defaultLit.vert and depthOnly.vert, so the depth pre-pass matches exactly
+invariant gl_Position;
 
 void main()
 {
-	gl_Position = _Projection * _View * _Model * vec4(vPos,1);
+	gl_Position = _ModelViewProjection * vec4(vPos + vOffsetTemp, 1);
 }
\ No newline at end of file
@@ -0,0 +1,66 @@
+#version 450
+//Feature switches, injected as #defines by ShadowCasterDraws
+#ifndef MULTI_DRAW
+#define MULTI_DRAW 0
+#endif
+//0 renders each view to a layer, 1 to a viewport
+#ifndef VIEW_TARGET
+#define VIEW_TARGET 0
+#endif
+#if MULTI_DRAW
+#extension GL_ARB_shader_draw_parameters : require
+#extension GL_ARB_shader_viewport_layer_array : require
+#endif
+layout (location = 0) in vec3 vPos;
+
+//Must match ShadowCasterDraws::MAX_VIEWS
+#define MAX_VIEWS 16
+
+struct ShadowView
+{
+    mat4 viewProjection;
+    vec4 planes[6];
+    int target;
+};
+
+//The instanced mesh's offsets, tightly packed vec3s
+layout (std430, binding = 0) readonly buffer InstanceOffsets
+{
+    float instanceOffsets[];
+};
+
+//Instances in each view, written by shadowCull.comp
+layout (std430, binding = 1) readonly buffer Casters
+{
+    uint casters[];
+};
+
+layout (std140, binding = 5) uniform ShadowViews
+{
+    ShadowView views[MAX_VIEWS];
+};
+
+uniform mat4 _Model;
+#if !MULTI_DRAW
+uniform int _View;
+uniform uint _MaxCastersPerView;
+#endif
+
+void main()
+{
+#if MULTI_DRAW
+    //One draw of the multi draw per view, its casters start at its base instance
+    int view = gl_DrawIDARB;
+    uint instance = casters[gl_BaseInstanceARB + gl_InstanceID];
+#if VIEW_TARGET == 0
+    gl_Layer = views[view].target;
+#else
+    gl_ViewportIndex = views[view].target;
+#endif
+#else
+    int view = _View;
+    uint instance = casters[uint(view) * _MaxCastersPerView + uint(gl_InstanceID)];
+#endif
+    vec3 offset = vec3(instanceOffsets[instance * 3u], instanceOffsets[instance * 3u + 1u], instanceOffsets[instance * 3u + 2u]);
+    gl_Position = views[view].viewProjection * _Model * vec4(vPos + offset, 1);
+}
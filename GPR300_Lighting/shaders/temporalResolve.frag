@@ -0,0 +1,102 @@
+#version 450
+out vec4 FragColor;
+
+// The resolve of ew::TemporalUpscaler, drawn over the output (history) size.
+// This frame's jittered samples around the pixel are filtered into a current color,
+// last frame's result is reprojected with the motion vectors, clamped to the colors
+// of the current 3x3 neighborhood so it can't ghost, then the two are blended.
+
+// Render size, this frame
+layout (binding = 4) uniform sampler2D _Source;
+layout (binding = 5) uniform sampler2D _Motion;
+layout (binding = 6) uniform sampler2D _Depth;
+// Output size, last frame's result
+layout (binding = 7) uniform sampler2D _History;
+
+// In pixels
+uniform vec2 _SourceSize;
+uniform vec2 _OutputSize;
+// This frame's projection jitter, in source pixels
+uniform vec2 _Jitter;
+// Weight of this frame where one of its samples lands right on the pixel
+uniform float _BlendFactor;
+// 0 when there's no history to use (first frame, resize)
+uniform float _HistoryValid;
+
+// Catmull-Rom from 5 bilinear fetches (the 4 corner taps are dropped). Bilinear would blur
+// the history a little more every frame the camera moves
+vec3 sampleHistory(vec2 uv)
+{
+    vec2 samplePos = uv * _OutputSize;
+    vec2 texPos1 = floor(samplePos - 0.5) + 0.5;
+    vec2 f = samplePos - texPos1;
+
+    vec2 w0 = f * (-0.5 + f * (1.0 - 0.5 * f));
+    vec2 w1 = 1.0 + f * f * (-2.5 + 1.5 * f);
+    vec2 w2 = f * (0.5 + f * (2.0 - 1.5 * f));
+    vec2 w3 = f * f * (-0.5 + 0.5 * f);
+    vec2 w12 = w1 + w2;
+
+    vec2 texPos0 = (texPos1 - 1.0) / _OutputSize;
+    vec2 texPos3 = (texPos1 + 2.0) / _OutputSize;
+    vec2 texPos12 = (texPos1 + w2 / w12) / _OutputSize;
+
+    vec3 result = texture(_History, vec2(texPos12.x, texPos0.y)).rgb * (w12.x * w0.y);
+    result += texture(_History, vec2(texPos0.x, texPos12.y)).rgb * (w0.x * w12.y);
+    result += texture(_History, texPos12).rgb * (w12.x * w12.y);
+    result += texture(_History, vec2(texPos3.x, texPos12.y)).rgb * (w3.x * w12.y);
+    result += texture(_History, vec2(texPos12.x, texPos3.y)).rgb * (w12.x * w3.y);
+    float weight = w12.x * w0.y + w0.x * w12.y + w12.x * w12.y + w3.x * w12.y + w12.x * w3.y;
+    return result / weight;
+}
+
+void main(){
+    vec2 uv = gl_FragCoord.xy / _OutputSize;
+    // In source pixels. Texel t was rasterized at t + 0.5, which the jitter moved to t + 0.5 - _Jitter
+    vec2 sourcePos = uv * _SourceSize;
+    ivec2 nearest = ivec2(floor(sourcePos + _Jitter));
+    vec2 outputPixelsPerSource = _OutputSize / _SourceSize;
+
+    vec3 sum = vec3(0);
+    float weightSum = 0.0;
+    float maxWeight = 0.0;
+    vec3 minColor = vec3(1.0);
+    vec3 maxColor = vec3(0.0);
+    float closestDepth = 1.0;
+    ivec2 closestTexel = nearest;
+    for (int y = -1; y <= 1; y++)
+    {
+        for (int x = -1; x <= 1; x++)
+        {
+            ivec2 texel = clamp(nearest + ivec2(x, y), ivec2(0), ivec2(_SourceSize) - 1);
+            vec3 color = texelFetch(_Source, texel, 0).rgb;
+
+            // Gaussian fit of Blackman-Harris over the distance in output pixels, so only
+            // samples that landed close to this pixel count for much when upsampling
+            vec2 offset = (vec2(nearest + ivec2(x, y)) + 0.5 - _Jitter - sourcePos) * outputPixelsPerSource;
+            float w = exp(-2.29 * dot(offset, offset));
+            sum += color * w;
+            weightSum += w;
+            maxWeight = max(maxWeight, w);
+
+            minColor = min(minColor, color);
+            maxColor = max(maxColor, color);
+
+            // The front-most surface's motion, so edges move with the object in front
+            float depth = texelFetch(_Depth, texel, 0).r;
+            if (depth < closestDepth)
+            {
+                closestDepth = depth;
+                closestTexel = texel;
+            }
+        }
+    }
+    vec3 current = sum / max(weightSum, 1e-5);
+
+    vec2 previousUV = uv - texelFetch(_Motion, closestTexel, 0).rg;
+    bool offscreen = any(lessThan(previousUV, vec2(0.0))) || any(greaterThan(previousUV, vec2(1.0)));
+    vec3 history = clamp(sampleHistory(previousUV), minColor, maxColor);
+
+    float alpha = _HistoryValid == 0.0 || offscreen ? 1.0 : clamp(_BlendFactor * maxWeight, 0.01, 1.0);
+    FragColor = vec4(mix(history, current, alpha), 1.0);
+}
@@ -1,8 +1,13 @@
 #version 450                          
-out vec4 FragColor;
+layout (location = 0) out vec4 FragColor;
+layout (location = 1) out vec2 Motion;
+
+in vec4 currentClipPos;
+in vec4 previousClipPos;
 
 uniform vec3 _Color;
 
 void main(){         
     FragColor = vec4(_Color,1.0f);
+    Motion = (currentClipPos.xy / currentClipPos.w - previousClipPos.xy / previousClipPos.w) * 0.5;
 }
@@ -0,0 +1,133 @@
+#version 450
+out vec4 FragColor;
+
+// The two passes of ew::Upscaler, drawn over the whole output.
+// UPSCALE_PASS 0 upscales _Source with a kernel stretched along the local edge,
+// 1 sharpens _Source (already at output size) by as much as it can without clipping.
+
+#define PASS_UPSCALE 0
+#define PASS_SHARPEN 1
+
+#ifndef UPSCALE_PASS
+#define UPSCALE_PASS PASS_UPSCALE
+#endif
+
+layout (binding = 4) uniform sampler2D _Source;
+
+// In pixels
+uniform vec2 _SourceSize;
+uniform vec2 _OutputSize;
+// 0 leaves the image as is, 1 sharpens as much as the local contrast allows
+uniform float _Sharpness;
+
+float luma(vec3 color)
+{
+    return dot(color, vec3(0.299, 0.587, 0.114));
+}
+
+vec3 fetch(ivec2 texel)
+{
+    return texelFetch(_Source, clamp(texel, ivec2(0), ivec2(_SourceSize) - 1), 0).rgb;
+}
+
+#if UPSCALE_PASS == PASS_UPSCALE
+// Lanczos2 approximated by polynomials, x2 = squared distance, zero at and past 2
+float lanczos2(float x2)
+{
+    x2 = min(x2, 4.0);
+    float a = 2.0 / 5.0 * x2 - 1.0;
+    float b = 1.0 / 4.0 * x2 - 1.0;
+    return (25.0 / 16.0 * a * a - (25.0 / 16.0 - 1.0)) * (b * b);
+}
+
+void main(){
+    // gl_FragCoord is the output pixel center
+    vec2 sourcePos = gl_FragCoord.xy * _SourceSize / _OutputSize - 0.5;
+    ivec2 base = ivec2(floor(sourcePos));
+    vec2 f = sourcePos - floor(sourcePos);
+
+    // 4x4 texels around the sample, [1][1] to [2][2] are the four closest
+    vec3 color[4][4];
+    float l[4][4];
+    for (int y = 0; y < 4; y++)
+    {
+        for (int x = 0; x < 4; x++)
+        {
+            color[y][x] = fetch(base + ivec2(x - 1, y - 1));
+            l[y][x] = luma(color[y][x]);
+        }
+    }
+
+    // Luma gradient at the four closest texels, blended bilinearly
+    vec2 gradient = vec2(0);
+    float minLuma = 1.0;
+    float maxLuma = 0.0;
+    for (int y = 1; y <= 2; y++)
+    {
+        for (int x = 1; x <= 2; x++)
+        {
+            vec2 w = mix(1.0 - f, f, vec2(x - 1, y - 1));
+            gradient += vec2(l[y][x + 1] - l[y][x - 1], l[y + 1][x] - l[y - 1][x]) * (w.x * w.y);
+            minLuma = min(minLuma, l[y][x]);
+            maxLuma = max(maxLuma, l[y][x]);
+        }
+    }
+
+    // 0 in flat areas and noise, 1 on a clean edge
+    float gradientLength = length(gradient);
+    float edge = clamp(gradientLength / max(2.0 * (maxLuma - minLuma), 1.0 / 255.0), 0.0, 1.0);
+    edge *= edge;
+    vec2 across = gradientLength > 1e-5 ? gradient / gradientLength : vec2(1.0, 0.0);
+    vec2 along = vec2(-across.y, across.x);
+
+    // On an edge the kernel narrows across it (stays sharp) and widens along it (smooths stair steps).
+    // Diagonal edges stretch further, as their steps are spread over more texels
+    float stretch = 1.0 / max(abs(across.x), abs(across.y));
+    vec2 scale = vec2(1.0 + (stretch - 1.0) * edge, 1.0 - 0.5 * edge);
+
+    vec3 sum = vec3(0);
+    float weightSum = 0.0;
+    for (int y = 0; y < 4; y++)
+    {
+        for (int x = 0; x < 4; x++)
+        {
+            vec2 offset = vec2(x - 1, y - 1) - f;
+            vec2 rotated = vec2(dot(offset, across), dot(offset, along)) * scale;
+            float w = lanczos2(dot(rotated, rotated));
+            sum += color[y][x] * w;
+            weightSum += w;
+        }
+    }
+    vec3 result = sum / weightSum;
+
+    // The negative lobes ring past the closest texels, clamp back to their range
+    vec3 minColor = min(min(color[1][1], color[1][2]), min(color[2][1], color[2][2]));
+    vec3 maxColor = max(max(color[1][1], color[1][2]), max(color[2][1], color[2][2]));
+    FragColor = vec4(clamp(result, minColor, maxColor), 1.0);
+}
+#else
+// Largest negative weight of the cross, stronger is unstable
+#define SHARPEN_LIMIT (0.25 - 1.0 / 16.0)
+
+void main(){
+    ivec2 texel = ivec2(gl_FragCoord.xy);
+    vec3 n = fetch(texel + ivec2(0, 1));
+    vec3 w = fetch(texel + ivec2(-1, 0));
+    vec3 c = fetch(texel);
+    vec3 e = fetch(texel + ivec2(1, 0));
+    vec3 s = fetch(texel + ivec2(0, -1));
+
+    vec3 minColor = min(min(min(n, w), min(e, s)), c);
+    vec3 maxColor = max(max(max(n, w), max(e, s)), c);
+
+    // Per channel, the lobe that would take the darkest or brightest neighbor to 0 or 1.
+    // Sharpening is limited by the channel closest to clipping, so edges don't halo
+    vec3 hitMin = minColor / (4.0 * maxColor + 1e-4);
+    vec3 hitMax = (1.0 - maxColor) / (4.0 * minColor - 4.0 - 1e-4);
+    vec3 lobes = max(-hitMin, hitMax);
+    float lobe = max(-SHARPEN_LIMIT, min(max(max(lobes.r, lobes.g), lobes.b), 0.0)) * _Sharpness;
+
+    vec3 result = (lobe * (n + w + e + s) + c) / (4.0 * lobe + 1.0);
+    FragColor = vec4(clamp(result, 0.0, 1.0), 1.0);
+}
+#endif